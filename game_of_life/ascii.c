@@ -0,0 +1,135 @@
+/*
+ * ASCII animation of the board on a terminal.
+ * See ascii.h for what a frame looks like.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "ascii.h"
+
+#define ESC_HOME   "\x1b[H"     // move the cursor to the top left
+#define ESC_CLEAR  "\x1b[2J"    // clear the screen
+#define ESC_EOL    "\x1b[K"     // clear to the end of the line
+
+/* append len characters of text to the frame's buffer (which ascii_init
+ * made big enough for any frame) */
+static inline void put(struct ascii_frame *frame, const char *text,
+        size_t len)
+{
+    memcpy(frame->buf + frame->len, text, len);
+    frame->len += len;
+}
+
+/* append formatted text of at most 64 characters to the frame's buffer */
+#define PUTF(frame, ...) ((frame)->len += snprintf((frame)->buf          \
+            + (frame)->len, (frame)->cap - (frame)->len, __VA_ARGS__))
+
+/* set up frames of a rows x cols board, written to fd
+ * returns: 0 on success, 1 on error
+ */
+int ascii_init(struct ascii_frame *frame, int fd, int rows, int cols,
+        int only_changed)
+{
+    size_t board_len;
+
+    memset(frame, 0, sizeof(*frame));
+    frame->fd = fd;
+    frame->rows = rows;
+    frame->cols = cols;
+    frame->only_changed = only_changed;
+    frame->row_len = 2 * (size_t)cols + 1;   // " @" or " ." per cell
+    board_len = frame->row_len * rows;
+
+    //room for every row, a cursor move before each, and the header/footer
+    frame->cap = board_len + 16 * (size_t)rows + 256;
+    frame->buf = malloc(frame->cap);
+    frame->now = malloc(board_len);
+    frame->last = malloc(board_len);
+    if (frame->buf == NULL || frame->now == NULL || frame->last == NULL) {
+        ascii_free(frame);
+        return 1;
+    }
+    return 0;
+}
+
+/* free the frame's buffers */
+void ascii_free(struct ascii_frame *frame) {
+    free(frame->buf);
+    free(frame->now);
+    free(frame->last);
+    frame->buf = frame->now = frame->last = NULL;
+}
+
+/* write all len characters of buf to fd
+ * returns: 0 on success, 1 on error */
+static int write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return 1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/* draw the board as of round, see ascii.h
+ * returns: 0 on success, 1 if the frame couldn't be written
+ */
+int ascii_draw(struct ascii_frame *frame, int round, long live,
+        ascii_cell_func alive, void *arg)
+{
+    int redraw_all = !frame->only_changed || frame->drawn == 0;
+    char *temp;
+
+    //lay out this frame's rows
+    for (int i = 0; i < frame->rows; i++) {
+        char *row = frame->now + i * frame->row_len;
+
+        for (int j = 0; j < frame->cols; j++) {
+            row[2*j] = ' ';
+            row[2*j + 1] = alive(arg, i, j) ? '@' : '.';
+        }
+        row[2 * frame->cols] = '\n';
+    }
+
+    frame->len = 0;
+    if (frame->drawn == 0) {
+        put(frame, ESC_HOME ESC_CLEAR, strlen(ESC_HOME ESC_CLEAR));
+    }
+    else {
+        put(frame, ESC_HOME, strlen(ESC_HOME));
+    }
+    PUTF(frame, "Round: %d" ESC_EOL "\n", round);
+
+    if (redraw_all) {
+        put(frame, frame->now, frame->row_len * frame->rows);
+    }
+    else {
+        //row i of the board is on line i+2 of the terminal
+        for (int i = 0; i < frame->rows; i++) {
+            size_t at = i * frame->row_len;
+
+            if (memcmp(frame->now + at, frame->last + at,
+                        frame->row_len) != 0) {
+                PUTF(frame, "\x1b[%d;1H", i + 2);
+                put(frame, frame->now + at, frame->row_len);
+            }
+        }
+        PUTF(frame, "\x1b[%d;1H", frame->rows + 2);
+    }
+    PUTF(frame, "Live cells: %ld" ESC_EOL "\n\n", live);
+
+    temp = frame->last;
+    frame->last = frame->now;
+    frame->now = temp;
+    frame->drawn++;
+    return write_all(frame->fd, frame->buf, frame->len);
+}
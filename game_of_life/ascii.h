@@ -0,0 +1,52 @@
+#ifndef __ASCII_H__
+#define __ASCII_H__
+
+#include <stddef.h>
+
+/* ASCII animation of the board on a terminal (OUTPUT_ASCII mode).
+ *
+ * Each frame is composed into one buffer and sent to the terminal with a
+ * single write(), using ANSI escape codes to move the cursor back to the
+ * top left instead of clearing the screen with a separate program.  A frame
+ * looks the same as print_board always has:
+ *
+ *     Round: 3
+ *      . @ . .
+ *      . . @ .
+ *     Live cells: 2
+ *
+ * With only_changed set, a frame after the first rewrites just the rows of
+ * the board that changed since the frame before, moving the cursor to each.
+ */
+
+/* called to ask if cell (i, j) of the board being drawn is alive */
+typedef int (*ascii_cell_func)(void *arg, int i, int j);
+
+struct ascii_frame {
+    int fd;              // where frames are written
+    int rows;            // the row dimension of the board
+    int cols;            // the column dimension of the board
+    int only_changed;    // 1 to redraw only the rows that changed
+    int drawn;           // frames drawn so far
+    size_t row_len;      // characters in one row of the board, with '\n'
+    char *now;           // this frame's rows
+    char *last;          // the last frame's rows
+    char *buf;           // the frame being composed
+    size_t len;          // characters in buf
+    size_t cap;          // characters buf has room for
+};
+
+/* set up frames of a rows x cols board, written to fd
+ * returns 0 on success, 1 on error */
+int ascii_init(struct ascii_frame *frame, int fd, int rows, int cols,
+        int only_changed);
+
+/* free the frame's buffers */
+void ascii_free(struct ascii_frame *frame);
+
+/* draw the board as of round, with live cells, asking alive about each cell
+ * returns 0 on success, 1 if the frame couldn't be written */
+int ascii_draw(struct ascii_frame *frame, int round, long live,
+        ascii_cell_func alive, void *arg);
+
+#endif  /* __ASCII_H__ */
@@ -0,0 +1,663 @@
+/*
+ * Batch mode: a pool of threads playing the independent boards of a
+ * manifest.  See batch.h for the manifest format and the result lines.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "batch.h"
+#include "loader.h"
+#include "rle.h"
+#include "snapshot.h"
+#include "boardmem.h"
+#include "soup.h"
+#include "libgol.h"
+
+/* the queue of jobs, oldest first, and the threads sharing them out */
+struct batch {
+    struct batch_job *first;    // oldest job not printed yet, or NULL
+    struct batch_job *pending;  // oldest job not handed out yet, or NULL
+    struct batch_job *last;     // newest job, or NULL
+    int next_index;       // number of the next job queued
+    long num_jobs;        // jobs queued in all
+    long failed;          // jobs printed as failed
+    int closed;           // 1 once no more jobs will be queued
+    int flush;            // 1 to flush out after each result line
+    struct gol_config config;      // how the handles play the jobs
+    const struct life_rule *rule;  // the rule they play
+    FILE *out;
+    pthread_mutex_t lock; // guards the queue and the jobs' done flags
+    pthread_cond_t more;  // signaled when a job is queued, or on closing
+    pthread_cond_t idle;  // signaled when every job queued is printed
+};
+
+/* one thread of the pool, with the board and handle it reuses from job to
+ * job */
+struct batch_worker {
+    struct batch *batch;
+    pthread_t tid;
+    struct bitgrid board; // the job's board, as it is loaded
+    size_t capacity;      // words allocated for it
+    struct gol_sim *sim;  // the handle playing it, or NULL before the first
+};
+
+/* return the seconds since some fixed time */
+static double now_seconds(void) {
+    struct timeval t;
+
+    gettimeofday(&t, NULL);
+    return t.tv_sec + t.tv_usec / 1e6;
+}
+
+/* fill in job from a line of the manifest (with its comment cut off)
+ * returns: 0 on success, 1 if the line isn't a job, -1 if it is blank */
+static int parse_job(struct batch_job *job, char *line) {
+    char *end = line + strlen(line);
+    char path[4096];
+    int used, more;
+
+    while (end > line && (end[-1] == ' ' || end[-1] == '\t'
+                || end[-1] == '\n' || end[-1] == '\r')) {
+        *--end = '\0';
+    }
+    while (*line == ' ' || *line == '\t') {
+        line++;
+    }
+    if (*line == '\0') {
+        return -1;
+    }
+
+    memset(job, 0, sizeof(*job));
+    job->rounds = -1;
+    job->source = strdup(line);
+    if (job->source == NULL) {
+        return 1;
+    }
+    if (sscanf(line, "soup %dx%d %lf %llu %d %n", &job->rows, &job->cols,
+                &job->density, &job->seed, &job->rounds, &used) == 5) {
+        if (line[used] != '\0' || job->rows < 1 || job->cols < 1
+                || job->density < 0 || job->density > 1 || job->rounds < 0) {
+            return 1;
+        }
+    }
+    else if (sscanf(line, "%4095s %n", path, &used) == 1
+            && strcmp(path, "soup") != 0) {
+        if (line[used] != '\0' && (sscanf(line + used, "%d %n",
+                        &job->rounds, &more) != 1 || job->rounds < 0
+                    || line[used + more] != '\0')) {
+            return 1;
+        }
+        job->path = strdup(path);
+        if (job->path == NULL) {
+            return 1;
+        }
+    }
+    else {
+        return 1;
+    }
+    return 0;
+}
+
+/* free a job and its strings */
+static void free_job(struct batch_job *job) {
+    free(job->source);
+    free(job->path);
+    free(job);
+}
+
+/* add a copy of job to the end of the queue, numbered next
+ * returns: 0 on success, 1 if it couldn't be allocated */
+static int queue_job(struct batch *batch, const struct batch_job *job) {
+    struct batch_job *copy = malloc(sizeof(*copy));
+
+    if (copy == NULL) {
+        printf("Error: Failure to allocate jobs.\n");
+        return 1;
+    }
+    *copy = *job;
+    copy->next = NULL;
+    pthread_mutex_lock(&batch->lock);
+    copy->index = batch->next_index++;
+    batch->num_jobs++;
+    if (batch->last != NULL) {
+        batch->last->next = copy;
+    }
+    else {
+        batch->first = copy;
+    }
+    batch->last = copy;
+    if (batch->pending == NULL) {
+        batch->pending = copy;
+    }
+    pthread_cond_signal(&batch->more);
+    pthread_mutex_unlock(&batch->lock);
+    return 0;
+}
+
+/* queue the jobs of the manifest at path on batch
+ * returns: 0 on success, 1 on error */
+static int read_manifest(struct batch *batch, const char *path) {
+    FILE *file = fopen(path, "r");
+    char *line = NULL;
+    size_t size = 0;
+    long line_num = 0;
+
+    if (file == NULL) {
+        perror(path);
+        return 1;
+    }
+    while (getline(&line, &size, file) > 0) {
+        char *comment = strchr(line, '#');
+        struct batch_job job;
+        int ret;
+
+        line_num++;
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+        ret = parse_job(&job, line);
+        if (ret < 0) {
+            continue;
+        }
+        if (ret > 0) {
+            printf("Error: %s, line %ld: not a board file [rounds] or a "
+                    "soup RxC density seed rounds\n", path, line_num);
+        }
+        if (ret > 0 || queue_job(batch, &job) != 0) {
+            free(job.source);
+            free(job.path);
+            free(line);
+            fclose(file);
+            return 1;
+        }
+    }
+    free(line);
+    fclose(file);
+    return 0;
+}
+
+/* set the worker's board to rows x cols cells, all dead, growing its
+ * storage (see boardmem.h) only if it is too small
+ * returns: 0 on success, 1 on error */
+static int reserve_board(struct batch_worker *worker, int rows, int cols) {
+    int words = (cols + 63) / 64;
+    size_t needed = (size_t)rows * words;
+    struct bitgrid *board = &worker->board;
+
+    if (needed > worker->capacity) {
+        uint64_t *bits = boardmem_alloc(needed * sizeof(uint64_t));
+
+        if (bits == NULL) {
+            printf("Error: Failure to allocate board.\n");
+            return 1;
+        }
+        boardmem_free(board->bits, worker->capacity * sizeof(uint64_t));
+        board->bits = bits;
+        worker->capacity = needed;
+    }
+    board->rows = rows;
+    board->cols = cols;
+    board->words = words;
+    bitgrid_clear(board);
+    return 0;
+}
+
+/* rle_decode callback: set the n cells from (i, j) along row i to alive on
+ * the bitgrid at arg
+ * returns: 0 */
+static int set_run(void *arg, int i, int j, int n) {
+    bitgrid_set_run(arg, i, j, n);
+    return 0;
+}
+
+/* set up the worker's board for job, and the number of rounds to play it
+ * for, from its file or its seed
+ * returns: 0 on success, 1 on error */
+static int load_job(struct batch_worker *worker, struct batch_job *job,
+        int *rounds)
+{
+    struct bitgrid *board = &worker->board;
+    struct board_file file;
+    int ret;
+
+    if (job->path == NULL) {
+        //the same board as gol --random=RxC,density,seed
+        struct soup soup = {job->rows, job->cols, job->density, job->seed};
+
+        if (reserve_board(worker, job->rows, job->cols) != 0) {
+            return 1;
+        }
+        soup_fill(&soup, board, 1);
+        *rounds = job->rounds;
+        return 0;
+    }
+
+    if (snapshot_check(job->path)) {
+        struct snapshot snap;
+        struct life_rule recorded;
+
+        if (snapshot_open(job->path, &snap) != 0) {
+            return 1;
+        }
+        if (!snapshot_rule_matches(snap.header, worker->batch->rule,
+                    &recorded)) {
+            printf("Error: %s was played under %s, not %s\n", job->path,
+                    recorded.name, worker->batch->rule->name);
+            snapshot_close(&snap);
+            return 1;
+        }
+        *rounds = ((job->rounds >= 0) ? job->rounds : snap.header->iters)
+            - snap.header->round;
+        ret = (*rounds < 0) || reserve_board(worker, snap.header->rows,
+                snap.header->cols);
+        for (int i = 0; i < board->rows && ret == 0; i++) {
+            memcpy(bitgrid_row(board, i), snap.bits
+                    + (long)i * snap.header->words,
+                    board->words * sizeof(uint64_t));
+        }
+        snapshot_close(&snap);
+        return ret;
+    }
+
+    if (rle_check(job->path)) {
+        struct rle_reader rle;
+
+        if (job->rounds < 0) {
+            printf("Error: %s doesn't say how many rounds to play\n",
+                    job->path);
+            return 1;
+        }
+        if (rle_open(&rle, job->path, worker->batch->rule) != 0) {
+            return 1;
+        }
+        ret = reserve_board(worker, rle.rows, rle.cols);
+        if (ret == 0) {
+            ret = rle_decode(&rle, 0, 0, set_run, board);
+        }
+        rle_close(&rle);
+        *rounds = job->rounds;
+        return ret;
+    }
+
+    if (board_load(job->path, &file, 1) != 0) {
+        return 1;
+    }
+    *rounds = (job->rounds >= 0) ? job->rounds : file.iters;
+    ret = reserve_board(worker, file.rows, file.cols);
+    for (long c = 0; c < file.num_alive && ret == 0; c++) {
+        bitgrid_set(board, file.cells[2*c], file.cells[2*c + 1], 1);
+    }
+    board_file_free(&file);
+    return ret;
+}
+
+/* play job on the worker's handle and fill in its results */
+static void run_job(struct batch_worker *worker, struct batch_job *job) {
+    struct bitgrid *board = &worker->board;
+    double start;
+    int rounds, ret;
+
+    //a line that isn't a job is queued as failed, to answer it in turn
+    if (job->failed) {
+        return;
+    }
+    if (load_job(worker, job, &rounds) != 0) {
+        job->failed = 1;
+        return;
+    }
+    if (worker->sim == NULL) {
+        ret = gol_create_bits(&worker->sim, board->rows, board->cols,
+                board->bits, board->words, &worker->batch->config);
+    }
+    else {
+        ret = gol_load_bits(worker->sim, board->rows, board->cols,
+                board->bits, board->words);
+    }
+    if (ret != GOL_OK) {
+        printf("Error: %s: %s\n", job->source, gol_strerror(ret));
+        job->failed = 1;
+        return;
+    }
+    job->board_rows = board->rows;
+    job->board_cols = board->cols;
+    job->played = rounds;
+
+    start = now_seconds();
+    job->failed = (gol_step(worker->sim, rounds) != GOL_OK);
+    job->live = gol_live(worker->sim);
+    job->seconds = now_seconds() - start;
+}
+
+/* mark job finished, and print (and free) the result lines of it and any
+ * finished jobs after it, if every job before it has already been printed */
+static void finish_job(struct batch *batch, struct batch_job *job) {
+    pthread_mutex_lock(&batch->lock);
+    job->done = 1;
+    while (batch->first != NULL && batch->first->done) {
+        job = batch->first;
+        if (job->failed) {
+            fprintf(batch->out, "job %d: %s: failed\n", job->index,
+                    job->source);
+            batch->failed++;
+        }
+        else {
+            fprintf(batch->out, "job %d: %s: %dx%d, %d rounds, %ld live, "
+                    "%0.6f seconds\n", job->index, job->source,
+                    job->board_rows, job->board_cols, job->played,
+                    job->live, job->seconds);
+        }
+        batch->first = job->next;
+        free_job(job);
+    }
+    if (batch->first == NULL) {
+        batch->last = NULL;
+        pthread_cond_broadcast(&batch->idle);
+    }
+    if (batch->flush) {
+        fflush(batch->out);
+    }
+    pthread_mutex_unlock(&batch->lock);
+}
+
+/* take the oldest job not handed out yet, waiting for one to be queued
+ * returns: the job, or NULL once the queue is closed and none are left */
+static struct batch_job *next_job(struct batch *batch) {
+    struct batch_job *job;
+
+    pthread_mutex_lock(&batch->lock);
+    while (batch->pending == NULL && !batch->closed) {
+        pthread_cond_wait(&batch->more, &batch->lock);
+    }
+    job = batch->pending;
+    if (job != NULL) {
+        batch->pending = job->next;
+    }
+    pthread_mutex_unlock(&batch->lock);
+    return job;
+}
+
+/* the main loop of each thread of the pool: play jobs until the queue is
+ * closed with none left */
+static void *batch_main(void *arg) {
+    struct batch_worker *worker = arg;
+    struct batch *batch = worker->batch;
+    struct batch_job *job;
+
+    while ((job = next_job(batch)) != NULL) {
+        run_job(worker, job);
+        finish_job(batch, job);
+    }
+    return NULL;
+}
+
+/* set up an empty queue of jobs to play under rule with kernel, with
+ * their result lines printed to out */
+static void init_batch(struct batch *batch, const char *kernel,
+        const struct life_rule *rule, FILE *out)
+{
+    memset(batch, 0, sizeof(*batch));
+    batch->config.num_threads = 1;
+    batch->config.rule = rule->name;
+    batch->config.kernel = kernel;
+    batch->rule = rule;
+    batch->out = out;
+    pthread_mutex_init(&batch->lock, NULL);
+    pthread_cond_init(&batch->more, NULL);
+    pthread_cond_init(&batch->idle, NULL);
+}
+
+/* free the jobs still queued, and the queue */
+static void free_batch(struct batch *batch) {
+    while (batch->first != NULL) {
+        struct batch_job *job = batch->first;
+
+        batch->first = job->next;
+        free_job(job);
+    }
+    pthread_mutex_destroy(&batch->lock);
+    pthread_cond_destroy(&batch->more);
+    pthread_cond_destroy(&batch->idle);
+}
+
+/* free the boards and handles of num_workers threads, and their array */
+static void free_workers(struct batch_worker *workers, int num_workers) {
+    for (int t = 0; t < num_workers; t++) {
+        boardmem_free(workers[t].board.bits,
+                workers[t].capacity * sizeof(uint64_t));
+        gol_destroy(workers[t].sim);
+    }
+    free(workers);
+}
+
+/* play every job of the manifest at path, see batch.h
+ * returns: 0 if every job ran, 1 if the manifest couldn't be read or any
+ * job failed
+ */
+int batch_run(const char *path, const char *kernel,
+        const struct life_rule *rule, int num_threads, FILE *out)
+{
+    struct batch batch;
+    struct batch_worker *workers;
+    double start;
+
+    //the whole manifest is read (and checked) before any job starts
+    init_batch(&batch, kernel, rule, out);
+    if (read_manifest(&batch, path) != 0) {
+        free_batch(&batch);
+        return 1;
+    }
+    batch.closed = 1;
+
+    //no point in more threads than jobs
+    if (num_threads > batch.num_jobs) {
+        num_threads = batch.num_jobs > 0 ? batch.num_jobs : 1;
+    }
+    workers = calloc(num_threads, sizeof(*workers));
+    if (workers == NULL) {
+        printf("Error: Failure to allocate threads.\n");
+        free_batch(&batch);
+        return 1;
+    }
+
+    start = now_seconds();
+    for (int t = 0; t < num_threads; t++) {
+        workers[t].batch = &batch;
+        if (t > 0 && pthread_create(&workers[t].tid, NULL, batch_main,
+                    &workers[t])) {
+            printf("Error: pthread_create failed\n");
+            exit(1);
+        }
+    }
+    batch_main(&workers[0]);
+    for (int t = 1; t < num_threads; t++) {
+        pthread_join(workers[t].tid, NULL);
+    }
+
+    fprintf(out, "Batch: %ld jobs (%ld failed) on %d threads in %0.3f "
+            "seconds\n", batch.num_jobs, batch.failed, num_threads,
+            now_seconds() - start);
+
+    free_workers(workers, num_threads);
+    free_batch(&batch);
+    return batch.failed != 0;
+}
+
+/* queue the jobs of the lines read from in as they come, with their result
+ * lines printed to out, numbered from 0, until the end of in or a quit line,
+ * and wait for all of them to be printed
+ * returns: 1 if a quit line was read, 0 if not */
+static int serve_stream(struct batch *batch, FILE *in, FILE *out) {
+    char *line = NULL;
+    size_t size = 0;
+    int quit = 0;
+
+    //the pool is idle between streams, so it is safe to switch outputs
+    pthread_mutex_lock(&batch->lock);
+    batch->out = out;
+    batch->next_index = 0;
+    pthread_mutex_unlock(&batch->lock);
+
+    while (!quit && getline(&line, &size, in) > 0) {
+        char *comment = strchr(line, '#');
+        struct batch_job job;
+        int used = 0, ret;
+
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+        if (sscanf(line, " quit %n", &used) == 0 && used > 0
+                && line[used] == '\0') {
+            quit = 1;
+            break;
+        }
+        ret = parse_job(&job, line);
+        if (ret < 0) {
+            continue;
+        }
+        if (ret > 0) {
+            free(job.path);
+            job.path = NULL;
+            job.failed = 1;
+            if (job.source == NULL) {
+                continue;
+            }
+        }
+        if (queue_job(batch, &job) != 0) {
+            free(job.source);
+            free(job.path);
+        }
+    }
+    free(line);
+
+    pthread_mutex_lock(&batch->lock);
+    while (batch->first != NULL) {
+        pthread_cond_wait(&batch->idle, &batch->lock);
+    }
+    pthread_mutex_unlock(&batch->lock);
+    return quit;
+}
+
+/* serve the clients of a Unix socket made at path, one connection at a
+ * time, until one of them sends a quit line
+ * returns: 0 on success, 1 if the socket couldn't be made */
+static int serve_socket(struct batch *batch, const char *path) {
+    struct sockaddr_un addr;
+    struct stat st;
+    int fd, quit = 0;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        printf("Error: the socket path %s is too long\n", path);
+        return 1;
+    }
+    //a socket left behind by a server that was killed
+    if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(path);
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0
+            || listen(fd, 16) != 0) {
+        perror(path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return 1;
+    }
+    //a client hanging up before its results are written mustn't stop us
+    signal(SIGPIPE, SIG_IGN);
+    printf("Serving on %s\n", path);
+    fflush(stdout);
+
+    while (!quit) {
+        int client = accept(fd, NULL, NULL);
+        FILE *in, *out;
+
+        if (client < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror(path);
+            break;
+        }
+        in = fdopen(client, "r");
+        out = (in != NULL) ? fdopen(dup(client), "w") : NULL;
+        if (out == NULL) {
+            printf("Error: Failure to set up a connection.\n");
+            if (in != NULL) {
+                fclose(in);
+            }
+            else {
+                close(client);
+            }
+            continue;
+        }
+        quit = serve_stream(batch, in, out);
+        fclose(in);
+        fclose(out);
+    }
+    close(fd);
+    unlink(path);
+    return 0;
+}
+
+/* play jobs as they come in, on standard input or the Unix socket at
+ * socket_path, see batch.h
+ * returns: 0 once the jobs are all answered, 1 if the server couldn't be
+ * started
+ */
+int batch_serve(const char *socket_path, const char *kernel,
+        const struct life_rule *rule, int num_threads)
+{
+    struct batch batch;
+    struct batch_worker *workers;
+    int ret;
+
+    init_batch(&batch, kernel, rule, stdout);
+    batch.flush = 1;
+    workers = calloc(num_threads, sizeof(*workers));
+    if (workers == NULL) {
+        printf("Error: Failure to allocate threads.\n");
+        free_batch(&batch);
+        return 1;
+    }
+    for (int t = 0; t < num_threads; t++) {
+        workers[t].batch = &batch;
+        if (pthread_create(&workers[t].tid, NULL, batch_main, &workers[t])) {
+            printf("Error: pthread_create failed\n");
+            exit(1);
+        }
+    }
+
+    if (socket_path == NULL) {
+        serve_stream(&batch, stdin, stdout);
+        ret = 0;
+    }
+    else {
+        ret = serve_socket(&batch, socket_path);
+    }
+
+    pthread_mutex_lock(&batch.lock);
+    batch.closed = 1;
+    pthread_cond_broadcast(&batch.more);
+    pthread_mutex_unlock(&batch.lock);
+    for (int t = 0; t < num_threads; t++) {
+        pthread_join(workers[t].tid, NULL);
+    }
+    if (ret == 0) {
+        printf("Served: %ld jobs (%ld failed) on %d threads\n",
+                batch.num_jobs, batch.failed, num_threads);
+    }
+
+    free_workers(workers, num_threads);
+    free_batch(&batch);
+    return ret;
+}
@@ -0,0 +1,86 @@
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include <stdio.h>
+#include "rule.h"
+
+/* Batch mode: many independent boards played by a pool of threads in one
+ * process, for parameter sweeps over small boards that would otherwise pay
+ * for a process launch each.  Server mode keeps the pool running, taking
+ * jobs as they come.
+ *
+ * The manifest lists one job per line (blank lines and everything after a
+ * '#' are skipped):
+ *     test_corners.txt          a board file, snapshot or .rle pattern,
+ *                               played for its own number of rounds
+ *     test_corners.txt 500      the same, played for 500 rounds instead
+ *                               (needed for .rle patterns)
+ *     soup 64x64 0.35 7 1000    a random 64 x 64 board with each cell alive
+ *                               with probability 0.35, from seed 7, played
+ *                               for 1000 rounds (see soup.h)
+ *
+ * Each thread takes the next job that no thread has started and plays it
+ * alone on a libgol handle of its own (see libgol.h), with the packed
+ * kernel and the rule being played (.rle patterns for other rules are
+ * turned down).  A thread keeps its board and its handle from job to job
+ * and only grows them when a job needs a bigger board, so a sweep of small
+ * boards costs no allocations per job beyond reading its file.
+ *
+ * One line per job is printed, in manifest order, as soon as it and every
+ * job before it have finished:
+ *     job 3: test_corners.txt: 6x6, 15 rounds, 4 live, 0.000012 seconds
+ * where the time is that of the rounds alone, like gol's "Total time".
+ *
+ * In server mode (gol --serve), the jobs are read a line at a time, in the
+ * manifest's format, and each one is queued as soon as its line comes in:
+ *     ./gol --serve -t 4 0 < jobs.fifo     jobs from standard input (a pipe
+ *                                          or FIFO) until its end, result
+ *                                          lines to standard output
+ *     ./gol --serve=gol.sock -t 4 0        jobs from the clients of a Unix
+ *                                          socket, one connection at a time
+ * Each connection's result lines go back to it, numbered from job 0, and
+ * are flushed as they are printed, so a client can send its jobs and read
+ * the answers without hanging up in between.  A line that isn't a job is
+ * answered "job N: LINE: failed", and a line "quit" stops the server once
+ * the jobs before it are answered.  Board files are opened from the
+ * server's working directory.
+ */
+
+/* a line of the manifest */
+struct batch_job {
+    char *source;     // the line, as given (less any comment)
+    char *path;       // the board file, or NULL for a soup
+    int rows;         // the soup's size
+    int cols;
+    double density;   // the soup's chance of a cell being alive
+    unsigned long long seed;
+    int rounds;       // rounds to play, or -1 for the board file's own
+
+    int index;        // the job's number, from 0
+    int failed;       // 1 if the job couldn't be run
+    int done;         // 1 once the job has finished
+    int board_rows;   // the board that was played
+    int board_cols;
+    int played;       // rounds played
+    long live;        // live cells after the last round
+    double seconds;   // time spent playing the rounds
+    struct batch_job *next;  // the job queued after it
+};
+
+/* play every job of the manifest at path under rule, with num_threads
+ * threads taking turns at the jobs and playing their rounds with kernel
+ * ("swar", "avx2" or "avx512"), printing each job's result line to out
+ * returns 0 if every job ran, 1 if the manifest couldn't be read or any
+ * job failed */
+int batch_run(const char *path, const char *kernel,
+        const struct life_rule *rule, int num_threads, FILE *out);
+
+/* serve jobs played under rule with kernel on a pool of num_threads
+ * threads, from standard input if socket_path is NULL, or from the clients
+ * of a Unix socket made at socket_path
+ * returns 0 once the input ends or a client sends quit, 1 if the server
+ * couldn't be started */
+int batch_serve(const char *socket_path, const char *kernel,
+        const struct life_rule *rule, int num_threads);
+
+#endif  /* __BATCH_H__ */
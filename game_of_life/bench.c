@@ -0,0 +1,500 @@
+/*
+ * Benchmark driver for gol (make bench).
+ *
+ * Runs ./gol_headless (make headless: gol with no Qt5 or ParaVis to load,
+ * which would count against wall_seconds) with no animation for every
+ * engine and kernel, over a matrix of boards (random soups of a few sizes
+ * and densities, generated here, and the checked-in test_*.txt files) and
+ * generation counts, and reports one record per run as CSV or JSON:
+ *   seconds       the rounds alone, as timed by gol ("Total time")
+ *   wall_seconds  the whole gol process, loading the board included
+ *   cells_per_sec rows * cols * generations / seconds
+ *   ns_per_cell   nanoseconds per cell update (empty if too quick to time)
+ *   peak_rss_kb   the gol process's peak resident set size
+ *   live          the live cells at the end, which every engine must agree
+ *                 on (a disagreement is reported on stderr)
+ *
+ * To run:
+ *   ./gol_bench [-q] [-r reps] [-u updates] [-t nthreads] [-s seed]
+ *               [-f csv|json] [-o outfile] [-g path/to/gol]
+ *   -q  quick: a budget of 2e8 cell updates per run instead of 4e9
+ *   -r  run each configuration reps times and keep the fastest (default 1)
+ *   -u  skip the runs of more than this many cell updates (a twentieth of
+ *       that for the naive kernel)
+ *   -t  threads for the threaded engines (default: the CPUs, at least 2)
+ *   -s  seed for the random soups (default 1)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define MAX_ARGS    (16)      // gol arguments, the file and mode included
+#define OUTPUT_CAP  (4096)    // gol output kept for parsing
+
+/* an engine/kernel configuration of gol, the options that select it (%d is
+ * replaced by the thread count), and the share of the budget it gets */
+struct engine {
+    const char *name;
+    const char *options;
+    double budget_share;  // the naive kernel is ~50x slower than the rest
+};
+
+static const struct engine engines[] = {
+    {"naive",    "--grid=int --kernel=naive", 0.05},
+    {"halo",     "--grid=int --kernel=halo", 1},
+    {"lut",      "--grid=int --kernel=lut", 1},
+    {"swar",     "--kernel=swar", 1},
+    {"avx2",     "--kernel=avx2", 1},
+    {"avx512",   "--kernel=avx512", 1},
+    {"threaded", "--kernel=swar -t %d", 1},
+    {"tiles",    "--kernel=swar --sched=tiles -t %d", 1},
+    {"temporal", "--kernel=swar --temporal=8 -t %d", 1},
+    {"sparse",   "--engine=sparse", 1},
+    {"hashlife", "--engine=hashlife", 1},
+};
+#define NUM_ENGINES  ((int)(sizeof(engines) / sizeof(engines[0])))
+
+static const int soup_sizes[] = {256, 1024, 4096};
+static const double soup_densities[] = {0.05, 0.35};
+static const int generations[] = {100, 1000, 10000};
+#define NUM_SIZES      ((int)(sizeof(soup_sizes) / sizeof(soup_sizes[0])))
+#define NUM_DENSITIES  ((int)(sizeof(soup_densities) / sizeof(double)))
+#define NUM_GENS       ((int)(sizeof(generations) / sizeof(int)))
+
+/* a board to run, and what it is */
+struct board {
+    char path[4096];
+    char name[64];
+    int rows;
+    int cols;
+    double density;  // live cells / cells, at round 0
+};
+
+/* one timed run of gol */
+struct result {
+    double seconds;       // the rounds alone (gol's "Total time")
+    double wall_seconds;  // the whole process
+    long peak_rss_kb;
+    long live;            // live cells after the last round
+};
+
+/* the output, and whether any record has been written yet */
+struct report {
+    FILE *out;
+    int json;
+    long records;
+};
+
+
+/* return the next number of a xorshift64 stream */
+static inline unsigned long long next_random(unsigned long long *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/* write a rows x cols board file at path with each cell alive with
+ * probability density, and fill in board
+ * returns: 0 on success, 1 on error */
+static int write_soup(struct board *board, const char *path, int rows,
+        int cols, double density, unsigned long long seed)
+{
+    unsigned long long state = seed * 0x9E3779B97F4A7C15ull + rows + 1;
+    unsigned long long threshold = (unsigned long long)(density * 4294967296.0);
+    long num_alive = 0;
+    FILE *file;
+
+    //count the live cells first: the count comes before the cells
+    for (long c = 0; c < (long)rows * cols; c++) {
+        num_alive += (next_random(&state) >> 32) < threshold;
+    }
+    file = fopen(path, "w");
+    if (file == NULL) {
+        perror(path);
+        return 1;
+    }
+    fprintf(file, "%d\n%d\n%d\n%ld\n", rows, cols, generations[0], num_alive);
+
+    state = seed * 0x9E3779B97F4A7C15ull + rows + 1;
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            if ((next_random(&state) >> 32) < threshold) {
+                fprintf(file, "%d %d\n", i, j);
+            }
+        }
+    }
+    if (fclose(file) != 0) {
+        perror(path);
+        return 1;
+    }
+
+    snprintf(board->path, sizeof(board->path), "%s", path);
+    snprintf(board->name, sizeof(board->name), "soup-%dx%d-%.2f", rows,
+            cols, density);
+    board->rows = rows;
+    board->cols = cols;
+    board->density = (double)num_alive / ((double)rows * cols);
+    return 0;
+}
+
+/* fill in board from the header of the board file at path
+ * returns: 0 on success, 1 on error */
+static int read_board(struct board *board, const char *path) {
+    FILE *file = fopen(path, "r");
+    int iters;
+    long num_alive;
+
+    if (file == NULL) {
+        perror(path);
+        return 1;
+    }
+    if (fscanf(file, "%d %d %d %ld", &board->rows, &board->cols, &iters,
+                &num_alive) != 4 || board->rows < 1 || board->cols < 1) {
+        fprintf(stderr, "%s: not a board file\n", path);
+        fclose(file);
+        return 1;
+    }
+    fclose(file);
+
+    snprintf(board->path, sizeof(board->path), "%s", path);
+    snprintf(board->name, sizeof(board->name), "%s", path);
+    board->density = (double)num_alive / ((double)board->rows * board->cols);
+    return 0;
+}
+
+/* return the seconds since some fixed time */
+static double now_seconds(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/* run gol with args (args[0] is its path) and time it
+ * returns: 0 on success, 1 if gol failed (e.g. a kernel this CPU lacks) */
+static int run_gol(char **args, struct result *result) {
+    char output[OUTPUT_CAP];
+    size_t len = 0;
+    int fds[2], status;
+    struct rusage usage;
+    double start = now_seconds();
+    const char *line;
+    pid_t pid;
+
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return 1;
+    }
+    pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        close(fds[0]);
+        close(fds[1]);
+        return 1;
+    }
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+
+        dup2(fds[1], STDOUT_FILENO);
+        dup2(null_fd, STDERR_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execv(args[0], args);
+        _exit(127);
+    }
+
+    //keep the start of the output: the lines we want come first
+    close(fds[1]);
+    for (;;) {
+        char discard[OUTPUT_CAP];
+        ssize_t n;
+
+        if (len < sizeof(output) - 1) {
+            n = read(fds[0], output + len, sizeof(output) - 1 - len);
+        }
+        else {
+            n = read(fds[0], discard, sizeof(discard));
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        if (len < sizeof(output) - 1) {
+            len += n;
+        }
+    }
+    output[len] = '\0';
+    close(fds[0]);
+    while (wait4(pid, &status, 0, &usage) < 0 && errno == EINTR) {
+    }
+    result->wall_seconds = now_seconds() - start;
+    result->peak_rss_kb = usage.ru_maxrss;  // kilobytes, on Linux
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return 1;
+    }
+    line = strstr(output, "Total time:");
+    if (line == NULL || sscanf(line, "Total time: %lf", &result->seconds) != 1) {
+        return 1;
+    }
+    line = strstr(output, "Number of live cells after");
+    if (line == NULL || sscanf(line, "Number of live cells after %*d rounds: "
+                "%ld", &result->live) != 1) {
+        return 1;
+    }
+    return 0;
+}
+
+/* run gol with the engine's options on board for gens generations, reps
+ * times, and fill in result with the fastest run
+ * returns: 0 on success, 1 if gol failed */
+static int bench_one(const char *gol, const struct engine *engine,
+        int threads, const struct board *board, int gens, int reps,
+        struct result *result)
+{
+    char options[256], rounds[32];
+    char *args[MAX_ARGS];
+    int num_args = 0;
+
+    snprintf(options, sizeof(options), engine->options, threads);
+    snprintf(rounds, sizeof(rounds), "--rounds=%d", gens);
+    args[num_args++] = (char *)gol;
+    for (char *word = strtok(options, " "); word != NULL
+            && num_args < MAX_ARGS - 4; word = strtok(NULL, " ")) {
+        args[num_args++] = word;
+    }
+    args[num_args++] = rounds;
+    args[num_args++] = (char *)board->path;
+    args[num_args++] = "0";
+    args[num_args] = NULL;
+
+    for (int r = 0; r < reps; r++) {
+        struct result run;
+
+        if (run_gol(args, &run) != 0) {
+            return 1;
+        }
+        if (r == 0 || run.seconds < result->seconds) {
+            *result = run;
+        }
+    }
+    return 0;
+}
+
+/* write the CSV header, or open the JSON array */
+static void report_start(struct report *report) {
+    if (report->json) {
+        fprintf(report->out, "[\n");
+    }
+    else {
+        fprintf(report->out, "board,rows,cols,density,generations,engine,"
+                "options,seconds,wall_seconds,cells_per_sec,ns_per_cell,"
+                "peak_rss_kb,live\n");
+    }
+}
+
+/* write the record of one run */
+static void report_run(struct report *report, const struct board *board,
+        int gens, const struct engine *engine, int threads,
+        const struct result *result)
+{
+    double updates = (double)board->rows * board->cols * gens;
+    char options[256], rate[32] = "", ns[32] = "";
+
+    snprintf(options, sizeof(options), engine->options, threads);
+    //gol times to the millisecond: leave the rates out of quicker runs
+    if (result->seconds > 0) {
+        snprintf(rate, sizeof(rate), "%.4g", updates / result->seconds);
+        snprintf(ns, sizeof(ns), "%.4g", result->seconds * 1e9 / updates);
+    }
+
+    if (report->json) {
+        fprintf(report->out, "%s  {\"board\": \"%s\", \"rows\": %d, "
+                "\"cols\": %d, \"density\": %.4f, \"generations\": %d, "
+                "\"engine\": \"%s\", \"options\": \"%s\", "
+                "\"seconds\": %.3f, \"wall_seconds\": %.3f, "
+                "\"cells_per_sec\": %s, \"ns_per_cell\": %s, "
+                "\"peak_rss_kb\": %ld, \"live\": %ld}",
+                report->records ? ",\n" : "", board->name, board->rows,
+                board->cols, board->density, gens, engine->name, options,
+                result->seconds, result->wall_seconds,
+                rate[0] ? rate : "null", ns[0] ? ns : "null",
+                result->peak_rss_kb, result->live);
+    }
+    else {
+        fprintf(report->out, "%s,%d,%d,%.4f,%d,%s,%s,%.3f,%.3f,%s,%s,%ld,"
+                "%ld\n", board->name, board->rows, board->cols,
+                board->density, gens, engine->name, options, result->seconds,
+                result->wall_seconds, rate, ns, result->peak_rss_kb,
+                result->live);
+    }
+    fflush(report->out);
+    report->records++;
+}
+
+/* close the JSON array */
+static void report_end(struct report *report) {
+    if (report->json) {
+        fprintf(report->out, "%s]\n", report->records ? "\n" : "");
+    }
+}
+
+/* run every engine on board, for each generation count within budget */
+static void bench_board(const char *gol, const struct board *board,
+        int threads, int reps, double budget, struct report *report)
+{
+    for (int g = 0; g < NUM_GENS; g++) {
+        int gens = generations[g];
+        long expected = -1;
+        const char *expected_from = NULL;
+
+        if ((double)board->rows * board->cols * gens > budget) {
+            continue;
+        }
+        for (int e = 0; e < NUM_ENGINES; e++) {
+            struct result result;
+
+            if ((double)board->rows * board->cols * gens
+                    > budget * engines[e].budget_share) {
+                continue;
+            }
+            fprintf(stderr, "%s, %d generations: %s\n", board->name, gens,
+                    engines[e].name);
+            if (bench_one(gol, &engines[e], threads, board, gens, reps,
+                        &result) != 0) {
+                fprintf(stderr, "  skipped: gol failed (not supported "
+                        "here?)\n");
+                continue;
+            }
+            if (expected_from == NULL) {
+                expected = result.live;
+                expected_from = engines[e].name;
+            }
+            else if (result.live != expected) {
+                fprintf(stderr, "  MISMATCH: %ld live cells, but %s had "
+                        "%ld\n", result.live, expected_from, expected);
+            }
+            report_run(report, board, gens, &engines[e], threads, &result);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *gol = "./gol_headless";
+    const char *out_path = NULL;
+    char soup_dir[] = "/tmp/gol_bench.XXXXXX";
+    double budget = 4e9;
+    int reps = 1, opt;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned long long seed = 1;
+    struct report report = {stdout, 0, 0};
+    glob_t tests;
+
+    if (threads < 2) {
+        threads = 2;
+    }
+    while ((opt = getopt(argc, argv, "qr:u:t:s:f:o:g:")) != -1) {
+        if (opt == 'q') {
+            budget = 2e8;
+        }
+        else if (opt == 'r') {
+            reps = atoi(optarg);
+        }
+        else if (opt == 'u') {
+            budget = atof(optarg);
+        }
+        else if (opt == 't') {
+            threads = atoi(optarg);
+        }
+        else if (opt == 's') {
+            seed = strtoull(optarg, NULL, 10);
+        }
+        else if (opt == 'f' && strcmp(optarg, "csv") == 0) {
+            report.json = 0;
+        }
+        else if (opt == 'f' && strcmp(optarg, "json") == 0) {
+            report.json = 1;
+        }
+        else if (opt == 'o') {
+            out_path = optarg;
+        }
+        else if (opt == 'g') {
+            gol = optarg;
+        }
+        else {
+            reps = 0;  // bad option: fall through to the usage message
+        }
+    }
+    if (optind != argc || reps < 1 || threads < 1 || budget <= 0) {
+        printf("usage: %s [-q] [-r reps] [-u updates] [-t nthreads] "
+                "[-s seed] [-f csv|json] [-o outfile] [-g path/to/gol]\n",
+                argv[0]);
+        exit(1);
+    }
+    if (access(gol, X_OK) != 0) {
+        perror(gol);
+        exit(1);
+    }
+    if (out_path != NULL) {
+        report.out = fopen(out_path, "w");
+        if (report.out == NULL) {
+            perror(out_path);
+            exit(1);
+        }
+    }
+    if (mkdtemp(soup_dir) == NULL) {
+        perror("mkdtemp");
+        exit(1);
+    }
+
+    report_start(&report);
+
+    //the random soups, each written just before it is run
+    for (int s = 0; s < NUM_SIZES; s++) {
+        int size = soup_sizes[s];
+
+        if ((double)size * size * generations[0] > budget) {
+            continue;
+        }
+        for (int d = 0; d < NUM_DENSITIES; d++) {
+            char path[4096];
+            struct board board;
+
+            snprintf(path, sizeof(path), "%s/soup.txt", soup_dir);
+            if (write_soup(&board, path, size, size, soup_densities[d],
+                        seed) == 0) {
+                bench_board(gol, &board, threads, reps, budget, &report);
+            }
+            unlink(path);
+        }
+    }
+    rmdir(soup_dir);
+
+    //the checked-in boards
+    if (glob("test_*.txt", 0, NULL, &tests) == 0) {
+        for (size_t t = 0; t < tests.gl_pathc; t++) {
+            struct board board;
+
+            if (read_board(&board, tests.gl_pathv[t]) == 0) {
+                bench_board(gol, &board, threads, reps, budget, &report);
+            }
+        }
+        globfree(&tests);
+    }
+
+    report_end(&report);
+    if (out_path != NULL) {
+        fclose(report.out);
+    }
+    return 0;
+}
@@ -0,0 +1,61 @@
+/*
+ * Bit-packed board storage for the Game Of Life.
+ * See bitgrid.h for the layout of a grid.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "bitgrid.h"
+#include "boardmem.h"
+
+/* allocate a zeroed rows x cols grid
+ * returns: 0 on success, 1 on error
+ */
+int bitgrid_init(struct bitgrid *grid, int rows, int cols) {
+    grid->rows = rows;
+    grid->cols = cols;
+    grid->words = (cols + 63) / 64;
+    grid->bits = boardmem_alloc((size_t)rows * grid->words * sizeof(uint64_t));
+    if (grid->bits == NULL) {
+        return 1;
+    }
+    return 0;
+}
+
+/* free the grid's storage */
+void bitgrid_free(struct bitgrid *grid) {
+    boardmem_free(grid->bits, (size_t)grid->rows * grid->words
+            * sizeof(uint64_t));
+    grid->bits = NULL;
+}
+
+/* set every cell of the grid to 0 (dead) */
+void bitgrid_clear(struct bitgrid *grid) {
+    memset(grid->bits, 0, (size_t)grid->rows * grid->words * sizeof(uint64_t));
+}
+
+/* return the number of live cells in the grid */
+long bitgrid_count(const struct bitgrid *grid) {
+    long count = 0;
+    long num_words = (long)grid->rows * grid->words;
+
+    for (long w = 0; w < num_words; w++) {
+        count += __builtin_popcountll(grid->bits[w]);
+    }
+    return count;
+}
+
+/* set the n cells (i, j) .. (i, j+n-1) to alive, a word at a time */
+void bitgrid_set_run(struct bitgrid *grid, int i, int j, int n) {
+    uint64_t *row = bitgrid_row(grid, i);
+
+    while (n > 0) {
+        int bit = j & 63;
+        int len = (n < 64 - bit) ? n : 64 - bit;
+        uint64_t mask = (len == 64) ? ~(uint64_t)0
+            : (((uint64_t)1 << len) - 1) << bit;
+
+        row[j >> 6] |= mask;
+        j += len;
+        n -= len;
+    }
+}
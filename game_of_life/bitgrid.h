@@ -0,0 +1,56 @@
+#ifndef __BITGRID_H__
+#define __BITGRID_H__
+
+#include <stdint.h>
+
+/* A bit-packed GOL board: one bit per cell, with every row padded out to a
+ * whole number of 64-bit words.  Cell (i, j) lives in bit (j % 64) of word
+ * (j / 64) of row i.  Padding bits past the last column are always 0.
+ */
+struct bitgrid {
+    int rows;        // the row dimension
+    int cols;        // the column dimension
+    int words;       // number of 64-bit words in each row
+    uint64_t *bits;  // rows * words words, row-major
+};
+
+/* allocate a zeroed rows x cols grid (see boardmem.h), returns 0 on
+ * success, 1 on error */
+int bitgrid_init(struct bitgrid *grid, int rows, int cols);
+
+/* free the grid's storage */
+void bitgrid_free(struct bitgrid *grid);
+
+/* set every cell of the grid to 0 (dead) */
+void bitgrid_clear(struct bitgrid *grid);
+
+/* return the number of live cells in the grid */
+long bitgrid_count(const struct bitgrid *grid);
+
+/* set the n cells (i, j) .. (i, j+n-1) to alive, a word at a time */
+void bitgrid_set_run(struct bitgrid *grid, int i, int j, int n);
+
+/* return a pointer to the first word of row i */
+static inline uint64_t *bitgrid_row(const struct bitgrid *grid, int i) {
+    return grid->bits + (long)i * grid->words;
+}
+
+/* return 1 if cell (i, j) is alive, 0 if not */
+static inline int bitgrid_get(const struct bitgrid *grid, int i, int j) {
+    return (bitgrid_row(grid, i)[j >> 6] >> (j & 63)) & 1;
+}
+
+/* set cell (i, j) to alive (1) or dead (0) */
+static inline void bitgrid_set(struct bitgrid *grid, int i, int j, int alive) {
+    uint64_t *word = &bitgrid_row(grid, i)[j >> 6];
+    uint64_t mask = (uint64_t)1 << (j & 63);
+
+    if (alive) {
+        *word |= mask;
+    }
+    else {
+        *word &= ~mask;
+    }
+}
+
+#endif  /* __BITGRID_H__ */
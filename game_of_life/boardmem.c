@@ -0,0 +1,87 @@
+/*
+ * Aligned, zero-filled board storage, optionally on huge pages.
+ * See boardmem.h for which buffers are mapped and how.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "boardmem.h"
+
+static int use_huge_pages;
+static atomic_long hugetlb_buffers;
+static atomic_long transparent_buffers;
+
+/* use huge pages for the buffers mapped from now on, or not */
+void boardmem_setup(int huge_pages) {
+    use_huge_pages = huge_pages;
+}
+
+/* return the size of the mapping for a buffer of bytes bytes (the same for
+ * a huge page mapping and the normal one it falls back to, so that a
+ * buffer can be unmapped knowing only its size) */
+static size_t mapped_size(size_t bytes) {
+    size_t unit = use_huge_pages ? BOARDMEM_HUGE_PAGE
+        : (size_t)sysconf(_SC_PAGESIZE);
+
+    return (bytes + unit - 1) / unit * unit;
+}
+
+/* return a zero-filled buffer of bytes bytes, or NULL if there's no room */
+void *boardmem_alloc(size_t bytes) {
+    size_t size;
+    void *buf;
+
+    if (bytes < BOARDMEM_MMAP_BYTES) {
+        size = (bytes + BOARDMEM_ALIGN - 1) / BOARDMEM_ALIGN * BOARDMEM_ALIGN;
+        buf = aligned_alloc(BOARDMEM_ALIGN, size ? size : BOARDMEM_ALIGN);
+        if (buf != NULL) {
+            memset(buf, 0, size);
+        }
+        return buf;
+    }
+
+    //fresh anonymous pages are already zero: no need to touch them here
+    size = mapped_size(bytes);
+#ifdef MAP_HUGETLB
+    if (use_huge_pages) {
+        buf = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (buf != MAP_FAILED) {
+            atomic_fetch_add(&hugetlb_buffers, 1);
+            return buf;
+        }
+    }
+#endif
+    buf = mmap(NULL, size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buf == MAP_FAILED) {
+        return NULL;
+    }
+#ifdef MADV_HUGEPAGE
+    if (use_huge_pages && madvise(buf, size, MADV_HUGEPAGE) == 0) {
+        atomic_fetch_add(&transparent_buffers, 1);
+    }
+#endif
+    return buf;
+}
+
+/* free a buffer that boardmem_alloc returned for bytes bytes (or NULL) */
+void boardmem_free(void *buf, size_t bytes) {
+    if (buf == NULL) {
+        return;
+    }
+    if (bytes < BOARDMEM_MMAP_BYTES) {
+        free(buf);
+    }
+    else {
+        munmap(buf, mapped_size(bytes));
+    }
+}
+
+/* return the number of buffers mapped on huge pages, of each kind */
+void boardmem_huge_counts(long *hugetlb, long *transparent) {
+    *hugetlb = atomic_load(&hugetlb_buffers);
+    *transparent = atomic_load(&transparent_buffers);
+}
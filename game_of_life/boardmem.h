@@ -0,0 +1,42 @@
+#ifndef __BOARDMEM_H__
+#define __BOARDMEM_H__
+
+#include <stddef.h>
+
+/* Storage for boards: every buffer comes back zero-filled and at least
+ * cache-line aligned, so that no two threads' rows share the line a buffer
+ * starts on.
+ *
+ * Small buffers come from aligned_alloc.  Buffers of BOARDMEM_MMAP_BYTES
+ * or more are mapped straight from the kernel: they are page-aligned and
+ * zero without being written, and a page is only placed in memory when it
+ * is first touched.  A thread that is the first to write its own block of
+ * rows therefore gets those pages on its own NUMA node (see play_gol).
+ *
+ * With huge pages turned on (--hugepages), mapped buffers are rounded up to
+ * whole 2 MB pages and taken from the MAP_HUGETLB pool if it has room, and
+ * otherwise from normal pages with transparent huge pages asked for
+ * (MADV_HUGEPAGE), cutting TLB misses on big boards.
+ *
+ * A buffer must be freed with the size it was allocated with.
+ */
+
+#define BOARDMEM_ALIGN       (64)          // alignment of small buffers
+#define BOARDMEM_MMAP_BYTES  (64 * 1024)   // smallest buffer that is mapped
+#define BOARDMEM_HUGE_PAGE   (2 * 1024 * 1024)
+
+/* use huge pages (1) or not (0) for the buffers mapped from now on; call it
+ * before allocating any board, and don't change it while any are mapped */
+void boardmem_setup(int huge_pages);
+
+/* return a zero-filled buffer of bytes bytes, or NULL if there's no room */
+void *boardmem_alloc(size_t bytes);
+
+/* free a buffer that boardmem_alloc returned for bytes bytes (or NULL) */
+void boardmem_free(void *buf, size_t bytes);
+
+/* return the number of buffers mapped from the MAP_HUGETLB pool, and with
+ * transparent huge pages asked for instead */
+void boardmem_huge_counts(long *hugetlb, long *transparent);
+
+#endif  /* __BOARDMEM_H__ */
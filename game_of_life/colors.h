@@ -1,7 +1,11 @@
 #ifndef __COLORS_H__
 #define __COLORS_H__
 
+#ifdef GOL_HEADLESS
+#include "novisi.h"
+#else
 #include <pthreadGridVisi.h>
+#endif
 
 /* This file defines some basic colors using RGB values. */
 
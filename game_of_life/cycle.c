@@ -0,0 +1,136 @@
+/*
+ * Still life and oscillator detection for the Game Of Life.
+ * See cycle.h for how a cycle is found and confirmed.
+ */
+#include <string.h>
+#include "cycle.h"
+
+#define RING(round)  ((round) & (CYCLE_HISTORY - 1))
+
+/* return a 64-bit hash of the board's cells, a word at a time */
+static uint64_t hash_board(const struct bitgrid *board) {
+    size_t num_words = (size_t)board->rows * board->words;
+    uint64_t h = 0x9E3779B97F4A7C15ull;
+
+    for (size_t w = 0; w < num_words; w++) {
+        h ^= board->bits[w] + 0x632BE59BD9B4E019ull + (h << 6) + (h >> 2);
+        h *= 0xFF51AFD7ED558CCDull;
+    }
+    return h ^ (h >> 33);
+}
+
+/* return the round of the ring with hash h, or -1 if there's none (any
+ * round older than round will do, but the latest is the one returned) */
+static int find_round(const struct cycle_detector *cycles, uint64_t h,
+        int round)
+{
+    const int *bucket = cycles->table[(h >> 32) % CYCLE_BUCKETS];
+    int found = -1;
+
+    for (int w = 0; w < CYCLE_WAYS; w++) {
+        int r = bucket[w];
+
+        //entries for rounds that have left the ring are stale
+        if (r >= cycles->first_round && r < round && r > found
+                && cycles->hashes[RING(r)] == h) {
+            found = r;
+        }
+    }
+    return found;
+}
+
+/* record that round had hash h, over a stale entry of the bucket, an older
+ * round with the same hash, or else the oldest round in it */
+static void add_round(struct cycle_detector *cycles, uint64_t h, int round) {
+    int *bucket = cycles->table[(h >> 32) % CYCLE_BUCKETS];
+    int victim = 0;
+
+    for (int w = 0; w < CYCLE_WAYS; w++) {
+        int r = bucket[w];
+
+        if (r < cycles->first_round || cycles->hashes[RING(r)] == h) {
+            victim = w;
+            break;
+        }
+        if (r < bucket[victim]) {
+            victim = w;
+        }
+    }
+    bucket[victim] = round;
+}
+
+/* set up a detector, see cycle.h
+ * returns: 0 on success, 1 on error
+ */
+int cycle_init(struct cycle_detector *cycles, int rows, int cols,
+        const struct bitgrid *board, int round)
+{
+    uint64_t h = hash_board(board);
+
+    memset(cycles, 0, sizeof(*cycles));
+    memset(cycles->table, -1, sizeof(cycles->table));
+    if (bitgrid_init(&cycles->saved, rows, cols) != 0) {
+        return 1;
+    }
+    cycles->first_round = cycles->last_round = round;
+    cycles->hashes[RING(round)] = h;
+    add_round(cycles, h, round);
+    return 0;
+}
+
+/* free the detector's saved board */
+void cycle_free(struct cycle_detector *cycles) {
+    bitgrid_free(&cycles->saved);
+}
+
+/* look at board as of round, see cycle.h
+ * returns: 1 if it confirms a cycle, 0 if not
+ */
+int cycle_check(struct cycle_detector *cycles, const struct bitgrid *board,
+        int round)
+{
+    uint64_t h = hash_board(board);
+    int found = 0;
+    int match;
+
+    cycles->last_round = round;
+    if (round - cycles->first_round >= CYCLE_HISTORY) {
+        cycles->first_round = round - CYCLE_HISTORY + 1;
+    }
+    cycles->hashes[RING(round)] = h;
+    match = find_round(cycles, h, round);
+    add_round(cycles, h, round);
+
+    if (cycles->candidate_period != 0) {
+        if (round < cycles->candidate_round + cycles->candidate_period) {
+            return 0;
+        }
+        //the candidate's period is up: does the board match it exactly?
+        if (memcmp(board->bits, cycles->saved.bits, (size_t)board->rows
+                    * board->words * sizeof(uint64_t)) == 0) {
+            int p = cycles->candidate_period;
+            int start = round - p;
+
+            while (start - 1 >= cycles->first_round
+                    && cycles->hashes[RING(start - 1)]
+                    == cycles->hashes[RING(start - 1 + p)]) {
+                start--;
+            }
+            cycles->period = p;
+            cycles->start = start;
+            cycles->confirmed = round;
+            found = 1;
+        }
+        cycles->candidate_period = 0;
+        return found;
+    }
+
+    //the latest round with the same hash gives the board's own period
+    if (match >= 0) {
+        memcpy(cycles->saved.bits, board->bits, (size_t)board->rows
+                * board->words * sizeof(uint64_t));
+        cycles->candidate_round = round;
+        cycles->candidate_period = round - match;
+    }
+    return 0;
+}
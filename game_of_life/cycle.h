@@ -0,0 +1,57 @@
+#ifndef __CYCLE_H__
+#define __CYCLE_H__
+
+#include <stdint.h>
+#include "bitgrid.h"
+
+/* Detection of boards that have settled into a cycle: still lifes (period
+ * 1, an empty board included), oscillators, and spaceships that come back
+ * around the torus, with periods of less than CYCLE_HISTORY rounds.  Once
+ * the board repeats, every later round is known, so the run can skip
+ * straight to the last one.
+ *
+ * Each round's board is hashed to 64 bits, and the hashes of the last
+ * CYCLE_HISTORY rounds are kept in a ring, along with a small table from
+ * hash to the latest round that had it, so that each round costs a lookup
+ * rather than a search of the ring.  When a round's hash matches the hash
+ * from p rounds before, the board is saved as a candidate, and p rounds
+ * later it is compared, cell for cell, with the board then: only an exact
+ * match is reported as a cycle, so a hash collision costs nothing but the
+ * copy.  The round where the cycle began is then found by walking the ring
+ * back for as long as each hash matches the one p rounds after it.
+ */
+
+#define CYCLE_HISTORY  (4096)  // rounds of hashes kept (a power of 2)
+#define CYCLE_BUCKETS  (2048)  // buckets of the hash to round table
+#define CYCLE_WAYS     (4)     // rounds each bucket holds
+
+struct cycle_detector {
+    uint64_t hashes[CYCLE_HISTORY];  // hash of round r at r % CYCLE_HISTORY
+    int table[CYCLE_BUCKETS][CYCLE_WAYS];  // rounds, by hash (-1: empty)
+    int first_round;      // oldest round whose hash is still in the ring
+    int last_round;       // newest round hashed
+    int candidate_round;  // round of the saved candidate board
+    int candidate_period; // period the candidate would have, or 0 if none
+    struct bitgrid saved; // the candidate board
+
+    int period;           // period of the cycle found, or 0 if none yet
+    int start;            // first round of the cycle (its board recurs)
+    int confirmed;        // round the cycle was confirmed at
+};
+
+/* set up a detector for rows x cols boards, starting from board as of
+ * round
+ * returns 0 on success, 1 on error */
+int cycle_init(struct cycle_detector *cycles, int rows, int cols,
+        const struct bitgrid *board, int round);
+
+/* free the detector's saved board */
+void cycle_free(struct cycle_detector *cycles);
+
+/* look at board as of round (the round after the last one looked at)
+ * returns 1 if it confirms a cycle (see cycles->period and ->start), 0 if
+ * not */
+int cycle_check(struct cycle_detector *cycles, const struct bitgrid *board,
+        int round);
+
+#endif  /* __CYCLE_H__ */
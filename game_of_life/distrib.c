@@ -0,0 +1,507 @@
+/*
+ * Distributed engine for the Game Of Life, on MPI.
+ * See distrib.h for how the board is cut up and the halos exchanged.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "distrib.h"
+#include "loader.h"
+#include "snapshot.h"
+
+/* the direction opposite each one, and the step in the grid of ranks that
+ * each one takes */
+static const int opposite[NUM_DIRS] = {DIR_S, DIR_N, DIR_E, DIR_W,
+    DIR_SE, DIR_SW, DIR_NE, DIR_NW};
+static const int dir_rows[NUM_DIRS] = {-1, 1, 0, 0, -1, -1, 1, 1};
+static const int dir_cols[NUM_DIRS] = {0, 0, -1, 1, -1, 1, -1, 1};
+
+/* return 1 if any rank's failed is nonzero, 0 if none is */
+static int any_failed(MPI_Comm comm, int failed) {
+    MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_LOR, comm);
+    return failed;
+}
+
+/* set dims to the grid of num_ranks ranks, down and across, that gives
+ * each block the shortest edges, with at least a row and a word of the
+ * board in every block
+ * returns: 0 on success, 1 if there are too many ranks for the board */
+static int pick_dims(int num_ranks, int rows, int words, int dims[2]) {
+    double best = -1;
+
+    for (int across = 1; across <= num_ranks; across++) {
+        int down = num_ranks / across;
+        double edges = (double)words * 64 / across + (double)rows / down;
+
+        if (num_ranks % across != 0 || across > words || down > rows) {
+            continue;
+        }
+        if (best < 0 || edges < best) {
+            best = edges;
+            dims[0] = down;
+            dims[1] = across;
+        }
+    }
+    return best < 0;
+}
+
+/* return the number of 64-bit words of the board's rows in d's block */
+static int slice_words(const struct distrib *d) {
+    return (d->block_cols + 63) / 64;
+}
+
+/* set up this rank's block, see distrib.h
+ * returns: 0 on success, 1 on error
+ */
+int distrib_init(struct distrib *d, MPI_Comm comm, int rows, int cols) {
+    int periods[2] = {1, 1};
+    int rank, first_word, end_word, col_end;
+    int failed;
+
+    memset(d, 0, sizeof(*d));
+    d->comm = MPI_COMM_NULL;
+    d->rows = rows;
+    d->cols = cols;
+    d->words = (cols + 63) / 64;
+    MPI_Comm_size(comm, &d->num_ranks);
+    MPI_Comm_rank(comm, &rank);
+    if (pick_dims(d->num_ranks, rows, d->words, d->dims) != 0) {
+        if (rank == 0) {
+            printf("Error: %d ranks are too many for a %d x %d board\n",
+                    d->num_ranks, rows, cols);
+        }
+        return 1;
+    }
+
+    //let MPI place neighboring blocks on nearby ranks if it can
+    MPI_Cart_create(comm, 2, d->dims, periods, 1, &d->comm);
+    MPI_Comm_rank(d->comm, &d->rank);
+    MPI_Cart_coords(d->comm, d->rank, 2, d->coords);
+    for (int dir = 0; dir < NUM_DIRS; dir++) {
+        //coordinates off the grid wrap around, as the board does
+        int coords[2] = {d->coords[0] + dir_rows[dir],
+            d->coords[1] + dir_cols[dir]};
+
+        MPI_Cart_rank(d->comm, coords, &d->neighbors[dir]);
+    }
+
+    //rows are shared out evenly, columns a whole word at a time
+    d->row_start = (long)d->coords[0] * rows / d->dims[0];
+    d->block_rows = (long)(d->coords[0] + 1) * rows / d->dims[0]
+        - d->row_start;
+    first_word = (long)d->coords[1] * d->words / d->dims[1];
+    end_word = (long)(d->coords[1] + 1) * d->words / d->dims[1];
+    col_end = (end_word * 64 < cols) ? end_word * 64 : cols;
+    d->col_start = first_word * 64;
+    d->block_cols = col_end - d->col_start;
+
+    d->col_words = (d->block_rows + 63) / 64;
+    failed = bitgrid_init(&d->board, d->block_rows + 2, d->block_cols + 2)
+        || bitgrid_init(&d->next, d->block_rows + 2, d->block_cols + 2);
+    for (int side = 0; side < 2 && !failed; side++) {
+        d->send_cols[side] = calloc(d->col_words, sizeof(uint64_t));
+        d->recv_cols[side] = calloc(d->col_words, sizeof(uint64_t));
+        failed = d->send_cols[side] == NULL || d->recv_cols[side] == NULL;
+    }
+    if (!failed) {
+        d->slice = malloc((size_t)d->block_rows * slice_words(d)
+                * sizeof(uint64_t));
+        failed = d->slice == NULL;
+    }
+    if (any_failed(d->comm, failed)) {
+        if (d->rank == 0) {
+            printf("Error: Failure to allocate board.\n");
+        }
+        distrib_free(d);
+        return 1;
+    }
+    return 0;
+}
+
+/* free d's storage and its communicator */
+void distrib_free(struct distrib *d) {
+    bitgrid_free(&d->board);
+    bitgrid_free(&d->next);
+    for (int side = 0; side < 2; side++) {
+        free(d->send_cols[side]);
+        free(d->recv_cols[side]);
+        d->send_cols[side] = d->recv_cols[side] = NULL;
+    }
+    free(d->slice);
+    d->slice = NULL;
+    if (d->comm != MPI_COMM_NULL) {
+        MPI_Comm_free(&d->comm);
+    }
+}
+
+/* copy the slice (the block's words of its rows of the board) into the
+ * block, one column over to make room for the halo */
+static void unpack_slice(struct distrib *d) {
+    int n = slice_words(d);
+
+    for (int i = 0; i < d->block_rows; i++) {
+        const uint64_t *in = d->slice + (size_t)i * n;
+        uint64_t *out = bitgrid_row(&d->board, i + 1);
+
+        for (int k = 0; k < n; k++) {
+            out[k] = (in[k] << 1) | (k > 0 ? in[k-1] >> 63 : 0);
+        }
+        if (d->board.words > n) {
+            out[n] = in[n-1] >> 63;
+        }
+        //the halo columns get filled in by the first round's exchange
+        out[0] &= ~(uint64_t)1;
+    }
+}
+
+/* copy the block's cells, without the halo, into the slice */
+static void pack_slice(struct distrib *d) {
+    int n = slice_words(d);
+    int words = d->board.words;
+
+    for (int i = 0; i < d->block_rows; i++) {
+        const uint64_t *in = bitgrid_row(&d->board, i + 1);
+        uint64_t *out = d->slice + (size_t)i * n;
+
+        for (int k = 0; k < n; k++) {
+            out[k] = (in[k] >> 1) | (k + 1 < words ? in[k+1] << 63 : 0);
+        }
+        if ((d->block_cols & 63) != 0) {
+            out[n-1] &= ((uint64_t)1 << (d->block_cols & 63)) - 1;
+        }
+    }
+}
+
+/* return an MPI type for d's words of its rows of a snapshot's board (the
+ * caller frees it) */
+static MPI_Datatype slice_type(struct distrib *d) {
+    int sizes[2] = {d->rows, d->words};
+    int subsizes[2] = {d->block_rows, slice_words(d)};
+    int starts[2] = {d->row_start, d->col_start / 64};
+    MPI_Datatype type;
+
+    MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C,
+            MPI_UINT64_T, &type);
+    MPI_Type_commit(&type);
+    return type;
+}
+
+/* set d up from the snapshot at path, each rank reading its own slice
+ * returns: 0 on success, 1 on error */
+static int load_snapshot(struct distrib *d, MPI_Comm comm, const char *path,
+        const struct life_rule *rule, int *iters, int *round)
+{
+    struct snapshot_header header;
+    struct life_rule recorded;
+    MPI_File file;
+    MPI_Offset size;
+    MPI_Datatype type;
+    int rank, failed;
+
+    MPI_Comm_rank(comm, &rank);
+    if (MPI_File_open(comm, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &file)
+            != MPI_SUCCESS) {
+        if (rank == 0) {
+            printf("Error: Failure to open file.\n");
+        }
+        return 1;
+    }
+    failed = MPI_File_read_at_all(file, 0, &header, sizeof(header), MPI_BYTE,
+            MPI_STATUS_IGNORE) != MPI_SUCCESS
+        || MPI_File_get_size(file, &size) != MPI_SUCCESS
+        || memcmp(header.magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN) != 0
+        || header.rows < 1 || header.cols < 1
+        || header.words != (header.cols + 63) / 64
+        || header.round < 0 || header.round > header.iters
+        || size != (MPI_Offset)(sizeof(header)
+                + (size_t)header.rows * header.words * sizeof(uint64_t));
+    if (any_failed(comm, failed)) {
+        if (rank == 0) {
+            printf("Error: %s is not a snapshot this program can read\n",
+                    path);
+        }
+        MPI_File_close(&file);
+        return 1;
+    }
+    //every rank read the same header, so they all agree on this
+    if (!snapshot_rule_matches(&header, rule, &recorded)) {
+        if (rank == 0) {
+            printf("Error: %s was played under %s: resume it with "
+                    "--rule=%s\n", path, recorded.name, recorded.name);
+        }
+        MPI_File_close(&file);
+        return 1;
+    }
+    if (distrib_init(d, comm, header.rows, header.cols) != 0) {
+        MPI_File_close(&file);
+        return 1;
+    }
+
+    type = slice_type(d);
+    failed = MPI_File_set_view(file, sizeof(header), MPI_UINT64_T, type,
+            "native", MPI_INFO_NULL) != MPI_SUCCESS
+        || MPI_File_read_all(file, d->slice, d->block_rows * slice_words(d),
+                MPI_UINT64_T, MPI_STATUS_IGNORE) != MPI_SUCCESS;
+    MPI_Type_free(&type);
+    MPI_File_close(&file);
+    if (any_failed(d->comm, failed)) {
+        if (d->rank == 0) {
+            printf("Error: Failure to read snapshot %s.\n", path);
+        }
+        distrib_free(d);
+        return 1;
+    }
+    unpack_slice(d);
+    *iters = header.iters;
+    *round = header.round;
+    return 0;
+}
+
+/* set d up from the board file at path, each rank keeping the cells in its
+ * own block
+ * returns: 0 on success, 1 on error */
+static int load_board_file(struct distrib *d, MPI_Comm comm,
+        const char *path, int *iters)
+{
+    struct board_file file;
+    int last_row, last_col;
+
+    if (any_failed(comm, board_load(path, &file, 1))) {
+        return 1;
+    }
+    if (distrib_init(d, comm, file.rows, file.cols) != 0) {
+        board_file_free(&file);
+        return 1;
+    }
+    last_row = d->row_start + d->block_rows;
+    last_col = d->col_start + d->block_cols;
+    for (long c = 0; c < file.num_alive; c++) {
+        int i = file.cells[2*c];
+        int j = file.cells[2*c + 1];
+
+        if (i >= d->row_start && i < last_row
+                && j >= d->col_start && j < last_col) {
+            bitgrid_set(&d->board, i - d->row_start + 1,
+                    j - d->col_start + 1, 1);
+        }
+    }
+    *iters = file.iters;
+    board_file_free(&file);
+    return 0;
+}
+
+/* set d up from a board file or a snapshot, see distrib.h
+ * returns: 0 on success, 1 on error
+ */
+int distrib_load(struct distrib *d, MPI_Comm comm, const char *path,
+        const struct life_rule *rule, int *iters, int *round)
+{
+    *round = 0;
+    if (snapshot_check(path)) {
+        return load_snapshot(d, comm, path, rule, iters, round);
+    }
+    return load_board_file(d, comm, path, iters);
+}
+
+/* pack the block's edge columns and corners, and post the sends of them
+ * and the edge rows to the neighbors, and the receives of theirs: the rows
+ * straight into the halo rows, which the inside of the block never reads
+ * (requests gets 2 * NUM_DIRS requests) */
+static void post_halos(struct distrib *d, MPI_Request *requests) {
+    struct bitgrid *board = &d->board;
+    int last_row = d->block_rows;
+    int last_col = d->block_cols;
+    int words = board->words;
+    int n = 0;
+
+    memset(d->send_cols[0], 0, d->col_words * sizeof(uint64_t));
+    memset(d->send_cols[1], 0, d->col_words * sizeof(uint64_t));
+    for (int i = 0; i < d->block_rows; i++) {
+        d->send_cols[0][i >> 6] |= (uint64_t)bitgrid_get(board, i + 1, 1)
+            << (i & 63);
+        d->send_cols[1][i >> 6] |= (uint64_t)bitgrid_get(board, i + 1,
+                last_col) << (i & 63);
+    }
+    d->send_corners[0] = bitgrid_get(board, 1, 1);
+    d->send_corners[1] = bitgrid_get(board, 1, last_col);
+    d->send_corners[2] = bitgrid_get(board, last_row, 1);
+    d->send_corners[3] = bitgrid_get(board, last_row, last_col);
+
+    //each message is tagged with the direction it travels in, and comes in
+    //from the neighbor on the opposite side
+    MPI_Irecv(bitgrid_row(board, last_row + 1), words, MPI_UINT64_T,
+            d->neighbors[DIR_S], DIR_N, d->comm, &requests[n++]);
+    MPI_Irecv(bitgrid_row(board, 0), words, MPI_UINT64_T,
+            d->neighbors[DIR_N], DIR_S, d->comm, &requests[n++]);
+    MPI_Irecv(d->recv_cols[1], d->col_words, MPI_UINT64_T,
+            d->neighbors[DIR_E], DIR_W, d->comm, &requests[n++]);
+    MPI_Irecv(d->recv_cols[0], d->col_words, MPI_UINT64_T,
+            d->neighbors[DIR_W], DIR_E, d->comm, &requests[n++]);
+    for (int c = 0; c < 4; c++) {
+        int dir = DIR_NW + c;
+
+        //the corner sent NW comes back as the SE halo corner, and so on
+        MPI_Irecv(&d->recv_corners[3 - c], 1, MPI_UNSIGNED_CHAR,
+                d->neighbors[opposite[dir]], dir, d->comm, &requests[n++]);
+    }
+
+    MPI_Isend(bitgrid_row(board, 1), words, MPI_UINT64_T,
+            d->neighbors[DIR_N], DIR_N, d->comm, &requests[n++]);
+    MPI_Isend(bitgrid_row(board, last_row), words, MPI_UINT64_T,
+            d->neighbors[DIR_S], DIR_S, d->comm, &requests[n++]);
+    MPI_Isend(d->send_cols[0], d->col_words, MPI_UINT64_T,
+            d->neighbors[DIR_W], DIR_W, d->comm, &requests[n++]);
+    MPI_Isend(d->send_cols[1], d->col_words, MPI_UINT64_T,
+            d->neighbors[DIR_E], DIR_E, d->comm, &requests[n++]);
+    for (int c = 0; c < 4; c++) {
+        MPI_Isend(&d->send_corners[c], 1, MPI_UNSIGNED_CHAR,
+                d->neighbors[DIR_NW + c], DIR_NW + c, d->comm,
+                &requests[n++]);
+    }
+}
+
+/* fill in the halo columns and corners from the messages received (the
+ * halo rows came in already, with stale corners) */
+static void fill_halos(struct distrib *d) {
+    struct bitgrid *board = &d->board;
+    int last_row = d->block_rows;
+    int halo_col = d->block_cols + 1;
+
+    for (int i = 0; i < d->block_rows; i++) {
+        bitgrid_set(board, i + 1, 0, (d->recv_cols[0][i >> 6] >> (i & 63)) & 1);
+        bitgrid_set(board, i + 1, halo_col,
+                (d->recv_cols[1][i >> 6] >> (i & 63)) & 1);
+    }
+    bitgrid_set(board, 0, 0, d->recv_corners[0]);
+    bitgrid_set(board, 0, halo_col, d->recv_corners[1]);
+    bitgrid_set(board, last_row + 1, 0, d->recv_corners[2]);
+    bitgrid_set(board, last_row + 1, halo_col, d->recv_corners[3]);
+}
+
+/* play one round, see distrib.h
+ * returns: the number of live cells after it if count is nonzero, or 0
+ */
+long distrib_step(struct distrib *d, const struct swar_rule *kernel,
+        int count)
+{
+    MPI_Request requests[2 * NUM_DIRS];
+    struct bitgrid temp;
+    int last_row = d->block_rows;
+    int words = d->board.words;
+    int east = d->block_cols >> 6;  // the word holding the east edge column
+
+    post_halos(d, requests);
+
+    //the inside rows: all but their edge columns, which read the stale
+    //halo columns, come out right
+    if (last_row > 2) {
+        swar_rule_step(kernel, &d->board, &d->next, 2, last_row, 0, words,
+                0);
+    }
+    MPI_Waitall(2 * NUM_DIRS, requests, MPI_STATUSES_IGNORE);
+    fill_halos(d);
+
+    //the edge rows, then the edge columns of the inside rows over again
+    swar_rule_step(kernel, &d->board, &d->next, 1, 2, 0, words, 0);
+    if (last_row > 1) {
+        swar_rule_step(kernel, &d->board, &d->next, last_row, last_row + 1,
+                0, words, 0);
+    }
+    if (last_row > 2) {
+        swar_rule_step(kernel, &d->board, &d->next, 2, last_row, 0, 1, 0);
+        if (east > 0) {
+            swar_rule_step(kernel, &d->board, &d->next, 2, last_row, east,
+                    east + 1, 0);
+        }
+    }
+
+    temp = d->board;
+    d->board = d->next;
+    d->next = temp;
+    return count ? distrib_count(d) : 0;
+}
+
+/* return the number of live cells on the whole board */
+long distrib_count(struct distrib *d) {
+    int halo_col = d->block_cols + 1;
+    long live = 0;
+
+    for (int i = 1; i <= d->block_rows; i++) {
+        const uint64_t *row = bitgrid_row(&d->board, i);
+
+        for (int k = 0; k < d->board.words; k++) {
+            live += __builtin_popcountll(row[k]);
+        }
+        //the halo cells aren't this block's to count
+        live -= (row[0] & 1) + bitgrid_get(&d->board, i, halo_col);
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &live, 1, MPI_LONG, MPI_SUM, d->comm);
+    return live;
+}
+
+/* write the board to a snapshot at path, see distrib.h
+ * returns: 0 on success, 1 on error
+ */
+int distrib_save(struct distrib *d, const char *path,
+        const struct life_rule *rule, int iters, int round)
+{
+    struct snapshot_header header;
+    char *temp_path = malloc(strlen(path) + sizeof(".tmp"));
+    MPI_File file;
+    MPI_Datatype type;
+    long live = distrib_count(d);
+    int failed;
+
+    if (any_failed(d->comm, temp_path == NULL)) {
+        free(temp_path);
+        return 1;
+    }
+    sprintf(temp_path, "%s.tmp", path);
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN);
+    header.rows = d->rows;
+    header.cols = d->cols;
+    header.iters = iters;
+    header.round = round;
+    header.live = live;
+    header.words = d->words;
+    snapshot_set_rule(&header, rule);
+    pack_slice(d);
+
+    if (MPI_File_open(d->comm, temp_path, MPI_MODE_WRONLY | MPI_MODE_CREATE,
+                MPI_INFO_NULL, &file) != MPI_SUCCESS) {
+        if (d->rank == 0) {
+            printf("Error: Failure to write snapshot %s.\n", path);
+        }
+        free(temp_path);
+        return 1;
+    }
+    type = slice_type(d);
+    failed = MPI_File_set_size(file, sizeof(header)
+            + (MPI_Offset)d->rows * d->words * sizeof(uint64_t))
+        != MPI_SUCCESS;
+    if (d->rank == 0 && !failed) {
+        failed = MPI_File_write_at(file, 0, &header, sizeof(header), MPI_BYTE,
+                MPI_STATUS_IGNORE) != MPI_SUCCESS;
+    }
+    failed |= MPI_File_set_view(file, sizeof(header), MPI_UINT64_T, type,
+            "native", MPI_INFO_NULL) != MPI_SUCCESS;
+    failed |= MPI_File_write_all(file, d->slice,
+            d->block_rows * slice_words(d), MPI_UINT64_T,
+            MPI_STATUS_IGNORE) != MPI_SUCCESS;
+    failed |= MPI_File_sync(file) != MPI_SUCCESS;
+    MPI_Type_free(&type);
+    MPI_File_close(&file);
+
+    //rename only once every rank's slice is in the file
+    failed = any_failed(d->comm, failed);
+    if (d->rank == 0 && !failed) {
+        failed = rename(temp_path, path) != 0;
+    }
+    MPI_Bcast(&failed, 1, MPI_INT, 0, d->comm);
+    if (failed && d->rank == 0) {
+        printf("Error: Failure to write snapshot %s.\n", path);
+    }
+    free(temp_path);
+    return failed;
+}
@@ -0,0 +1,102 @@
+#ifndef __DISTRIB_H__
+#define __DISTRIB_H__
+
+#include <stdint.h>
+#include <mpi.h>
+#include "swar.h"
+#include "rule.h"
+
+/* Distributed engine for boards too big for one machine (gol_mpi).
+ *
+ * The torus is cut into a dims[0] x dims[1] grid of blocks, one per MPI
+ * rank, on a periodic Cartesian communicator.  Each rank keeps only its
+ * own block, as a bitgrid with a one-cell halo ring around it: local cell
+ * (i+1, j+1) is cell (row_start+i, col_start+j) of the board.  Blocks start
+ * on whole 64-bit words of the board's rows, so that a rank's share of a
+ * snapshot is a run of whole words in each of its rows.
+ *
+ * Each round, a rank posts non-blocking sends of its edge rows, its edge
+ * columns (packed a bit per row) and its four corner cells to its eight
+ * neighbors, and receives theirs, straight into its halo rows for the rows.
+ * It plays the inside of its block while those are in flight, since the
+ * inside doesn't need the halo, then waits for them, fills in the halo
+ * columns and corners, and plays its edge rows and the two words of each
+ * row that hold its edge columns.  Live cells are added up across the ranks
+ * with MPI_Allreduce, only on rounds that need the count.
+ *
+ * Input is read in parallel: from a snapshot, each rank reads its own
+ * words of each of its rows with collective MPI-IO, and from a board file,
+ * each rank parses the file (see loader.h) and keeps the cells in its
+ * block.  Snapshots are written the same way, each rank writing its words
+ * of one shared file, in the format of snapshot.h.
+ */
+
+/* the eight neighbors of a block, indexes into distrib.neighbors */
+#define DIR_N   (0)
+#define DIR_S   (1)
+#define DIR_W   (2)
+#define DIR_E   (3)
+#define DIR_NW  (4)
+#define DIR_NE  (5)
+#define DIR_SW  (6)
+#define DIR_SE  (7)
+#define NUM_DIRS  (8)
+
+struct distrib {
+    MPI_Comm comm;       // the periodic grid of ranks
+    int rank;            // this rank, in comm
+    int num_ranks;       // number of ranks in comm
+    int dims[2];         // ranks down and across the board
+    int coords[2];       // this rank's row and column in the grid of ranks
+    int neighbors[NUM_DIRS];  // ranks of the blocks around this one
+
+    int rows;            // the row dimension of the whole board
+    int cols;            // the column dimension of the whole board
+    int words;           // 64-bit words in each row of the whole board
+    int row_start;       // first row of the board in this block
+    int block_rows;      // rows in this block
+    int col_start;       // first column in this block (a multiple of 64)
+    int block_cols;      // columns in this block
+
+    struct bitgrid board;  // the block, with its halo ring
+    struct bitgrid next;   // next round's block
+    int col_words;         // 64-bit words in a packed column of the block
+    uint64_t *send_cols[2];  // this block's west and east edge columns
+    uint64_t *recv_cols[2];  // the halo columns to its west and east
+    unsigned char send_corners[4];  // its NW, NE, SW and SE corner cells
+    unsigned char recv_corners[4];  // the halo corners, in the same order
+    uint64_t *slice;       // a block's worth of words, for snapshots
+};
+
+/* set up d as this rank's block of a rows x cols board, all dead, on a
+ * grid of comm's ranks
+ * returns 0 on success, 1 on error (on every rank alike) */
+int distrib_init(struct distrib *d, MPI_Comm comm, int rows, int cols);
+
+/* free d's storage and its communicator */
+void distrib_free(struct distrib *d);
+
+/* set d up from the board file or snapshot at path (see distrib_init),
+ * with iters set to the rounds to play in all and round to the rounds
+ * already played (0 for a board file), to be played under rule
+ * returns 0 on success, 1 on error, or if the snapshot was played under
+ * another rule (on every rank alike) */
+int distrib_load(struct distrib *d, MPI_Comm comm, const char *path,
+        const struct life_rule *rule, int *iters, int *round);
+
+/* play one round with kernel
+ * returns the number of live cells on the whole board after it if count is
+ * nonzero, or 0 */
+long distrib_step(struct distrib *d, const struct swar_rule *kernel,
+        int count);
+
+/* return the number of live cells on the whole board */
+long distrib_count(struct distrib *d);
+
+/* write the board to a snapshot at path, as the board after round of
+ * iters played under rule, by way of a temporary file renamed over it
+ * returns 0 on success, 1 on error (on every rank alike) */
+int distrib_save(struct distrib *d, const char *path,
+        const struct life_rule *rule, int iters, int round);
+
+#endif  /* __DISTRIB_H__ */
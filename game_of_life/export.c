@@ -0,0 +1,361 @@
+/*
+ * Headless export of the rounds, by a pool of encoder threads.
+ * See export.h for the targets and how frames reach the encoders.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "export.h"
+#include "snapshot.h"
+
+/* The states of a slot, as it goes round */
+#define SLOT_FREE      (0)   // waiting for a round
+#define SLOT_FILLING   (1)   // handed out by export_begin
+#define SLOT_QUEUED    (2)   // waiting for an encoder
+#define SLOT_ENCODING  (3)   // being encoded and written
+
+#define PPM_HEADER_MAX  (32)   // longest "P6\nW H\n255\n" header
+
+/* return 1 if target is a file name pattern with a single %d conversion
+ * (with an optional width, as %06d), 0 if not */
+static int is_pattern(const char *target) {
+    const char *p = strchr(target, '%');
+
+    if (p == NULL) {
+        return 0;
+    }
+    p++;
+    while (*p >= '0' && *p <= '9') {
+        p++;
+    }
+    return *p == 'd' && strchr(p, '%') == NULL;
+}
+
+/* paint slot's board into the worker's image and lay it out as a PPM
+ * file, top row first, in the worker's out buffer */
+static void encode_ppm(struct exporter *exporter,
+        struct export_worker *worker, const struct export_slot *slot)
+{
+    const struct paint_view *view = &exporter->view;
+    size_t row_bytes = (size_t)view->image_cols * sizeof(struct rgb);
+    int header = sprintf((char *)worker->out, "P6\n%d %d\n255\n",
+            view->image_cols, view->image_rows);
+    unsigned char *out = worker->out + header;
+
+    paint_view(exporter->lut, view, &slot->board, worker->image);
+    //the image is stored bottom row first, like the ParaVisi buffer
+    for (int y = view->image_rows - 1; y >= 0; y--) {
+        memcpy(out, worker->image + (long)y * view->image_cols, row_bytes);
+        out += row_bytes;
+    }
+}
+
+/* write slot's board to the raw stream as a snapshot
+ * returns: 0 on success, 1 on error */
+static int write_raw(struct exporter *exporter,
+        const struct export_slot *slot)
+{
+    const struct bitgrid *board = &slot->board;
+    struct snapshot_header header;
+    size_t words = (size_t)board->rows * board->words;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN);
+    header.rows = board->rows;
+    header.cols = board->cols;
+    header.words = board->words;
+    header.iters = exporter->iters;
+    header.round = slot->round;
+    header.live = bitgrid_count(board);
+    snapshot_set_rule(&header, exporter->rule);
+    return fwrite(&header, sizeof(header), 1, exporter->stream) != 1
+        || fwrite(board->bits, sizeof(uint64_t), words, exporter->stream)
+        != words;
+}
+
+/* write the PPM frame in the worker's out buffer to its own file, named
+ * for slot's round
+ * returns: 0 on success, 1 on error */
+static int write_ppm_file(struct exporter *exporter,
+        const struct export_worker *worker, const struct export_slot *slot)
+{
+    char name[4096];
+    FILE *file;
+    int ret;
+
+    snprintf(name, sizeof(name), exporter->target, slot->round);
+    file = fopen(name, "wb");
+    if (file == NULL) {
+        return 1;
+    }
+    ret = fwrite(worker->out, 1, exporter->ppm_size, file)
+        != exporter->ppm_size;
+    if (fclose(file) != 0) {
+        ret = 1;
+    }
+    return ret;
+}
+
+/* return the queued slot that is first in the output, or NULL if none is
+ * queued (called with the lock held) */
+static struct export_slot *first_queued(struct exporter *exporter) {
+    struct export_slot *first = NULL;
+
+    for (int s = 0; s < exporter->num_slots; s++) {
+        struct export_slot *slot = &exporter->slots[s];
+
+        if (slot->state == SLOT_QUEUED
+                && (first == NULL || slot->seq < first->seq)) {
+            first = slot;
+        }
+    }
+    return first;
+}
+
+/* an encoder thread: takes the queued frames in order, encodes them and
+ * writes them out (to a stream or pipe only once every frame before them
+ * has been), until stopped with none left queued */
+static void *export_main(void *arg) {
+    struct export_worker *worker = arg;
+    struct exporter *exporter = worker->exporter;
+
+    pthread_mutex_lock(&exporter->lock);
+    while (1) {
+        struct export_slot *slot;
+        int ret;
+
+        while ((slot = first_queued(exporter)) == NULL
+                && !exporter->stopping) {
+            pthread_cond_wait(&exporter->work, &exporter->lock);
+        }
+        if (slot == NULL) {
+            break;
+        }
+        slot->state = SLOT_ENCODING;
+        pthread_mutex_unlock(&exporter->lock);
+
+        if (exporter->format != EXPORT_RAW) {
+            encode_ppm(exporter, worker, slot);
+        }
+        if (exporter->format == EXPORT_PPM) {
+            ret = write_ppm_file(exporter, worker, slot);
+            pthread_mutex_lock(&exporter->lock);
+        }
+        else {
+            //wait for the frames before this one to be written
+            pthread_mutex_lock(&exporter->lock);
+            while (exporter->next_write != slot->seq) {
+                pthread_cond_wait(&exporter->turn, &exporter->lock);
+            }
+            pthread_mutex_unlock(&exporter->lock);
+            if (exporter->format == EXPORT_RAW) {
+                ret = write_raw(exporter, slot);
+            }
+            else {
+                ret = fwrite(worker->out, 1, exporter->ppm_size,
+                        exporter->stream) != exporter->ppm_size;
+            }
+            pthread_mutex_lock(&exporter->lock);
+            exporter->next_write++;
+            pthread_cond_broadcast(&exporter->turn);
+        }
+        if (ret != 0) {
+            exporter->failed++;
+        }
+        else {
+            exporter->written++;
+        }
+        slot->state = SLOT_FREE;
+        pthread_cond_signal(&exporter->freed);
+    }
+    pthread_mutex_unlock(&exporter->lock);
+    return NULL;
+}
+
+/* free what export_start allocated (with no encoder threads running) */
+static void free_exporter(struct exporter *exporter) {
+    for (int s = 0; s < exporter->num_slots; s++) {
+        bitgrid_free(&exporter->slots[s].board);
+    }
+    for (int w = 0; w < exporter->num_workers; w++) {
+        free(exporter->workers[w].image);
+        free(exporter->workers[w].out);
+    }
+    free(exporter->slots);
+    free(exporter->workers);
+    exporter->slots = NULL;
+    exporter->workers = NULL;
+}
+
+/* start the encoder threads, see export.h
+ * returns: 0 on success, 1 on error
+ */
+int export_start(struct exporter *exporter, const char *target, int rows,
+        int cols, int iters, const struct life_rule *rule,
+        const struct paint_view *view, const struct paint_lut *lut,
+        int num_threads)
+{
+    size_t pixels = (size_t)view->image_rows * view->image_cols;
+    int started = 0;
+
+    memset(exporter, 0, sizeof(*exporter));
+    exporter->target = target;
+    exporter->rows = rows;
+    exporter->cols = cols;
+    exporter->iters = iters;
+    exporter->rule = rule;
+    exporter->view = *view;
+    exporter->lut = lut;
+    exporter->format = (target[0] == '|') ? EXPORT_PIPE
+        : is_pattern(target) ? EXPORT_PPM : EXPORT_RAW;
+    exporter->ppm_size = snprintf(NULL, 0, "P6\n%d %d\n255\n",
+            view->image_cols, view->image_rows) + pixels * sizeof(struct rgb);
+    if (strchr(target, '%') != NULL && exporter->format == EXPORT_RAW) {
+        printf("Error: --export=%s: a file name pattern takes a single %%d "
+                "for the round\n", target);
+        return 1;
+    }
+
+    //a slot for each encoder, and two for the rounds to keep filling
+    exporter->num_slots = num_threads + 2;
+    exporter->num_workers = num_threads;
+    exporter->slots = calloc(exporter->num_slots, sizeof(*exporter->slots));
+    exporter->workers = calloc(num_threads, sizeof(*exporter->workers));
+    if (exporter->slots == NULL || exporter->workers == NULL) {
+        printf("Error: Failure to allocate the export slots.\n");
+        free_exporter(exporter);
+        return 1;
+    }
+    for (int s = 0; s < exporter->num_slots; s++) {
+        if (bitgrid_init(&exporter->slots[s].board, rows, cols) != 0) {
+            printf("Error: Failure to allocate the export slots.\n");
+            free_exporter(exporter);
+            return 1;
+        }
+    }
+    for (int w = 0; w < num_threads && exporter->format != EXPORT_RAW; w++) {
+        exporter->workers[w].image = malloc(pixels * sizeof(struct rgb));
+        exporter->workers[w].out = malloc(PPM_HEADER_MAX
+                + pixels * sizeof(struct rgb));
+        if (exporter->workers[w].image == NULL
+                || exporter->workers[w].out == NULL) {
+            printf("Error: Failure to allocate the export images.\n");
+            free_exporter(exporter);
+            return 1;
+        }
+    }
+
+    if (exporter->format == EXPORT_PIPE) {
+        //an encoder that quits early makes the writes fail, not the run
+        signal(SIGPIPE, SIG_IGN);
+        exporter->stream = popen(target + 1, "w");
+    }
+    else if (exporter->format == EXPORT_RAW) {
+        exporter->stream = fopen(target, "wb");
+    }
+    if (exporter->format != EXPORT_PPM && exporter->stream == NULL) {
+        perror(target);
+        free_exporter(exporter);
+        return 1;
+    }
+
+    pthread_mutex_init(&exporter->lock, NULL);
+    pthread_cond_init(&exporter->work, NULL);
+    pthread_cond_init(&exporter->turn, NULL);
+    pthread_cond_init(&exporter->freed, NULL);
+    for (int w = 0; w < num_threads; w++) {
+        exporter->workers[w].exporter = exporter;
+        if (pthread_create(&exporter->workers[w].tid, NULL, export_main,
+                    &exporter->workers[w])) {
+            break;
+        }
+        started++;
+    }
+    if (started == 0) {
+        printf("Error: Failure to start the export threads.\n");
+        pthread_mutex_destroy(&exporter->lock);
+        pthread_cond_destroy(&exporter->work);
+        pthread_cond_destroy(&exporter->turn);
+        pthread_cond_destroy(&exporter->freed);
+        if (exporter->format == EXPORT_PIPE) {
+            pclose(exporter->stream);
+        }
+        else if (exporter->format == EXPORT_RAW) {
+            fclose(exporter->stream);
+        }
+        free_exporter(exporter);
+        return 1;
+    }
+    //export_stop joins just the threads that started
+    exporter->num_workers = started;
+    return 0;
+}
+
+/* return a free slot's board for a round, or NULL if every slot is busy
+ * and wait is 0 */
+struct bitgrid *export_begin(struct exporter *exporter, int wait) {
+    exporter->filling = NULL;
+    pthread_mutex_lock(&exporter->lock);
+    while (1) {
+        for (int s = 0; s < exporter->num_slots; s++) {
+            if (exporter->slots[s].state == SLOT_FREE) {
+                exporter->filling = &exporter->slots[s];
+                exporter->filling->state = SLOT_FILLING;
+                break;
+            }
+        }
+        if (exporter->filling != NULL || !wait) {
+            break;
+        }
+        pthread_cond_wait(&exporter->freed, &exporter->lock);
+    }
+    if (exporter->filling == NULL) {
+        exporter->dropped++;
+    }
+    pthread_mutex_unlock(&exporter->lock);
+    return exporter->filling ? &exporter->filling->board : NULL;
+}
+
+/* hand the board from export_begin to the encoders */
+void export_commit(struct exporter *exporter, int round) {
+    struct export_slot *slot = exporter->filling;
+
+    pthread_mutex_lock(&exporter->lock);
+    slot->round = round;
+    slot->seq = exporter->queued++;
+    slot->state = SLOT_QUEUED;
+    pthread_cond_signal(&exporter->work);
+    pthread_mutex_unlock(&exporter->lock);
+    exporter->filling = NULL;
+}
+
+/* write out the frames still queued, stop the encoder threads and close
+ * the output
+ * returns: 0 if every frame handed over was written, 1 if not
+ */
+int export_stop(struct exporter *exporter) {
+    pthread_mutex_lock(&exporter->lock);
+    exporter->stopping = 1;
+    pthread_cond_broadcast(&exporter->work);
+    pthread_mutex_unlock(&exporter->lock);
+    for (int w = 0; w < exporter->num_workers; w++) {
+        pthread_join(exporter->workers[w].tid, NULL);
+    }
+
+    pthread_mutex_destroy(&exporter->lock);
+    pthread_cond_destroy(&exporter->work);
+    pthread_cond_destroy(&exporter->turn);
+    pthread_cond_destroy(&exporter->freed);
+    if (exporter->format == EXPORT_PIPE && pclose(exporter->stream) != 0) {
+        fprintf(stderr, "Error: --export command %s failed\n",
+                exporter->target + 1);
+        exporter->failed++;
+    }
+    else if (exporter->format == EXPORT_RAW
+            && fclose(exporter->stream) != 0) {
+        exporter->failed++;
+    }
+    exporter->stream = NULL;
+    free_exporter(exporter);
+    return exporter->failed != 0;
+}
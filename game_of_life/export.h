@@ -0,0 +1,108 @@
+#ifndef __EXPORT_H__
+#define __EXPORT_H__
+
+#include <stdio.h>
+#include <pthread.h>
+#include "bitgrid.h"
+#include "paint.h"
+#include "rule.h"
+
+/* Headless export of the rounds (--export=TARGET), for recording runs
+ * without the terminal or the ParaVisi window:
+ *
+ *     --export=run.gols          every frame packed, as a stream of
+ *                                snapshots back to back (see snapshot.h)
+ *     --export=frames/%06d.ppm   a binary PPM image per frame, named by its
+ *                                round (a single %d conversion)
+ *     --export='|ffmpeg -f image2pipe -c:v ppm -i - run.mp4'
+ *                                the PPM images, in round order, piped to
+ *                                the command's standard input
+ *
+ * The images are painted like the ParaVisi window's (see paint.h): the
+ * --view region, at a pixel per cell or shrunk to --export-size, shading
+ * each pixel by how much of its block of cells is alive.
+ *
+ * At the end of each round to export (every --export-every rounds), the
+ * board is copied into a free slot and handed to a pool of encoder
+ * threads, which paint and write the frames while the rounds go on.  If
+ * every slot is still being encoded, the rounds wait for one, so every
+ * frame is recorded; with --export-drop the frame is dropped (and counted)
+ * instead, unless it is the last round's.  Frames are written to a stream
+ * or a pipe in round order, whichever encoder finishes first.
+ */
+
+#define EXPORT_RAW   (0)   // the packed boards, as back to back snapshots
+#define EXPORT_PPM   (1)   // a numbered .ppm file per frame
+#define EXPORT_PIPE  (2)   // PPM frames piped to a command
+
+/* a frame on its way through the encoders */
+struct export_slot {
+    struct bitgrid board;  // the cells
+    int round;             // the round they're from
+    long seq;              // the frame's place in the output
+    int state;             // one of the SLOT_ values in export.c
+};
+
+/* one encoder thread, with its own image buffers */
+struct export_worker {
+    struct exporter *exporter;
+    struct rgb *image;     // the frame painted (bottom row first)
+    unsigned char *out;    // the frame as a PPM file
+    pthread_t tid;
+};
+
+struct exporter {
+    int format;            // one of the EXPORT_ values
+    const char *target;    // the --export= argument
+    FILE *stream;          // the raw stream or the pipe
+    int rows;              // the board's size
+    int cols;
+    int iters;             // rounds the run plays in all
+    struct paint_view view;
+    const struct paint_lut *lut;
+    const struct life_rule *rule;  // recorded in the raw stream's snapshots
+    size_t ppm_size;       // bytes in a PPM frame
+
+    int num_slots;
+    struct export_slot *slots;
+    struct export_slot *filling;  // the slot export_begin handed out
+    int num_workers;
+    struct export_worker *workers;
+    long queued;           // frames handed to the encoders
+    long next_write;       // seq of the next frame to write out
+    int stopping;          // 1 once the encoders should finish up
+
+    long written;          // frames written
+    long dropped;          // frames dropped with every slot busy
+    long failed;           // frames that couldn't be written
+
+    pthread_mutex_t lock;
+    pthread_cond_t work;   // signaled when a frame is queued, or a stop
+    pthread_cond_t turn;   // signaled when next_write moves on
+    pthread_cond_t freed;  // signaled when a slot is free again
+};
+
+/* start num_threads encoder threads exporting rows x cols boards from a
+ * run of iters rounds under rule to target, painting images of view with
+ * lut
+ * returns 0 on success, 1 on error (printing what's wrong) */
+int export_start(struct exporter *exporter, const char *target, int rows,
+        int cols, int iters, const struct life_rule *rule,
+        const struct paint_view *view, const struct paint_lut *lut,
+        int num_threads);
+
+/* return a free slot's board for the caller to copy a round into, waiting
+ * for one to be free if wait is 1; if wait is 0 and every slot is busy,
+ * return NULL (the frame is then dropped) */
+struct bitgrid *export_begin(struct exporter *exporter, int wait);
+
+/* hand the board from export_begin to the encoders as the board after
+ * round */
+void export_commit(struct exporter *exporter, int round);
+
+/* write out the frames still being encoded, stop the encoder threads and
+ * close the output
+ * returns 0 if every frame handed over was written, 1 if not */
+int export_stop(struct exporter *exporter);
+
+#endif  /* __EXPORT_H__ */
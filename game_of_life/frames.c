@@ -0,0 +1,153 @@
+/*
+ * Frame-rate-limited render thread, fed by a triple buffer of boards.
+ * See frames.h for how the boards change hands.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "frames.h"
+
+/* add secs seconds to t */
+static void add_time(struct timespec *t, double secs) {
+    long nsecs = t->tv_nsec + (long)(secs * 1e9);
+
+    t->tv_sec += nsecs / 1000000000;
+    t->tv_nsec = nsecs % 1000000000;
+}
+
+/* return 1 if a is earlier than b, 0 if not */
+static int before(const struct timespec *a, const struct timespec *b) {
+    return a->tv_sec < b->tv_sec
+        || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+/* the render thread: once every 1/fps seconds, take the newest published
+ * frame (if there is one it hasn't drawn) and draw it, until stopped */
+static void *render_main(void *arg) {
+    struct frame_queue *queue = arg;
+    struct timespec next, now;
+    int stopping = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (!stopping) {
+        int have_frame = 0;
+
+        add_time(&next, 1.0 / queue->fps);
+        pthread_mutex_lock(&queue->lock);
+        while (!queue->stopping && pthread_cond_timedwait(&queue->wake,
+                    &queue->lock, &next) == 0) {
+            // woken up early, but not to stop: keep waiting
+        }
+        stopping = queue->stopping;
+        if (queue->fresh) {
+            struct frame *temp = queue->front;
+            queue->front = queue->ready;
+            queue->ready = temp;
+            queue->fresh = 0;
+            have_frame = 1;
+        }
+        pthread_mutex_unlock(&queue->lock);
+
+        if (have_frame) {
+            queue->show(queue->arg, queue->front);
+            queue->shown++;
+        }
+
+        //if drawing took longer than a frame, start counting again from now
+        //rather than rushing to catch up
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (before(&next, &now)) {
+            next = now;
+        }
+    }
+    return NULL;
+}
+
+/* start a render thread, see frames.h
+ * returns: 0 on success, 1 on error
+ */
+int frames_start(struct frame_queue *queue, int rows, int cols, double fps,
+        frames_show_func show, void *arg)
+{
+    pthread_condattr_t attr;
+
+    memset(queue, 0, sizeof(*queue));
+    for (int f = 0; f < 3; f++) {
+        if (bitgrid_init(&queue->frames[f].board, rows, cols) != 0) {
+            for (int g = 0; g < f; g++) {
+                bitgrid_free(&queue->frames[g].board);
+            }
+            return 1;
+        }
+    }
+    queue->back = &queue->frames[0];
+    queue->ready = &queue->frames[1];
+    queue->front = &queue->frames[2];
+    queue->fps = fps;
+    queue->show = show;
+    queue->arg = arg;
+
+    //the render thread's deadlines are on the monotonic clock
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&queue->wake, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&queue->lock, NULL);
+
+    if (pthread_create(&queue->tid, NULL, render_main, queue)) {
+        for (int f = 0; f < 3; f++) {
+            bitgrid_free(&queue->frames[f].board);
+        }
+        pthread_mutex_destroy(&queue->lock);
+        pthread_cond_destroy(&queue->wake);
+        return 1;
+    }
+    return 0;
+}
+
+/* return the back board, for the simulation to copy a round into */
+struct bitgrid *frames_back(struct frame_queue *queue) {
+    return &queue->back->board;
+}
+
+/* publish the back board as the board after round, with live cells */
+void frames_publish(struct frame_queue *queue, int round, long live) {
+    struct frame *temp;
+
+    queue->back->round = round;
+    queue->back->live = live;
+
+    pthread_mutex_lock(&queue->lock);
+    temp = queue->ready;
+    queue->ready = queue->back;
+    queue->back = temp;
+    if (queue->fresh) {
+        queue->dropped++;
+    }
+    queue->fresh = 1;
+    pthread_mutex_unlock(&queue->lock);
+    queue->published++;
+}
+
+/* draw the last published frame, then stop the render thread and free the
+ * queue */
+void frames_stop(struct frame_queue *queue) {
+    pthread_mutex_lock(&queue->lock);
+    queue->stopping = 1;
+    pthread_cond_signal(&queue->wake);
+    pthread_mutex_unlock(&queue->lock);
+    pthread_join(queue->tid, NULL);
+
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->wake);
+    for (int f = 0; f < 3; f++) {
+        bitgrid_free(&queue->frames[f].board);
+    }
+}
+
+/* return 1 if cell (i, j) of the frame at arg is alive, 0 if not */
+int frames_cell_alive(void *arg, int i, int j) {
+    const struct frame *frame = arg;
+
+    return bitgrid_get(&frame->board, i, j);
+}
@@ -0,0 +1,70 @@
+#ifndef __FRAMES_H__
+#define __FRAMES_H__
+
+#include <pthread.h>
+#include "bitgrid.h"
+
+/* Hands finished rounds from the simulation to a render thread, so that
+ * the animation can be drawn at a steady frame rate while the rounds run as
+ * fast as they can.
+ *
+ * The queue holds three copies of the board:
+ *   - back:  the one the simulation is copying its latest round into,
+ *   - ready: the newest finished round, waiting to be drawn,
+ *   - front: the one the render thread is drawing.
+ * Publishing a round swaps back and ready, and the render thread swaps
+ * ready and front when it wakes up, so neither side ever waits for the
+ * other to finish with a board.  A round published while an older one is
+ * still waiting replaces it: the render thread only ever draws the newest
+ * round, and drops the ones it had no time for.
+ */
+
+struct frame {
+    struct bitgrid board;  // the cells
+    int round;             // the round the cells are from
+    long live;             // live cells (if that round counted them)
+};
+
+/* draws one frame (called on the render thread) */
+typedef void (*frames_show_func)(void *arg, const struct frame *frame);
+
+struct frame_queue {
+    struct frame frames[3];
+    struct frame *back;   // simulation's, being filled in
+    struct frame *ready;  // shared: newest published round
+    struct frame *front;  // render thread's, being drawn
+    int fresh;            // 1 if ready hasn't been drawn yet
+    int stopping;         // 1 once the render thread should finish up
+
+    double fps;           // frames a second to draw, at most
+    frames_show_func show;
+    void *arg;            // passed to show
+    long published;       // rounds published
+    long shown;           // frames drawn
+    long dropped;         // rounds replaced before they were drawn
+
+    pthread_mutex_t lock;
+    pthread_cond_t wake;  // signaled to stop the render thread early
+    pthread_t tid;
+};
+
+/* start a render thread that draws the newest published rows x cols frame
+ * with show(arg, frame), fps times a second
+ * returns 0 on success, 1 on error */
+int frames_start(struct frame_queue *queue, int rows, int cols, double fps,
+        frames_show_func show, void *arg);
+
+/* return the back board, for the simulation to copy a round into */
+struct bitgrid *frames_back(struct frame_queue *queue);
+
+/* publish the back board as the board after round, with live cells */
+void frames_publish(struct frame_queue *queue, int round, long live);
+
+/* draw the last published frame if it hasn't been, then stop the render
+ * thread and free the queue */
+void frames_stop(struct frame_queue *queue);
+
+/* return 1 if cell (i, j) of the frame at arg is alive, 0 if not */
+int frames_cell_alive(void *arg, int i, int j);
+
+#endif  /* __FRAMES_H__ */
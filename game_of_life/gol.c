@@ -11,9 +11,108 @@ Author: Duc Dam.
  * ./gol file1.txt  0  # run with config file file1.txt, do not print board
  * ./gol file1.txt  1  # run with config file file1.txt, ascii animation
  * ./gol file1.txt  2  # run with config file file1.txt, ParaVis animation
+ * ./gol gol.snap   0  # resume from a snapshot written by --checkpoint
+ * ./gol glider.rle 0 --rounds=100  # play an RLE pattern (see rle.h)
+ * ./gol --batch -t 4 jobs.txt 0     # play every board listed in jobs.txt
+ *                                   # on a pool of 4 threads (see batch.h)
+ * ./gol --random=1000x1000,0.35,7 --rounds=100 0  # play a random soup,
+ *                                   # with no input file (see soup.h)
+ * ./gol --serve=gol.sock -t 4 0     # play the boards clients send to the
+ *                                   # socket gol.sock as they come in
  *
+ * make headless builds gol_headless, the same program with no Qt5, OpenGL
+ * or ParaVis (and so no mode 2), for many short runs (see novisi.h).
+ *
+ * Options (given before the file name):
+ *   -t nthreads     split the rows of the board between nthreads threads
+ *   --grid=packed   store the board one bit per cell (the default)
+ *   --grid=int      store the board one byte per cell (reference mode)
+ *   --kernel=naive  count each cell's neighbors one at a time (any grid)
+ *   --kernel=halo   like naive, but with no modulo arithmetic (int grid)
+ *   --kernel=lut    carry three-row column sums down the board and look
+ *                   each cell's next state up by them (int grid)
+ *   --kernel=swar   compute 64 cells per word operation (packed grid, default)
+ *   --kernel=avx2   compute 256 cells per operation (packed grid)
+ *   --kernel=avx512 compute 512 cells per operation (packed grid)
+ *   --count=needed  count live cells only on rounds that print them (default)
+ *   --count=all     count live cells every round
+ *   --sched=rows    give each thread an even block of rows (default)
+ *   --sched=tiles   share out tiles of the board, skipping inactive ones,
+ *                   with idle threads stealing tiles from busy ones
+ *                   (packed grid)
+ *   --sched=active  like tiles, but only play the tiles that changed last
+ *                   round and their neighbors (packed grid)
+ *   --engine=direct play every round, one at a time (default)
+ *   --engine=hashlife  jump ahead with memoized quadtree results (packed
+ *                   grid, modes 0 and 1, the final board only; fastest
+ *                   when the sides are powers of two)
+ *   --hashlife-nodes=N  bound on the HashLife node cache
+ *   --engine=sparse store only the 64x64 chunks that have live cells, for
+ *                   huge, mostly empty boards (modes 0 and 1, one thread)
+ *   --engine=cuda   play the rounds on the GPU, painting ParaVisi frames
+ *                   there too (packed grid, a build with make CUDA=1, see
+ *                   gpu.h)
+ *   --checkpoint=N  save a snapshot of the board every N rounds, in the
+ *                   background (direct engine)
+ *   --checkpoint-file=PATH  where to save snapshots (default gol.snap)
+ *   --rounds=N      play N rounds, whatever the input file says (needed
+ *                   for RLE patterns, which don't give a number of rounds)
+ *   --size=RxC      play an RLE pattern in the middle of an R x C board
+ *                   (default: a board just the size of the pattern)
+ *   --rle-out=PATH  write the final board to PATH as an RLE pattern
+ *   --redraw=all    redraw the whole board every round in ASCII mode
+ *                   (default)
+ *   --redraw=rows   redraw only the rows that changed (see ascii.h)
+ *   --fps=N         draw at most N frames a second in the animation modes,
+ *                   while the rounds run at full speed (see frames.h)
+ *   --view=R,C,RxC  show only the R x C region of the board whose top left
+ *                   cell is (R, C) in ParaVisi mode (default: the board)
+ *   --window=HxW    paint the view into an H x W pixel window in ParaVisi
+ *                   mode, shading each pixel by how much of its block of
+ *                   cells is alive (default: a pixel per cell, see paint.h)
+ *   --trace=PATH    write the time of each phase of each round to PATH, in
+ *                   a build with make PROFILE=1 (see prof.h)
+ *   --batch         the file is a manifest of boards to play, one job per
+ *                   thread at a time (mode 0, packed grid, see batch.h)
+ *   --cycles        stop early once the board is a still life, an
+ *                   oscillator or empty, jumping to the last round's board
+ *                   (direct engine, see cycle.h)
+ *   --hugepages     keep big boards on 2 MB huge pages (see boardmem.h)
+ *   --temporal=K    play the board K rounds at a time, a cache-sized band
+ *                   of rows at a time (mode 0, packed kernel, rows
+ *                   scheduler, see temporal.h)
+ *   --rule=B36/S23  play another rule than Life's B3/S23, or a Generations
+ *                   rule such as B2/S/C3 (int grid), see rule.h
+ *   --random=RxC,D,S  play an R x C board with each cell alive with
+ *                   probability D, from seed S, instead of an input file
+ *                   (needs --rounds, see soup.h)
+ *   --stats=PATH    write each round's live cells, births, deaths and
+ *                   bounding box to PATH, as CSV or (PATH ending in .bin)
+ *                   binary records, in the background (direct engine, rows
+ *                   scheduler, see stats.h)
+ *   --stats-drop    drop the records that come with the stats writer a
+ *                   whole ring behind, instead of waiting for it
+ *   --export=TARGET record the rounds, in any mode: a stream of packed
+ *                   boards, a PPM image per round (a name like f%06d.ppm)
+ *                   or PPM images piped to a command ('|ffmpeg ...'),
+ *                   encoded on threads of their own (direct engine, see
+ *                   export.h)
+ *   --export-every=N  record every Nth round (default: every round)
+ *   --export-size=HxW paint the recorded images H x W pixels, shading
+ *                   blocks of cells (default: a pixel per cell of the view)
+ *   --export-threads=N  encode on N threads (default 2)
+ *   --export-drop   skip the frames that come with every encoder busy,
+ *                   instead of waiting for one (the last round's is kept)
+ *   --serve[=SOCKET]  stay running and play the jobs sent on standard input
+ *                   or to the Unix socket SOCKET, in the --batch manifest's
+ *                   format, in place of an input file (mode 0, packed grid,
+ *                   see batch.h)
  */
+#ifdef GOL_HEADLESS
+#include "novisi.h"
+#else
 #include <pthreadGridVisi.h>
+#endif
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -21,7 +120,32 @@ Author: Duc Dam.
 #include <time.h>
 #include <string.h>
 #include <pthread.h>
+#include <getopt.h>
 #include "colors.h"
+#include "bitgrid.h"
+#include "swar.h"
+#include "tiles.h"
+#include "temporal.h"
+#include "hashlife.h"
+#include "sparse.h"
+#include "loader.h"
+#include "snapshot.h"
+#include "rle.h"
+#include "ascii.h"
+#include "frames.h"
+#include "paint.h"
+#include "prof.h"
+#include "batch.h"
+#include "cycle.h"
+#include "boardmem.h"
+#include "rule.h"
+#include "soup.h"
+#include "stats.h"
+#include "export.h"
+#include "libgol.h"
+#ifdef GOL_CUDA
+#include "gpu.h"
+#endif
 
 /****************** Definitions **********************/
 /* Three possible modes in which the GOL simulation can run */
@@ -29,16 +153,56 @@ Author: Duc Dam.
 #define OUTPUT_ASCII  (1)   // with ascii animation
 #define OUTPUT_VISI   (2)   // with ParaVis animation
 
-/* Used to slow down animation run modes: usleep(SLEEP_USECS);
- * Change this value to make the animation run faster or slower
+/* Two possible layouts for the board in memory */
+#define GRID_INT      (0)   // one byte per cell (reference mode)
+#define GRID_PACKED   (1)   // one bit per cell, see bitgrid.h
+
+/* Possible next-generation kernels (--kernel=) */
+#define KERNEL_NAIVE  (0)   // count_neighbors + update_world for every cell
+#define KERNEL_SWAR   (1)   // 64 cells per word, see swar.h
+#define KERNEL_AVX2   (2)   // 256 cells per avx2 operation
+#define KERNEL_AVX512 (3)   // 512 cells per avx512 operation
+#define KERNEL_HALO   (4)   // straight-line loads using the halo ring
+#define KERNEL_LUT    (5)   // running column sums using the halo ring
+
+/* the --kernel names of the kernels, by KERNEL_ value */
+static char *kernel_names[] = {"naive", "swar", "avx2", "avx512", "halo",
+    "lut"};
+
+/* Frame rates of the animation run modes, unless --fps= is given.
+ * Change these values to make the animation run faster or slower
+ * (the rounds themselves always run at full speed).
  */
-//#define SLEEP_USECS  (1000000)
-#define SLEEP_USECS    (100000)
-
-/* A global variable to keep track of the number of live cells in the
- * world
+#define ASCII_FPS      (5)
+#define VISI_FPS       (10)
+
+/* Possible engines for running the simulation (--engine=) */
+#define ENGINE_DIRECT   (0)   // play_gol: play every round, one at a time
+#define ENGINE_HASHLIFE (1)   // play_hashlife: see hashlife.h
+#define ENGINE_SPARSE   (2)   // play_sparse: see sparse.h
+#define ENGINE_CUDA     (3)   // play_cuda: see gpu.h
+
+/* Possible ways of sharing out the board between threads (--sched=) */
+#define SCHED_ROWS    (0)   // one even block of rows per thread
+#define SCHED_TILES   (1)   // work-stealing tiles, see tiles.h
+#define SCHED_ACTIVE  (2)   // work-stealing tiles, only the active ones
+
+/* Two possible ways of keeping the live cell count (--count=) */
+#define COUNT_NEEDED  (0)   // only on rounds whose count gets printed
+#define COUNT_ALL     (1)   // every round
+
+/* A live cell count padded out to a cache line of its own, so that threads
+ * updating their own counters never fight over the same line.
  */
-static int total_live = 0;
+#define CACHE_LINE    (64)
+struct live_counter {
+    long count;
+    uint64_t step_ns;  // this round's step time, in a PROFILE=1 build
+    long changed;      // and the cells the thread's rows changed,
+    uint64_t diff_ns;  // taking this long to count
+    struct gen_stats stats;  // this round's --stats for the thread's rows
+    uint64_t *stats_cols;    // their live columns, see gen_stats_block
+} __attribute__((aligned(CACHE_LINE)));
 
 /* This struct represents all the data we need to keep track of in our GOL
  * simulation.  
@@ -50,16 +214,122 @@ struct gol_data {
     int cols;  // the column dimension
     int iters; // number of iterations to run the gol simulation
     int output_mode; // set to:  OUTPUT_NONE, OUTPUT_ASCII, or OUTPUT_VISI
-
-
-    int * cells;
+    int grid;        // set to:  GRID_INT or GRID_PACKED
+    int kernel;      // set to:  one of the KERNEL_ values
+    struct swar_rule swar;  // the bit-parallel kernel, in GRID_PACKED mode
+    struct life_rule rule;  // the rule played (--rule), Life by default
+
+
+    /* In GRID_INT mode the board is stored with a one-cell halo ring around
+     * it: (rows+2) x (cols+2) bytes, a cell's state each (see rule.h), with
+     * cell (i, j) at cell_index(i, j).  The halo cells hold copies of the
+     * cells on the opposite edges. */
+    int stride;       // cells per stored row (cols + 2)
+    uint8_t * cells;      // the board in GRID_INT mode
+    uint8_t * new_world;  // next round's board in GRID_INT mode
+    struct bitgrid board;  // the board in GRID_PACKED mode
+    struct bitgrid next;   // next round's board in GRID_PACKED mode
+    struct bitgrid placed; // the board, being copied by each thread onto
+                           // its own NUMA node (see first_touch)
+    int first_touch;  // 1 if the threads copy their rows before round 1
+    int huge_pages;   // 1 to keep big boards on huge pages (--hugepages)
+    struct sparse_world world;  // the board in ENGINE_SPARSE mode
     int current_round;
+    int start_round;  // the round the run began from (0, or a snapshot's)
+    int last_round;   // the round play_gol stops at: iters, or sooner once
+                      // a cycle is found
+
+    /* still life and oscillator detection, if --cycles was given */
+    int detect_cycles;
+    struct cycle_detector cycles;
+    struct bitgrid cycle_board;  // a packed copy of a GRID_INT board
+
+    int num_threads;  // number of threads splitting up the rows (-t)
+    int sched;        // set to:  one of the SCHED_ values
+    int engine;       // set to:  one of the ENGINE_ values
+    long hashlife_nodes;  // node cache bound for ENGINE_HASHLIFE
+    struct tile_pool tiles;  // the tiles, in SCHED_TILES/ACTIVE mode
+    int temporal_depth;      // rounds played per pass (--temporal), or 1
+    struct temporal_pool temporal;  // the bands, if temporal_depth > 1
+    pthread_barrier_t barrier;  // threads wait here between rounds
+
+    /* the number of live cells in the world, as of the last round that
+     * counted them (see round_needs_count) */
+    long total_live;
+    int count_mode;   // set to:  COUNT_NEEDED or COUNT_ALL
+    struct live_counter *live;  // each thread's count for its own rows
+
+    /* snapshots, if --checkpoint was given (see snapshot.h) */
+    int checkpoint_every;    // rounds between snapshots (0 for none)
+    char *checkpoint_path;   // where to save them
+    struct snapshot_writer snapshots;
+
+    /* per-round statistics, if --stats was given (see stats.h) */
+    char *stats_path;        // where to write them, or NULL
+    int stats_drop;          // 1 to drop records with the writer behind
+    struct stats_writer stats;
+
+    /* the rounds recorded, if --export was given (see export.h) */
+    char *export_target;     // where to record them, or NULL
+    int export_every;        // rounds between frames
+    int export_rows;         // --export-size, or 0 for the view's
+    int export_cols;
+    int export_threads;      // encoder threads
+    int export_drop;         // 1 to drop frames with the encoders behind
+    struct exporter exporter;
+
+    int rounds;        // --rounds, or -1 to use the input file's
+    int board_rows;    // --size for RLE patterns, or 0 to fit the pattern
+    int board_cols;
+    char *rle_out;     // where to write the final board, or NULL
+    int random;        // 1 to play the --random soup, not an input file
+    struct soup soup;
+
+    /* the terminal rendering (when run in OUTPUT_ASCII mode), see ascii.h */
+    int redraw_rows;        // 1 to redraw only the rows that changed
+    struct ascii_frame ascii;
+
+    /* the render thread drawing the animation (see frames.h) */
+    double fps;             // frames a second, or 0 for the mode's default
+    struct frame_queue frames;
+
+    /* the region of the board painted in OUTPUT_VISI mode, and the size of
+     * the window it is painted into (see paint.h) */
+    struct paint_view view;
+    struct paint_lut lut;
+
+    char *trace_path;  // the per-round --trace file, or NULL
+    int batch;         // 1 if the input file is a --batch manifest
+    int serve;         // 1 to serve jobs (--serve) in place of a file
+    int write_failed;  // 1 if a file written along the way couldn't be
+                       // (snapshots, stats, frames, --rle-out): exit 1
+    char *serve_path;  // the --serve socket, or NULL for standard input
+#ifdef GOL_PROFILE
+    struct prof prof;  // timings and counts of the direct engine's rounds
+    long tiles_cells;  // cells in the tiles computed, as of the last round
+#endif
 
     /* fields used by ParaVis library (when run in OUTPUT_VISI mode). */
     visi_handle handle;
     color3 *image_buff;
 };
 
+//paint.c writes the ParaVis image buffer as struct rgb pixels
+_Static_assert(sizeof(color3) == sizeof(struct rgb),
+        "color3 and struct rgb differ");
+
+
+/* This struct holds what each thread needs to play its block of rows
+ * [row_start, row_end) of the board in play_gol.
+ */
+struct gol_thread {
+    struct gol_data *data;
+    pthread_t tid;
+    int id;         // 0 .. num_threads-1
+    int row_start;  // first row this thread plays
+    int row_end;    // one past the last row this thread plays
+};
+
 
 /************ Definitions for using ParVisi library ***********/
 /* initialization for the ParaVisi library (DO NOT MODIFY) */
@@ -80,9 +350,29 @@ static char visi_name[] = "GOL!";
 /* the main gol game playing loop (prototype must match this) */
 void play_gol(struct gol_data *data);
 
+/* run all the rounds at once with the HashLife engine */
+void play_hashlife(struct gol_data *data);
+
+/* run the rounds on the live chunks only, with the sparse engine */
+void play_sparse(struct gol_data *data);
+
+#ifdef GOL_CUDA
+/* run the rounds on the GPU, with the CUDA engine */
+void play_cuda(struct gol_data *data);
+#endif
+
 /* init gol data from the input file and run mode cmdline args */
 int init_game_data_from_args(struct gol_data *data, char **argv);
 
+/* fill in the grid and kernel to use from the --grid and --kernel options */
+int select_kernel(struct gol_data *data);
+
+/* fill in the board region and window size painted in OUTPUT_VISI mode */
+int setup_view(struct gol_data *data);
+
+/* tell rle_write and ascii_draw whether a cell of the board is alive */
+int board_cell_alive(void *arg, int i, int j);
+
 // A mostly implemented function, but a bit more for you to add.
 /* print board to the terminal (for OUTPUT_ASCII mode) */
 void print_board(struct gol_data *data, int round);
@@ -90,6 +380,46 @@ void print_board(struct gol_data *data, int round);
 // Return a list of neighbors of a given cell (represented by 1 or 0)
 int get_neighbors(struct gol_data *data, int i, int j);
 
+/* Return the index of the cell at i-j coords in a GRID_INT array.
+ * i may range from -1 to rows and j from -1 to cols (the halo ring). */
+static inline long cell_index(struct gol_data *data, int i, int j) {
+    return (long)(i+1)*data->stride + (j+1);
+}
+
+/* Return the size in bytes of a GRID_INT board, halo ring included */
+static inline size_t int_board_bytes(struct gol_data *data) {
+    return (size_t)(data->rows + 2) * data->stride * sizeof(uint8_t);
+}
+
+/* Return 1 if the kernel reads the GRID_INT board's halo ring, 0 if not */
+static inline int kernel_uses_halo(int kernel) {
+    return kernel == KERNEL_HALO || kernel == KERNEL_LUT;
+}
+
+/* Return 1 if kernel is a bit-parallel one (swar, avx2 or avx512), 0 if
+ * not */
+static inline int kernel_is_swar(int kernel) {
+    return kernel == KERNEL_SWAR || kernel == KERNEL_AVX2
+        || kernel == KERNEL_AVX512;
+}
+
+/* Return the state of the cell at i-j coords: 0 dead, 1 alive, or a
+ * Generations rule's dying state from 2 on (any grid layout) */
+static inline int cell_state(struct gol_data *data, int i, int j) {
+    if (data->engine == ENGINE_SPARSE) {
+        return sparse_get(&data->world, i, j);
+    }
+    if (data->grid == GRID_PACKED) {
+        return bitgrid_get(&data->board, i, j);
+    }
+    return data->cells[cell_index(data, i, j)];
+}
+
+/* Return 1 if the cell at i-j coords is alive, 0 if not (any grid layout) */
+static inline int cell_alive(struct gol_data *data, int i, int j) {
+    return cell_state(data, i, j) == 1;
+}
+
 
 
 
@@ -100,17 +430,424 @@ int get_neighbors(struct gol_data *data, int i, int j);
 //$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
 int main(int argc, char **argv) {
 
-    int ret;
+    int ret, opt;
     struct gol_data data;
     double secs;
     struct timeval start_time, stop_time;
+    void (*play)(struct gol_data *data);
+    char *random_text = NULL;
+    static struct option long_options[] = {
+        {"grid", required_argument, NULL, 'g'},
+        {"kernel", required_argument, NULL, 'k'},
+        {"count", required_argument, NULL, 'c'},
+        {"sched", required_argument, NULL, 's'},
+        {"engine", required_argument, NULL, 'e'},
+        {"hashlife-nodes", required_argument, NULL, 'n'},
+        {"checkpoint", required_argument, NULL, 'p'},
+        {"checkpoint-file", required_argument, NULL, 'f'},
+        {"rounds", required_argument, NULL, 'r'},
+        {"size", required_argument, NULL, 'z'},
+        {"rle-out", required_argument, NULL, 'o'},
+        {"redraw", required_argument, NULL, 'd'},
+        {"fps", required_argument, NULL, 'F'},
+        {"view", required_argument, NULL, 'v'},
+        {"window", required_argument, NULL, 'w'},
+        {"trace", required_argument, NULL, 'T'},
+        {"batch", no_argument, NULL, 'b'},
+        {"serve", optional_argument, NULL, 'Q'},
+        {"cycles", no_argument, NULL, 'y'},
+        {"hugepages", no_argument, NULL, 'H'},
+        {"temporal", required_argument, NULL, 'K'},
+        {"rule", required_argument, NULL, 'R'},
+        {"random", required_argument, NULL, 'S'},
+        {"stats", required_argument, NULL, 'A'},
+        {"stats-drop", no_argument, NULL, 'G'},
+        {"export", required_argument, NULL, 'E'},
+        {"export-every", required_argument, NULL, 'X'},
+        {"export-size", required_argument, NULL, 'Z'},
+        {"export-threads", required_argument, NULL, 'P'},
+        {"export-drop", no_argument, NULL, 'D'},
+        {NULL, 0, NULL, 0}
+    };
+
+    /* Read in options that come before the file name and run mode.
+     * -1 means "not given": the grid and kernel then default to each other,
+     * or to a packed grid with the swar kernel. */
+    data.grid = -1;
+    data.kernel = -1;
+    data.num_threads = 1;
+    data.count_mode = COUNT_NEEDED;
+    data.sched = SCHED_ROWS;
+    data.engine = ENGINE_DIRECT;
+    data.hashlife_nodes = HASHLIFE_MAX_NODES;
+    data.checkpoint_every = 0;
+    data.checkpoint_path = "gol.snap";
+    data.rounds = -1;
+    data.board_rows = data.board_cols = 0;
+    data.rle_out = NULL;
+    data.redraw_rows = 0;
+    data.fps = 0;
+    memset(&data.view, 0, sizeof(data.view));
+    data.trace_path = NULL;
+    data.batch = 0;
+    data.serve = 0;
+    data.serve_path = NULL;
+    data.write_failed = 0;
+    data.detect_cycles = 0;
+    data.huge_pages = 0;
+    data.temporal_depth = 1;
+    rule_init_life(&data.rule);
+    data.random = 0;
+    data.stats_path = NULL;
+    data.export_target = NULL;
+    data.export_every = 1;
+    data.export_rows = data.export_cols = 0;
+    data.export_threads = 2;
+    data.export_drop = 0;
+    data.stats_drop = 0;
+    while ((opt = getopt_long(argc, argv, "t:", long_options, NULL)) != -1) {
+        if (opt == 'g' && strcmp(optarg, "int") == 0) {
+            data.grid = GRID_INT;
+        }
+        else if (opt == 'g' && strcmp(optarg, "packed") == 0) {
+            data.grid = GRID_PACKED;
+        }
+        else if (opt == 'c' && strcmp(optarg, "all") == 0) {
+            data.count_mode = COUNT_ALL;
+        }
+        else if (opt == 'c' && strcmp(optarg, "needed") == 0) {
+            data.count_mode = COUNT_NEEDED;
+        }
+        else if (opt == 's' && strcmp(optarg, "rows") == 0) {
+            data.sched = SCHED_ROWS;
+        }
+        else if (opt == 's' && strcmp(optarg, "tiles") == 0) {
+            data.sched = SCHED_TILES;
+        }
+        else if (opt == 's' && strcmp(optarg, "active") == 0) {
+            data.sched = SCHED_ACTIVE;
+        }
+        else if (opt == 'e' && strcmp(optarg, "direct") == 0) {
+            data.engine = ENGINE_DIRECT;
+        }
+        else if (opt == 'e' && strcmp(optarg, "hashlife") == 0) {
+            data.engine = ENGINE_HASHLIFE;
+        }
+        else if (opt == 'e' && strcmp(optarg, "sparse") == 0) {
+            data.engine = ENGINE_SPARSE;
+        }
+        else if (opt == 'e' && strcmp(optarg, "cuda") == 0) {
+            data.engine = ENGINE_CUDA;
+        }
+        else if (opt == 'n') {
+            data.hashlife_nodes = atol(optarg);
+        }
+        else if (opt == 'p') {
+            data.checkpoint_every = atoi(optarg);
+        }
+        else if (opt == 'f') {
+            data.checkpoint_path = optarg;
+        }
+        else if (opt == 'r') {
+            data.rounds = atoi(optarg);
+            if (data.rounds < 0) {
+                argc = 0;
+            }
+        }
+        else if (opt == 'z') {
+            if (sscanf(optarg, "%dx%d", &data.board_rows,
+                        &data.board_cols) != 2
+                    || data.board_rows < 1 || data.board_cols < 1) {
+                argc = 0;
+            }
+        }
+        else if (opt == 'o') {
+            data.rle_out = optarg;
+        }
+        else if (opt == 'd' && strcmp(optarg, "all") == 0) {
+            data.redraw_rows = 0;
+        }
+        else if (opt == 'd' && strcmp(optarg, "rows") == 0) {
+            data.redraw_rows = 1;
+        }
+        else if (opt == 'F') {
+            data.fps = atof(optarg);
+            if (data.fps <= 0) {
+                argc = 0;
+            }
+        }
+        else if (opt == 'v') {
+            if (sscanf(optarg, "%d,%d,%dx%d", &data.view.row, &data.view.col,
+                        &data.view.rows, &data.view.cols) != 4
+                    || data.view.row < 0 || data.view.col < 0
+                    || data.view.rows < 1 || data.view.cols < 1) {
+                argc = 0;
+            }
+        }
+        else if (opt == 'w') {
+            if (sscanf(optarg, "%dx%d", &data.view.image_rows,
+                        &data.view.image_cols) != 2
+                    || data.view.image_rows < 1
+                    || data.view.image_cols < 1) {
+                argc = 0;
+            }
+        }
+        else if (opt == 'T') {
+            data.trace_path = optarg;
+        }
+        else if (opt == 'b') {
+            data.batch = 1;
+        }
+        else if (opt == 'Q') {
+            data.serve = 1;
+            data.serve_path = optarg;
+        }
+        else if (opt == 'y') {
+            data.detect_cycles = 1;
+        }
+        else if (opt == 'H') {
+            data.huge_pages = 1;
+        }
+        else if (opt == 'K') {
+            data.temporal_depth = atoi(optarg);
+            if (data.temporal_depth < 1) {
+                argc = 0;
+            }
+        }
+        else if (opt == 'R') {
+            if (rule_parse(optarg, &data.rule) != 0) {
+                argc = 0;
+            }
+        }
+        else if (opt == 'S') {
+            data.random = 1;
+            random_text = optarg;
+            if (sscanf(optarg, "%dx%d,%lf,%llu", &data.soup.rows,
+                        &data.soup.cols, &data.soup.density,
+                        &data.soup.seed) != 4
+                    || data.soup.rows < 1 || data.soup.cols < 1
+                    || !(data.soup.density >= 0 && data.soup.density <= 1)) {
+                argc = 0;
+            }
+        }
+        else if (opt == 'A') {
+            data.stats_path = optarg;
+        }
+        else if (opt == 'G') {
+            data.stats_drop = 1;
+        }
+        else if (opt == 'E') {
+            data.export_target = optarg;
+        }
+        else if (opt == 'X') {
+            data.export_every = atoi(optarg);
+            if (data.export_every < 1) {
+                argc = 0;
+            }
+        }
+        else if (opt == 'Z') {
+            if (sscanf(optarg, "%dx%d", &data.export_rows,
+                        &data.export_cols) != 2
+                    || data.export_rows < 1 || data.export_cols < 1) {
+                argc = 0;
+            }
+        }
+        else if (opt == 'P') {
+            data.export_threads = atoi(optarg);
+            if (data.export_threads < 1) {
+                argc = 0;
+            }
+        }
+        else if (opt == 'D') {
+            data.export_drop = 1;
+        }
+        else if (opt == 't') {
+            data.num_threads = atoi(optarg);
+        }
+        else if (opt == 'k') {
+            for (int k = KERNEL_NAIVE; k <= KERNEL_LUT; k++) {
+                if (strcmp(optarg, kernel_names[k]) == 0) {
+                    data.kernel = k;
+                }
+            }
+            if (data.kernel == -1) {
+                argc = 0;
+            }
+        }
+        else {
+            argc = 0;  // bad option: fall through to the usage message
+        }
+    }
 
-    /* check number of command line arguments */
-    if (argc < 3) {
-        printf("usage: %s <infile.txt> <output_mode>[0|1|2]\n", argv[0]);
+    /* check number of command line arguments: --random and --serve take
+     * the place of the file name */
+    if (argc - optind < 2 - (data.random || data.serve)
+            || ((data.random || data.serve) && argc - optind != 1)) {
+        printf("usage: %s [-t nthreads] [--grid=packed|int] "
+                "[--kernel=naive|halo|lut|swar|avx2|avx512] "
+                "[--count=needed|all] [--sched=rows|tiles|active] "
+                "[--engine=direct|hashlife|sparse|cuda] [--hashlife-nodes=N] "
+                "[--checkpoint=N] [--checkpoint-file=PATH] "
+                "[--rounds=N] [--size=RxC] [--rle-out=PATH] "
+                "[--redraw=all|rows] [--fps=N] "
+                "[--view=R,C,RxC] [--window=HxW] [--trace=PATH] [--batch] "
+                "[--cycles] [--hugepages] [--temporal=K] [--rule=B3/S23] "
+                "[--stats=PATH] [--stats-drop] [--export=TARGET] "
+                "[--export-every=N] [--export-size=HxW] [--export-threads=N] "
+                "[--export-drop] "
+                "<infile.txt> | --random=RxC,DENSITY,SEED | --serve[=SOCKET] "
+                "<output_mode>[0|1|2]\n", argv[0]);
         printf("(0: no visualization, 1: ASCII, 2: ParaVisi)\n");
+        printf("(infile.txt may also be a --checkpoint snapshot, or an "
+                ".rle pattern)\n");
+        exit(1);
+    }
+
+    if (data.num_threads < 1) {
+        printf("Error: the number of threads must be at least 1\n");
+        exit(1);
+    }
+
+    if (data.rule.states > 2 && (data.grid == GRID_PACKED
+                || (data.kernel != -1 && data.kernel != KERNEL_NAIVE
+                    && !kernel_uses_halo(data.kernel)))) {
+        printf("Error: Generations rules (--rule=%s) need the int grid "
+                "(--kernel=naive, halo or lut)\n", data.rule.name);
+        exit(1);
+    }
+    if (!rule_is_life(&data.rule) && (data.kernel == KERNEL_AVX2
+                || data.kernel == KERNEL_AVX512)) {
+        printf("Error: --kernel=%s only plays B3/S23 (use --kernel=swar "
+                "for --rule=%s)\n", kernel_names[data.kernel],
+                data.rule.name);
+        exit(1);
+    }
+    if (!rule_is_life(&data.rule) && data.engine != ENGINE_DIRECT) {
+        printf("Error: --engine=hashlife, sparse and cuda only play B3/S23 "
+                "(--rule=%s needs --engine=direct)\n", data.rule.name);
+        exit(1);
+    }
+    if (data.rule.states > 2 && (data.checkpoint_every != 0
+                || data.detect_cycles || data.rle_out != NULL)) {
+        printf("Error: --checkpoint, --cycles and --rle-out only keep live "
+                "and dead cells, not a Generations rule's dying ones\n");
+        exit(1);
+    }
+
+    ret = select_kernel(&data);
+    if (ret != 0) {
+        printf("Error: kernel %s can't run on this grid or CPU\n",
+                kernel_names[data.kernel]);
+        exit(1);
+    }
+    if (data.sched != SCHED_ROWS && data.grid != GRID_PACKED) {
+        printf("Error: --sched=tiles and --sched=active need the packed grid\n");
+        exit(1);
+    }
+    if (data.engine == ENGINE_HASHLIFE && data.grid != GRID_PACKED) {
+        printf("Error: --engine=hashlife needs the packed grid\n");
+        exit(1);
+    }
+    if (data.checkpoint_every != 0 && (data.checkpoint_every < 0
+                || data.engine != ENGINE_DIRECT)) {
+        printf("Error: --checkpoint=N needs N > 0 and --engine=direct\n");
+        exit(1);
+    }
+    if (data.engine == ENGINE_SPARSE && (data.grid != GRID_PACKED
+                || data.sched != SCHED_ROWS)) {
+        printf("Error: --engine=sparse keeps its own board "
+                "(no --grid=int or --sched)\n");
+        exit(1);
+    }
+#ifndef GOL_CUDA
+    if (data.engine == ENGINE_CUDA) {
+        printf("Error: --engine=cuda needs a build with make CUDA=1\n");
+        exit(1);
+    }
+#endif
+    if (data.engine == ENGINE_CUDA && (data.grid != GRID_PACKED
+                || data.sched != SCHED_ROWS)) {
+        printf("Error: --engine=cuda needs the packed grid (no --sched)\n");
+        exit(1);
+    }
+    if (data.detect_cycles && data.engine != ENGINE_DIRECT) {
+        printf("Error: --cycles needs --engine=direct\n");
+        exit(1);
+    }
+    if (data.temporal_depth > 1 && (!kernel_is_swar(data.kernel)
+                || data.sched != SCHED_ROWS || data.engine != ENGINE_DIRECT
+                || data.detect_cycles || data.batch)) {
+        printf("Error: --temporal=K needs a packed kernel (swar, avx2 or "
+                "avx512) and no --sched, --engine, --cycles or --batch\n");
+        exit(1);
+    }
+    if (data.stats_path != NULL && (data.sched != SCHED_ROWS
+                || data.engine != ENGINE_DIRECT || data.temporal_depth > 1
+                || data.detect_cycles || data.batch)) {
+        printf("Error: --stats=PATH plays every round with --engine=direct, "
+                "and no --sched, --temporal, --cycles or --batch\n");
+        exit(1);
+    }
+    if (data.export_target != NULL && (data.engine != ENGINE_DIRECT
+                || data.temporal_depth > 1 || data.batch)) {
+        printf("Error: --export=TARGET records every round with "
+                "--engine=direct, and no --temporal or --batch\n");
+        exit(1);
+    }
+#ifndef GOL_PROFILE
+    if (data.trace_path != NULL) {
+        printf("Error: --trace needs a build with make PROFILE=1\n");
+        exit(1);
+    }
+#endif
+    boardmem_setup(data.huge_pages);
+
+    /* shift argv so the file name and run mode are at argv[1] and argv[2]
+     * (with --random, the soup stands in for the file name) */
+    argv += optind - 1;
+
+    /* --serve: the boards to play come in as jobs, each played on its own */
+    if (data.serve) {
+        if (strcmp(argv[1], "0") != 0 || data.random || data.batch
+                || !kernel_is_swar(data.kernel) || data.sched != SCHED_ROWS
+                || data.engine != ENGINE_DIRECT || data.stats_path != NULL
+                || data.export_target != NULL) {
+            printf("Error: --serve plays in mode 0 with a packed kernel "
+                    "(swar, avx2 or avx512) and no --sched, --engine, "
+                    "--random, --batch, --stats or --export\n");
+            exit(1);
+        }
+        exit(batch_serve(data.serve_path, kernel_names[data.kernel],
+                    &data.rule, data.num_threads));
+    }
+    if (data.random) {
+        if (data.batch || data.rounds < 0) {
+            printf("Error: --random needs --rounds=N, and no --batch\n");
+            exit(1);
+        }
+        argv--;
+        argv[1] = random_text;
+    }
+
+    /* --batch: the file lists the boards to play, each on its own */
+    if (data.batch) {
+        if (strcmp(argv[2], "0") != 0 || !kernel_is_swar(data.kernel)
+                || data.sched != SCHED_ROWS || data.engine != ENGINE_DIRECT) {
+            printf("Error: --batch plays in mode 0 with a packed kernel "
+                    "(swar, avx2 or avx512) and no --sched or --engine\n");
+            exit(1);
+        }
+        exit(batch_run(argv[1], kernel_names[data.kernel], &data.rule,
+                    data.num_threads, stdout));
+    }
+
+#ifdef GOL_HEADLESS
+    if (atoi(argv[2]) == OUTPUT_VISI) {
+        printf("Error: mode 2 needs ParaVisi, which gol_headless is built "
+                "without (run it with gol)\n");
         exit(1);
     }
+#endif
 
     /* Initialize game state (all fields in data) from information
      * read from input file */
@@ -119,15 +856,53 @@ int main(int argc, char **argv) {
         printf("Initialization error: file %s, mode %s\n", argv[1], argv[2]);
         exit(1);
     }
+    if (data.engine != ENGINE_DIRECT && data.engine != ENGINE_CUDA
+            && data.output_mode == OUTPUT_VISI) {
+        printf("Error: only --engine=direct and --engine=cuda can animate "
+                "in ParaVisi mode\n");
+        exit(1);
+    }
+    if (data.temporal_depth > 1 && data.output_mode != OUTPUT_NONE) {
+        printf("Error: --temporal=K skips rounds, so it only runs in mode 0\n");
+        exit(1);
+    }
+    ret = setup_view(&data);
+    if (ret != 0) {
+        printf("Error: the --view region must fit on the %d x %d board\n",
+                data.rows, data.cols);
+        exit(1);
+    }
+    play = play_gol;
+    if (data.engine == ENGINE_HASHLIFE) {
+        play = play_hashlife;
+    }
+    else if (data.engine == ENGINE_SPARSE) {
+        play = play_sparse;
+    }
+#ifdef GOL_CUDA
+    else if (data.engine == ENGINE_CUDA) {
+        play = play_cuda;
+    }
+#endif
 
     /* initialize ParaVisi animation (if applicable) */
     if (data.output_mode == OUTPUT_VISI) {
         setup_animation(&data);
     }
+#ifdef GOL_PROFILE
+    if (prof_init(&data.prof, data.trace_path) != 0) {
+        exit(1);
+    }
+    data.tiles_cells = 0;
+#endif
 
     /* ASCII output: clear screen & print the initial board */
     if (data.output_mode == OUTPUT_ASCII) {
-        if (system("clear")) { perror("clear"); exit(1); }
+        if (ascii_init(&data.ascii, STDERR_FILENO, data.rows, data.cols,
+                    data.redraw_rows) != 0) {
+            printf("Error: Failure to allocate the ASCII frame.\n");
+            exit(1);
+        }
         print_board(&data, 0);
     }
 
@@ -137,19 +912,18 @@ int main(int argc, char **argv) {
 
     /* Invoke play_gol in different ways based on the run mode */
     if (data.output_mode == OUTPUT_NONE) {  // run with no animation
-        play_gol(&data);
+        play(&data);
     }
     else if (data.output_mode == OUTPUT_ASCII) { // run with ascii animation
-        play_gol(&data);
-
-        // clear the previous print_board output from the terminal:
-        if (system("clear")) { perror("clear"); exit(1); }
+        play(&data);
 
+        // draw the final board over the previous print_board output:
         print_board(&data, data.iters);
+        ascii_free(&data.ascii);
     }
     else {  // OUTPUT_VISI: run with ParaVisi animation
-            // tell ParaVisi that it should run play_gol
-        connect_animation(play_gol, &data);
+            // tell ParaVisi that it should run play_gol (or play_cuda)
+        connect_animation(play, &data);
         // start ParaVisi animation
         run_animation(data.handle, data.iters);
     }
@@ -157,6 +931,12 @@ int main(int argc, char **argv) {
     //stops the timer right before printing final lines
     ret = gettimeofday(&stop_time, NULL);
 
+    if (data.rle_out != NULL && rle_write(data.rle_out, data.rows,
+                data.cols, data.current_round, data.rule.name,
+                board_cell_alive, &data) != 0) {
+        data.write_failed = 1;
+    }
+
 
     //calculates time elapsed since start of program
     secs = stop_time.tv_sec - start_time.tv_sec;
@@ -166,252 +946,1681 @@ int main(int argc, char **argv) {
     if (data.output_mode != OUTPUT_VISI) {
         /* Print the total runtime, in seconds. */
         fprintf(stdout, "Total time: %0.3f seconds\n", secs);
-        fprintf(stdout, "Number of live cells after %d rounds: %d\n\n",
-                data.iters, total_live);
+        fprintf(stdout, "Number of live cells after %d rounds: %ld\n\n",
+                data.iters, data.total_live);
+    }
+#ifdef GOL_PROFILE
+    if (data.engine == ENGINE_DIRECT) {
+        prof_report(&data.prof, stdout);
+    }
+#endif
+    if (data.huge_pages) {
+        long hugetlb, transparent;
+
+        boardmem_huge_counts(&hugetlb, &transparent);
+        fprintf(stdout, "Huge pages: %ld boards on hugetlb pages, %ld on "
+                "transparent huge pages\n", hugetlb, transparent);
     }
 
-    free(data.cells);
+    if (data.engine == ENGINE_SPARSE) {
+        sparse_free(&data.world);
+    }
+    else if (data.grid == GRID_PACKED) {
+        bitgrid_free(&data.board);
+    }
+    else {
+        boardmem_free(data.cells, int_board_bytes(&data));
+    }
 
 
-    return 0;
+    return data.write_failed;
 }
 
 
-/* initialize the gol game state from command line arguments
- *       argv[1]: name of file to read game config state from
- *       argv[2]: run mode value
- * data: pointer to gol_data struct to initialize
- * argv: command line args
- *       argv[1]: name of file to read game config state from
- *       argv[2]: run mode
- * returns: 0 on success, 1 on error
+/* pick the grid layout and kernel from whichever of the --grid and --kernel
+ * options were given (-1 if not given), and check that they go together.
+ * returns: 0 on success, 1 if the kernel can't run on the grid or this CPU
  */
-int init_game_data_from_args(struct gol_data *data, char **argv) {
-    FILE * infile;
-    int ret;
+int select_kernel(struct gol_data *data) {
 
-    infile = fopen(argv[1], "r");
-    if (infile == NULL) {
-        printf("Error: Failure to open file.\n");
-        return 1;
+    //Default to the fastest portable setup (Generations rules keep a
+    //state per cell, so they need the int grid).
+    if (data->grid == -1 && data->rule.states > 2) {
+        data->grid = GRID_INT;
     }
-
-    /*Reads in output mode from command-line.
-    Sets current round to 0*/
-    data->output_mode = atoi(argv[2]);
-    data->current_round = 0;
-
-    /*Reads in number of rows, columns, iterations, and
-    initially alive cells from txt file.*/
-    ret = fscanf(infile, "%d", &data->rows);
-        if (ret == 0) {return 1;}
-    ret = fscanf(infile, "%d", &data->cols);
-        if (ret == 0) {return 1;}
-    ret = fscanf(infile, "%d", &data->iters);
-        if (ret == 0) {return 1;}
-    ret = fscanf(infile, "%d", &total_live);
-        if (ret == 0) {return 1;}
-
-    //Allocating space based on size of the 2D world.
-    int num_cells = data->rows*data->cols;
-    data->cells = malloc (num_cells * sizeof(int));
-
-    //Set all cells to 0 (dead).
-    for (int i = 0; i < num_cells; i++) {
-        data->cells[i] = 0;
+    if (data->grid == -1 && (data->kernel == -1
+                || data->sched != SCHED_ROWS)) {
+        data->grid = GRID_PACKED;
     }
-
-    //Let x be row coordinate, y be column coordinate of any cell.
-    int x, y;
-    //Set alive cells to 1.
-    for (int j = 0; j < total_live; j++) {
-
-        ret = fscanf(infile, "%d %d", &x, &y);
-        if (ret == 0) {return 1;}
-
-        //convert cell's x-y coordinate to array's index.
-        int idx = x*data->cols + y;
-        data->cells[idx] = 1;
+    if (data->kernel == -1) {
+        data->kernel = (data->grid == GRID_INT) ? KERNEL_NAIVE : KERNEL_SWAR;
+    }
+    if (data->grid == -1) {
+        data->grid = (data->kernel == KERNEL_NAIVE
+                || kernel_uses_halo(data->kernel)) ? GRID_INT : GRID_PACKED;
     }
 
-    ret = fclose(infile);
-    if (ret != 0) {
-        printf("Error: Failure to close file.\n");
+    //The halo and lut kernels need the int grid's halo ring, and the
+    //bit-parallel kernels only work on a packed grid.
+    if (kernel_uses_halo(data->kernel) && data->grid != GRID_INT) {
+        return 1;
+    }
+    if (data->kernel != KERNEL_NAIVE && !kernel_uses_halo(data->kernel)
+            && data->grid != GRID_PACKED) {
         return 1;
     }
 
+    swar_rule_init(&data->swar, data->rule.birth, data->rule.survive);
+    if (data->kernel == KERNEL_AVX2) {
+        if (!swar_have_avx2()) { return 1; }
+        data->swar.step = avx2_step_block;
+    }
+    else if (data->kernel == KERNEL_AVX512) {
+        if (!swar_have_avx512()) { return 1; }
+        data->swar.step = avx512_step_block;
+    }
     return 0;
 }
 
-/*Function to count number of neighbors that a given cell has.
-Params: gol_data file, i-j coords of the cell.
-Return: number of neighbors of a cell.*/
-int count_neighbors(struct gol_data *data, int i, int j){
-    //sets the number of alive neighbors to 0
-    int neighbors = 0;
-    int index_neighbor;
-    int rows = data->rows;
-    int cols = data->cols;
 
-    /*checks each neighbor to see if they are alive and if so increments 
-    the variable neighbors*/
-    for (int l = -1; l <= 1; l++){
-        for(int k = -1; k <= 1; k++){
-            // index_neighbor = (abs(((i + l) % rows) * cols)) + abs((
-            //     (j+k) % cols));       
-            index_neighbor = (((((i+l) % rows) + rows) % rows) * cols) + 
-            ((((j+k) % cols) + cols ) % cols);    
-            if (data->cells[index_neighbor] == 1){
-                neighbors++;
-            }
+/* allocate an all-dead board of data->rows x data->cols for the engine and
+ * grid in use (the sparse engine only allocates chunks as cells come to
+ * life)
+ * returns: 0 on success, 1 on error
+ */
+int alloc_board(struct gol_data *data) {
+    if (data->engine == ENGINE_SPARSE) {
+        if (sparse_init(&data->world, data->rows, data->cols) != 0) {
+            printf("Error: Failure to allocate board.\n");
+            return 1;
         }
     }
-    return neighbors;
+    else if (data->grid == GRID_PACKED) {
+        //All cells start at 0 (dead).
+        if (bitgrid_init(&data->board, data->rows, data->cols) != 0) {
+            printf("Error: Failure to allocate board.\n");
+            return 1;
+        }
+    }
+    else {
+        //All cells start at 0 (dead): boardmem_alloc zero-fills.
+        data->stride = data->cols + 2;
+        data->cells = boardmem_alloc(int_board_bytes(data));
+        if (data->cells == NULL) {
+            printf("Error: Failure to allocate board.\n");
+            return 1;
+        }
+    }
+    return 0;
 }
 
+/* set the cell at x-y coords to 1 (alive) on the board alloc_board made
+ * returns: 0 on success, 1 on error
+ */
+int set_alive(struct gol_data *data, int x, int y) {
+    if (data->engine == ENGINE_SPARSE) {
+        if (sparse_set(&data->world, x, y) != 0) {
+            printf("Error: Failure to allocate board.\n");
+            return 1;
+        }
+    }
+    else if (data->grid == GRID_PACKED) {
+        bitgrid_set(&data->board, x, y, 1);
+    }
+    else {
+        //convert cell's x-y coordinate to array's index.
+        long idx = cell_index(data, x, y);
+        data->cells[idx] = 1;
+    }
+    return 0;
+}
 
+/* rle_decode callback: set the n cells from (i, j) along row i to 1
+ * (alive) on the board of the gol_data at arg
+ * returns: 0 on success, 1 on error
+ */
+int set_alive_run(void *arg, int i, int j, int n) {
+    struct gol_data *data = arg;
 
+    if (data->engine != ENGINE_SPARSE && data->grid == GRID_PACKED) {
+        bitgrid_set_run(&data->board, i, j, n);
+        return 0;
+    }
+    for (int k = 0; k < n; k++) {
+        if (set_alive(data, i, j + k) != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
 
-/*Function to update data for next round without
-affecting the data of current round.*/
-void update_world(struct gol_data *data, int *array, int neighbors, int i, int j) {
+/* rle_write and ascii_draw callback: return 1 if cell (i, j) of the
+ * gol_data at arg is alive, 0 if not */
+int board_cell_alive(void *arg, int i, int j) {
+    return cell_alive(arg, i, j);
+}
 
-    int idx = i*data->cols + j;
-    int temp_cell = data->cells[idx];
-    array[idx] = 0;
+/* read the RLE pattern at path onto the middle of a board of --size, or
+ * one just big enough for it, see rle.h
+ * returns: 0 on success, 1 on error
+ */
+int load_rle(struct gol_data *data, const char *path) {
+    struct rle_reader rle;
+    int ret;
 
-    //If cell is currently alive
-    if (temp_cell == 1) {
-        //and if it has exactly 2 or 3 neighbors
-        if (neighbors == 2) {
-            array[idx] = 1;
-            total_live++;
-        }
-        if (neighbors == 3) {
-            array[idx] = 1;
-            total_live++;
-        }
+    if (rle_open(&rle, path, &data->rule) != 0) {
+        return 1;
+    }
+    data->rows = data->board_rows ? data->board_rows : rle.rows;
+    data->cols = data->board_cols ? data->board_cols : rle.cols;
+    data->iters = data->rounds;
+    if (data->rows < 1 || data->cols < 1
+            || rle.rows > data->rows || rle.cols > data->cols) {
+        printf("Error: the %d x %d pattern in %s doesn't fit on a %d x %d "
+                "board\n", rle.rows, rle.cols, path, data->rows, data->cols);
+        rle_close(&rle);
+        return 1;
     }
 
-    //If cell is not alive and has 3 neighbors
-    if (temp_cell == 0) {
-        if (neighbors == 3){
-            array[idx] = 1;
-            total_live++;
-        }
+    ret = alloc_board(data);
+    if (ret == 0) {
+        ret = rle_decode(&rle, (data->rows - rle.rows) / 2,
+                (data->cols - rle.cols) / 2, set_alive_run, data);
     }
+    data->total_live = rle.live;
+    rle_close(&rle);
+    return ret;
 }
 
+/* fill the board with the --random soup, a block of rows per thread (see
+ * soup.h)
+ * returns: 0 on success, 1 on error
+ */
+int load_random(struct gol_data *data) {
+    struct soup *soup = &data->soup;
+    uint64_t *row;
+    int ret;
 
-/*Use data from the data->cells array to control 
-color of pixels in VISI mode.
-Modified from weekly lab meeting code.*/
-void update_color(struct gol_data * data) {
-    int i, j, rows, cols, idx, b;
-    
-    rows = data->rows;
-    cols = data->cols;
-
-    for (i=0; i < rows; i++) {
-        for (j=0; j < cols; j++) {
-            idx = i*cols + j;
-
-            //Note: (0,0) is upper left on the board and lower left in the image buffer.
-            b = (rows - (i+1))*cols + j;
+    if (data->board_rows != 0) {
+        printf("Error: --size is only for RLE patterns\n");
+        return 1;
+    }
+    data->rows = soup->rows;
+    data->cols = soup->cols;
+    data->iters = data->rounds;
+    ret = alloc_board(data);
+    if (ret != 0) {
+        return 1;
+    }
+    if (data->engine != ENGINE_SPARSE && data->grid == GRID_PACKED) {
+        data->total_live = soup_fill(soup, &data->board, data->num_threads);
+        return 0;
+    }
+    if (data->engine != ENGINE_SPARSE) {
+        data->total_live = soup_fill_bytes(soup,
+                &data->cells[cell_index(data, 0, 0)], data->stride,
+                data->num_threads);
+        return 0;
+    }
 
-            if (data->cells[idx] == 1) {
-                data->image_buff[b] = c3_red;
-            }
-            else {
-                data->image_buff[b] = c3_green;
+    //the sparse engine only takes its live cells one at a time
+    row = malloc(((soup->cols + 63) / 64) * sizeof(uint64_t));
+    if (row == NULL) {
+        printf("Error: Failure to allocate board.\n");
+        return 1;
+    }
+    data->total_live = 0;
+    for (int i = 0; i < soup->rows && ret == 0; i++) {
+        data->total_live += soup_row(soup, i, row);
+        for (int j = 0; j < soup->cols && ret == 0; j++) {
+            if ((row[j >> 6] >> (j & 63)) & 1) {
+                ret = set_alive(data, i, j);
             }
         }
     }
+    free(row);
+    return ret;
 }
 
-
-
-/* the gol application main loop function:
- *  runs rounds of GOL,
- *    * updates program state for next round (world and total_live)
- *    * performs any animation step based on the output/run mode
- *
- *   data: pointer to a struct gol_data  initialized with
- *         all GOL game playing state
+/* pick up a run where the snapshot at path left off, see snapshot.h
+ * returns: 0 on success, 1 on error
  */
-void play_gol(struct gol_data *data) {
+int load_snapshot(struct gol_data *data, const char *path) {
+    struct snapshot snap;
+    struct life_rule recorded;
+    int ret;
+
+    if (snapshot_open(path, &snap) != 0) {
+        return 1;
+    }
+    if (!snapshot_rule_matches(snap.header, &data->rule, &recorded)) {
+        printf("Error: %s was played under %s: resume it with --rule=%s\n",
+                path, recorded.name, recorded.name);
+        snapshot_close(&snap);
+        return 1;
+    }
+    data->rows = snap.header->rows;
+    data->cols = snap.header->cols;
+    data->iters = snap.header->iters;
+    data->start_round = data->current_round = snap.header->round;
+    data->total_live = snap.header->live;
+
+    ret = alloc_board(data);
+    if (ret == 0 && data->engine != ENGINE_SPARSE
+            && data->grid == GRID_PACKED) {
+        //the snapshot is stored just like the packed board
+        memcpy(data->board.bits, snap.bits, (size_t)data->rows
+                * data->board.words * sizeof(uint64_t));
+    }
+    else if (ret == 0) {
+        for (int i = 0; i < data->rows && ret == 0; i++) {
+            const uint64_t *row = snap.bits + (long)i * snap.header->words;
+            for (int j = 0; j < data->cols && ret == 0; j++) {
+                if ((row[j >> 6] >> (j & 63)) & 1) {
+                    ret = set_alive(data, i, j);
+                }
+            }
+        }
+    }
+    snapshot_close(&snap);
+    return ret;
+}
+
+/* initialize the gol game state from command line arguments
+ *       argv[1]: name of file to read game config state from
+ *       argv[2]: run mode value
+ * data: pointer to gol_data struct to initialize
+ * argv: command line args
+ *       argv[1]: name of file to read game config state from (a board
+ *                file, or a snapshot to resume from)
+ *       argv[2]: run mode
+ * returns: 0 on success, 1 on error
+ */
+int init_game_data_from_args(struct gol_data *data, char **argv) {
+    struct board_file file;
+    int ret = 0;
+
+    /*Reads in output mode from command-line.
+    Sets current round to 0*/
+    data->output_mode = atoi(argv[2]);
+    data->current_round = 0;
+    data->start_round = 0;
+
+    if (data->random) {
+        return load_random(data);
+    }
+    if (data->board_rows != 0 && !rle_check(argv[1])) {
+        printf("Error: --size is only for RLE patterns\n");
+        return 1;
+    }
+    if (snapshot_check(argv[1])) {
+        ret = load_snapshot(data, argv[1]);
+        if (ret == 0 && data->rounds >= 0) {
+            if (data->rounds < data->start_round) {
+                printf("Error: the snapshot is already past round %d\n",
+                        data->rounds);
+                return 1;
+            }
+            data->iters = data->rounds;
+        }
+        return ret;
+    }
+    if (rle_check(argv[1])) {
+        if (data->rounds < 0) {
+            printf("Error: %s doesn't say how many rounds to play: "
+                    "use --rounds=N\n", argv[1]);
+            return 1;
+        }
+        return load_rle(data, argv[1]);
+    }
+
+    /*Reads in number of rows, columns, iterations, and
+    initially alive cells from txt file, along with the coordinates of
+    every alive cell (checked to be on the board), see loader.h.*/
+    if (board_load(argv[1], &file, data->num_threads) != 0) {
+        return 1;
+    }
+    data->rows = file.rows;
+    data->cols = file.cols;
+    data->iters = (data->rounds >= 0) ? data->rounds : file.iters;
+    data->total_live = file.num_alive;
+
+    //Allocating space based on size of the 2D world.
+    ret = alloc_board(data);
+
+    //Set alive cells to 1.
+    for (long j = 0; j < file.num_alive && ret == 0; j++) {
+        //Let x be row coordinate, y be column coordinate of any cell.
+        ret = set_alive(data, file.cells[2*j], file.cells[2*j + 1]);
+    }
+
+    board_file_free(&file);
+    return ret;
+}
+
+/*Function to count number of neighbors that a given cell has.
+Params: gol_data file, i-j coords of the cell.
+Return: number of neighbors of a cell.*/
+int count_neighbors(struct gol_data *data, int i, int j){
+    //sets the number of alive neighbors to 0
+    int neighbors = 0;
+    int row_neighbor, col_neighbor;
+    int rows = data->rows;
+    int cols = data->cols;
+
+    /*checks each neighbor to see if they are alive and if so increments 
+    the variable neighbors*/
+    for (int l = -1; l <= 1; l++){
+        for(int k = -1; k <= 1; k++){
+            row_neighbor = (((i+l) % rows) + rows) % rows;
+            col_neighbor = (((j+k) % cols) + cols ) % cols;
+            if (cell_alive(data, row_neighbor, col_neighbor) == 1){
+                neighbors++;
+            }
+        }
+    }
+    return neighbors;
+}
+
+
+
+
+/*Function to refresh the halo ring around the GRID_INT board: each halo
+cell gets a copy of the cell on the opposite edge of the board, so that
+the neighbors of an edge cell can be read straight out of the array with
+the same torus wrap that count_neighbors gets from its modulo arithmetic.
+Run once per round, before halo_step_rows.*/
+void refresh_halo(struct gol_data *data) {
+    int rows = data->rows;
+    int cols = data->cols;
+    int stride = data->stride;
+    uint8_t *cells = data->cells;
+
+    //left and right halo columns
+    for (int i = 0; i < rows; i++) {
+        cells[cell_index(data, i, -1)] = cells[cell_index(data, i, cols-1)];
+        cells[cell_index(data, i, cols)] = cells[cell_index(data, i, 0)];
+    }
+
+    //top and bottom halo rows, including the corners
+    memcpy(&cells[cell_index(data, -1, -1)],
+            &cells[cell_index(data, rows-1, -1)], stride * sizeof(*cells));
+    memcpy(&cells[cell_index(data, rows, -1)],
+            &cells[cell_index(data, 0, -1)], stride * sizeof(*cells));
+}
+
+/*Function to compute rows [row_start, row_end) of next round's GRID_INT
+board like halo_step_rows, under any rule other than Life: each cell's next
+state is looked up in the rule's table by its state and live neighbors.
+Return: number of live cells in those rows of next round's board, or 0
+if count is 0.*/
+long halo_rule_rows(struct gol_data *data, int row_start, int row_end,
+        int count) {
+    int stride = data->stride;
+    long live = 0;
+
+    for (int i = row_start; i < row_end; i++) {
+        uint8_t *mid = &data->cells[cell_index(data, i, 0)];
+        uint8_t *up = mid - stride;
+        uint8_t *down = mid + stride;
+        uint8_t *out = &data->new_world[cell_index(data, i, 0)];
+
+        for (int j = 0; j < data->cols; j++) {
+            //only live cells count, not a Generations rule's dying ones
+            int neighbors = (up[j-1] == 1) + (up[j] == 1) + (up[j+1] == 1)
+                + (mid[j-1] == 1) + (mid[j+1] == 1)
+                + (down[j-1] == 1) + (down[j] == 1) + (down[j+1] == 1);
+
+            out[j] = data->rule.next[mid[j]][neighbors];
+        }
+        if (count) {
+            for (int j = 0; j < data->cols; j++) {
+                live += (out[j] == 1);
+            }
+        }
+    }
+    return live;
+}
+
+/*Function to compute rows [row_start, row_end) of next round's GRID_INT
+board with straight-line, branch-free neighbor counts (the halo ring must
+be up to date).
+Return: number of live cells in those rows of next round's board, or 0
+if count is 0.*/
+long halo_step_rows(struct gol_data *data, int row_start, int row_end,
+        int count) {
+    int stride = data->stride;
+    long live = 0;
+
+    if (!rule_is_life(&data->rule)) {
+        return halo_rule_rows(data, row_start, row_end, count);
+    }
+    for (int i = row_start; i < row_end; i++) {
+        uint8_t *mid = &data->cells[cell_index(data, i, 0)];
+        uint8_t *up = mid - stride;
+        uint8_t *down = mid + stride;
+        uint8_t *out = &data->new_world[cell_index(data, i, 0)];
+
+        for (int j = 0; j < data->cols; j++) {
+            int neighbors = up[j-1] + up[j] + up[j+1]
+                + mid[j-1] + mid[j+1]
+                + down[j-1] + down[j] + down[j+1];
+
+            //alive with 3 neighbors, or with 2 if alive now
+            out[j] = (neighbors == 3) | ((neighbors == 2) & mid[j]);
+        }
+        if (count) {
+            for (int j = 0; j < data->cols; j++) {
+                live += out[j];
+            }
+        }
+    }
+    return live;
+}
+
+/*Function to compute rows [row_start, row_end) of next round's GRID_INT
+board from running column sums (the halo ring must be up to date): the
+number of live cells in each column of the three rows around a cell is
+carried down from one row to the next with one add, for the row coming in
+below, and one subtract, for the row going out above, and a cell's live
+neighbors are then three column sums, less the cell itself.  Its next
+state comes from the rule's table (see rule.h), with no branches.  Only
+state 1 counts as alive, which under a two-state rule is every live cell.
+Return: number of live cells in those rows of next round's board, or 0
+if count is 0.*/
+long lut_step_rows(struct gol_data *data, int row_start, int row_end,
+        int count) {
+    const unsigned char (*next)[9] = data->rule.next;
+    int stride = data->stride;
+    int cols = data->cols;
+    uint8_t *first = &data->cells[cell_index(data, row_start, -1)];
+    uint8_t *sums;
+    long live = 0;
+
+    if (row_start >= row_end) {
+        return 0;
+    }
+    //the column sums for row_start, the halo columns included
+    sums = malloc((cols + 2) * sizeof(*sums));
+    if (sums == NULL) {
+        printf("Error: Failure to allocate the column sums.\n");
+        exit(1);
+    }
+    for (int j = 0; j < cols + 2; j++) {
+        sums[j] = (first[j-stride] == 1) + (first[j] == 1)
+            + (first[j+stride] == 1);
+    }
+
+    for (int i = row_start; i < row_end; i++) {
+        uint8_t *mid = &data->cells[cell_index(data, i, 0)];
+        uint8_t *out = &data->new_world[cell_index(data, i, 0)];
+
+        for (int j = 0; j < cols; j++) {
+            //the column sums count the cell itself, which isn't its own
+            //neighbor
+            int neighbors = sums[j] + sums[j+1] + sums[j+2] - (mid[j] == 1);
+
+            out[j] = next[mid[j]][neighbors];
+        }
+        if (count) {
+            for (int j = 0; j < cols; j++) {
+                live += (out[j] == 1);
+            }
+        }
+
+        if (i + 1 < row_end) {
+            //down a row: the row two below comes in, the one above goes out
+            uint8_t *in = mid + 2 * stride - 1;
+            uint8_t *gone = mid - stride - 1;
+
+            for (int j = 0; j < cols + 2; j++) {
+                sums[j] += (in[j] == 1) - (gone[j] == 1);
+            }
+        }
+    }
+    free(sums);
+    return live;
+}
+
+/*Function to set a cell of next round's board to state (any grid
+layout; the packed grid only holds 0 and 1).*/
+static inline void set_next(struct gol_data *data, int i, int j, int state) {
+    if (data->grid == GRID_PACKED) {
+        bitgrid_set(&data->next, i, j, state);
+    }
+    else {
+        data->new_world[cell_index(data, i, j)] = state;
+    }
+}
+
+/*Function to update data for next round without
+affecting the data of current round, looking the cell's next state up in
+the rule's table (see rule.h) by its state and number of live neighbors.
+Return: 1 if the cell is alive next round, 0 if not.*/
+int update_world(struct gol_data *data, int neighbors, int i, int j) {
+
+    int temp_cell = cell_state(data, i, j);
+    int state = data->rule.next[temp_cell][neighbors];
+
+    set_next(data, i, j, state);
+    return state == 1;
+}
+
+
+/*Function to fill in the --view region and --window size that weren't
+given (the whole board, a pixel per cell), and the colors to paint them in.
+returns: 0 on success, 1 if the region doesn't fit on the board.*/
+int setup_view(struct gol_data *data) {
+    struct paint_view *view = &data->view;
+    struct rgb dead = {c3_green.r, c3_green.g, c3_green.b};
+    struct rgb alive = {c3_red.r, c3_red.g, c3_red.b};
+
+    if (view->rows == 0) {
+        view->rows = data->rows;
+        view->cols = data->cols;
+    }
+    if (view->row + (long)view->rows > data->rows
+            || view->col + (long)view->cols > data->cols) {
+        return 1;
+    }
+    if (view->image_rows == 0) {
+        view->image_rows = view->rows;
+        view->image_cols = view->cols;
+    }
+    paint_lut_init(&data->lut, dead, alive);
+    return 0;
+}
 
+
+/*Use data from a frame's board to control 
+color of pixels in VISI mode: the --view region, a pixel per cell or
+shaded blocks of cells (see paint.h).
+Modified from weekly lab meeting code.*/
+void update_color(struct gol_data * data, const struct bitgrid *board) {
+    PROF_START(start);
+
+    //Note: (0,0) is upper left on the board and lower left in the image buffer.
+    paint_view(&data->lut, &data->view, board,
+            (struct rgb *)data->image_buff);
+    PROF_STOP(&data->prof, PROF_PAINT, start);
+}
+
+
+/*Function to decide whether round k (0 .. iters-1) has to count its live
+cells: always in ASCII mode, where print_board shows the count, otherwise
+only on the last round, which main prints.  --count=all and --stats count
+every round.
+Return: 1 if the round must count, 0 if the kernel can skip counting.*/
+int round_needs_count(struct gol_data *data, int k) {
+    return data->count_mode == COUNT_ALL || data->stats_path != NULL
+        || data->output_mode == OUTPUT_ASCII
+        || k == data->last_round - 1;
+}
+
+/*Function to compute rows [row_start, row_end) of next round's board
+with the selected kernel.
+Return: number of live cells in those rows of next round's board, or 0
+if count is 0.*/
+long step_rows(struct gol_data *data, int row_start, int row_end, int count) {
     int neighbors, temp_cell;
-    int num_cells = data->rows * data->cols;
-    int * new_world = malloc(num_cells * sizeof(int));
+    long live = 0;
 
-    for (int k = 0; k < data->iters; k++) {
+    if (data->kernel == KERNEL_HALO) {
+        return halo_step_rows(data, row_start, row_end, count);
+    }
+    if (data->kernel == KERNEL_LUT) {
+        return lut_step_rows(data, row_start, row_end, count);
+    }
+    if (data->kernel != KERNEL_NAIVE) {
+        return swar_rule_step(&data->swar, &data->board, &data->next,
+                row_start, row_end, 0, data->board.words, count);
+    }
 
-        total_live = 0;
+    for (int i = row_start; i < row_end; i++) {
+        for (int j = 0; j < data->cols; j++) {
+            neighbors = count_neighbors(data, i, j);
+            temp_cell = cell_alive(data, i, j);
+            neighbors -= temp_cell;
+            live += update_world(data, neighbors, i, j);
+        }
+    }
+    return count ? live : 0;
+}
+
+
+/*Function to return how many rows step_rows should compute at a time for
+them (and the rows they came from) to still be in cache when they are read
+again, for the --stats or a PROFILE=1 build's changed cells.*/
+int block_rows(struct gol_data *data) {
+    int row_bytes = (data->grid == GRID_PACKED)
+        ? data->board.words * (int)sizeof(uint64_t) : data->cols;
+    int block = STATS_BLOCK / row_bytes;
+
+    return (block < 1) ? 1 : block;
+}
+
+
+#ifdef GOL_PROFILE
+/*Function to add the cells of rows [row_start, row_end) that changed this
+round, just written by the kernel, to counter's changed cells, and the time
+taken to count them to its diff_ns.*/
+void profile_block(struct gol_data *data, struct live_counter *counter,
+        int row_start, int row_end)
+{
+    PROF_START(diff_start);
+
+    if (data->grid == GRID_PACKED) {
+        counter->changed += gen_stats_changed(&data->board, &data->next,
+                row_start, row_end);
+    }
+    else {
+        for (int i = row_start; i < row_end; i++) {
+            counter->changed += gen_stats_changed_bytes(
+                    &data->cells[cell_index(data, i, 0)],
+                    &data->new_world[cell_index(data, i, 0)], data->cols);
+        }
+    }
+    counter->diff_ns += prof_now() - diff_start;
+}
+
+
+/*Function to compute rows [row_start, row_end) of next round's board like
+step_rows, a block of rows at a time, counting the cells of each block that
+changed with profile_block just after the kernel has written it.
+Return: number of live cells in those rows of next round's board if count
+is nonzero, or 0 if not.*/
+long profile_step_rows(struct gol_data *data, int row_start, int row_end,
+        int count, struct live_counter *counter)
+{
+    int block = block_rows(data);
+    long live = 0;
+
+    for (int i = row_start; i < row_end; i += block) {
+        int end = (i + block < row_end) ? i + block : row_end;
+
+        live += step_rows(data, i, end, count);
+        profile_block(data, counter, i, end);
+    }
+    return live;
+}
+#endif
+
+
+/*Function to compute rows [row_start, row_end) of next round's board like
+step_rows, a block of rows at a time, gathering the --stats of each block
+into counter's stats (and its live columns into its stats_cols, for the
+packed grid) just after the kernel has written it, while it and the rows it
+came from are still in cache.
+Return: number of live cells in those rows of next round's board.*/
+long stats_step_rows(struct gol_data *data, int row_start, int row_end,
+        struct live_counter *counter)
+{
+    struct gen_stats *stats = &counter->stats;
+    uint64_t *cols = counter->stats_cols;
+    int block = block_rows(data);
+
+    gen_stats_clear(stats);
+    for (int i = row_start; i < row_end; i += block) {
+        int end = (i + block < row_end) ? i + block : row_end;
+
+        step_rows(data, i, end, 0);
+#ifdef GOL_PROFILE
+        profile_block(data, counter, i, end);
+#endif
+        if (data->grid == GRID_PACKED) {
+            gen_stats_block(stats, cols, &data->board, &data->next, i, end);
+            continue;
+        }
+        for (int r = i; r < end; r++) {
+            gen_stats_row_bytes(stats, r,
+                    &data->cells[cell_index(data, r, 0)],
+                    &data->new_world[cell_index(data, r, 0)], data->cols);
+        }
+    }
+    if (data->grid == GRID_PACKED) {
+        gen_stats_cols(stats, cols, data->board.words);
+    }
+    return stats->live;
+}
+
+
+/*Function to copy the board, whatever the engine and grid, into out (a
+packed grid of the same size).*/
+void copy_board(struct gol_data *data, struct bitgrid *out) {
+    if (data->engine != ENGINE_SPARSE && data->grid == GRID_PACKED) {
+        memcpy(out->bits, data->board.bits, (size_t)data->rows
+                * data->board.words * sizeof(uint64_t));
+    }
+    else {
+        bitgrid_clear(out);
         for (int i = 0; i < data->rows; i++) {
             for (int j = 0; j < data->cols; j++) {
-                int idx = i*data->cols + j;
-                neighbors = count_neighbors(data, i, j);
-                temp_cell = data->cells[idx];
-                neighbors -= temp_cell;
-                update_world(data, new_world, neighbors, i, j);
+                if (cell_alive(data, i, j)) {
+                    bitgrid_set(out, i, j, 1);
+                }
             }
         }
-    
-        int * temp_array;
+    }
+}
+
+
+/*Function to hand a copy of the board to the snapshot writer, which
+saves it to data->checkpoint_path in the background.*/
+void take_checkpoint(struct gol_data *data) {
+    copy_board(data, snapshot_begin(&data->snapshots));
+    snapshot_commit(&data->snapshots, data->iters, data->current_round);
+}
+
+
+/*Function to hand a copy of the board to the render thread, which draws
+the newest one it has been handed every frame (see frames.h).*/
+void publish_frame(struct gol_data *data) {
+    copy_board(data, frames_back(&data->frames));
+    frames_publish(&data->frames, data->current_round, data->total_live);
+}
+
+
+/*Function to hand a copy of the board to the --export encoders, if it
+is one of the rounds recorded (every export_every rounds, and the first
+and last), waiting for an encoder slot to be free for it, or with
+--export-drop only if one is free (or for the last round, see export.h).*/
+void export_frame(struct gol_data *data) {
+    struct bitgrid *board;
+
+    if (data->current_round % data->export_every != 0
+            && data->current_round != data->start_round
+            && data->current_round != data->last_round) {
+        return;
+    }
+    board = export_begin(&data->exporter, !data->export_drop
+            || data->current_round == data->last_round);
+    if (board != NULL) {
+        copy_board(data, board);
+        export_commit(&data->exporter, data->current_round);
+    }
+}
+
+
+/*Function to start the --export encoders, painting the view at
+--export-size or a pixel per cell, and record the board as it is now.*/
+void start_export(struct gol_data *data) {
+    struct paint_view view = data->view;
+
+    if (data->export_target == NULL) {
+        return;
+    }
+    view.image_rows = data->export_rows ? data->export_rows : view.rows;
+    view.image_cols = data->export_cols ? data->export_cols : view.cols;
+    if (export_start(&data->exporter, data->export_target, data->rows,
+                data->cols, data->iters, &data->rule, &view, &data->lut,
+                data->export_threads) != 0) {
+        exit(1);
+    }
+    export_frame(data);
+}
+
+
+/*Function to stop the --export encoders, once they have written every
+frame handed to them.*/
+void stop_export(struct gol_data *data) {
+    if (data->export_target == NULL) {
+        return;
+    }
+    if (export_stop(&data->exporter) != 0) {
+        printf("Error: Failure to write some frames to %s\n",
+                data->export_target);
+        data->write_failed = 1;
+    }
+    fprintf(stdout, "Export: %ld frames written to %s, %ld dropped with "
+            "the encoders behind\n", data->exporter.written,
+            data->export_target, data->exporter.dropped);
+}
+
+
+/*Render thread callback: draws one frame of the animation, on the
+terminal in ASCII mode or in the ParaVisi window in VISI mode.*/
+void show_frame(void *arg, const struct frame *frame) {
+    struct gol_data *data = arg;
+
+    if (data->output_mode == OUTPUT_ASCII) {
+        PROF_START(start);
+
+        if (ascii_draw(&data->ascii, frame->round, frame->live,
+                    frames_cell_alive, (void *)frame) != 0) {
+            perror("print_board");
+            exit(1);
+        }
+        PROF_STOP(&data->prof, PROF_DRAW, start);
+    }
+    else {
+        update_color(data, &frame->board);
+        draw_ready(data->handle);
+    }
+}
+
+
+/*Function to start the render thread in the animation modes, at --fps or
+the mode's own frame rate.*/
+void start_render(struct gol_data *data) {
+    double fps = data->fps;
+
+    if (data->output_mode == OUTPUT_NONE) {
+        return;
+    }
+    if (fps == 0) {
+        fps = (data->output_mode == OUTPUT_ASCII) ? ASCII_FPS : VISI_FPS;
+    }
+    if (frames_start(&data->frames, data->rows, data->cols, fps,
+                show_frame, data) != 0) {
+        printf("Error: Failure to start the render thread.\n");
+        exit(1);
+    }
+    //the animation starts from the board as it is now
+    publish_frame(data);
+}
+
+
+/*Function to stop the render thread, once it has drawn the last round.*/
+void stop_render(struct gol_data *data) {
+    if (data->output_mode == OUTPUT_NONE) {
+        return;
+    }
+    frames_stop(&data->frames);
+    fprintf(stdout, "Frames: %ld drawn, %ld rounds dropped\n",
+            data->frames.shown, data->frames.dropped);
+}
+
+
+#ifdef GOL_PROFILE
+/*Function to add round's step time (that of the slowest thread) to the
+profile, and to count the cells that were evaluated and the cells that
+changed (see prof.h): the threads playing even blocks of rows counted
+those as they went, and for the tile and --temporal schedules the board is
+compared with next round's here.*/
+void profile_round(struct gol_data *data, long *evaluated, long *changed) {
+    uint64_t step_ns = 0, diff_ns = 0;
+
+    *changed = 0;
+    for (int t = 0; t < data->num_threads; t++) {
+        if (data->live[t].step_ns > step_ns) {
+            step_ns = data->live[t].step_ns;
+        }
+        if (data->live[t].diff_ns > diff_ns) {
+            diff_ns = data->live[t].diff_ns;
+        }
+        *changed += data->live[t].changed;
+    }
+    prof_add(&data->prof, PROF_STEP, step_ns);
+
+    *evaluated = (long)data->rows * data->cols;
+    if (data->sched != SCHED_ROWS) {
+        //only the cells of the tiles that were computed
+        long cells = 0;
+
+        for (int t = 0; t < data->num_threads; t++) {
+            cells += data->tiles.queues[t].cells;
+        }
+        *evaluated = cells - data->tiles_cells;
+        data->tiles_cells = cells;
+    }
+
+    if (data->sched == SCHED_ROWS && data->temporal_depth == 1) {
+        prof_add(&data->prof, PROF_DIFF, diff_ns);
+        return;
+    }
+
+    PROF_START(diff_start);
+    if (data->grid == GRID_PACKED) {
+        *changed = gen_stats_changed(&data->board, &data->next, 0,
+                data->rows);
+    }
+    else {
+        for (int i = 0; i < data->rows; i++) {
+            *changed += gen_stats_changed_bytes(
+                    &data->cells[cell_index(data, i, 0)],
+                    &data->new_world[cell_index(data, i, 0)], data->cols);
+        }
+    }
+    PROF_STOP(&data->prof, PROF_DIFF, diff_start);
+}
+#endif
+
+
+/*Function to look for a cycle in the board that was just swapped in (see
+cycle.h), and once one is confirmed, to cut the run short: the board after
+the last round is the one (iters - round) % period rounds from now.*/
+void check_cycle(struct gol_data *data) {
+    const struct bitgrid *board = &data->board;
+    int round = data->current_round;
+
+    if (data->grid != GRID_PACKED) {
+        copy_board(data, &data->cycle_board);
+        board = &data->cycle_board;
+    }
+    if (cycle_check(&data->cycles, board, round)) {
+        data->last_round = round + (data->iters - round) % data->cycles.period;
+    }
+}
+
+
+/*Function to start looking for cycles from the board as it is now.*/
+void start_cycles(struct gol_data *data) {
+    const struct bitgrid *board = &data->board;
+
+    if (data->grid != GRID_PACKED) {
+        if (bitgrid_init(&data->cycle_board, data->rows, data->cols) != 0) {
+            printf("Error: Failure to allocate board.\n");
+            exit(1);
+        }
+        copy_board(data, &data->cycle_board);
+        board = &data->cycle_board;
+    }
+    if (cycle_init(&data->cycles, data->rows, data->cols, board,
+                data->current_round) != 0) {
+        printf("Error: Failure to allocate board.\n");
+        exit(1);
+    }
+}
+
+
+/*Function to report the cycle found, if any, and to fill in the last round
+and its live cells if the run stopped short of it.*/
+void stop_cycles(struct gol_data *data) {
+    const struct cycle_detector *cycles = &data->cycles;
+
+    if (cycles->period == 0) {
+        fprintf(stdout, "Cycles: none found by round %d\n",
+                data->current_round);
+    }
+    else {
+        //the last round played may not have counted its cells
+        if (data->grid == GRID_PACKED) {
+            data->total_live = bitgrid_count(&data->board);
+        }
+        else {
+            copy_board(data, &data->cycle_board);
+            data->total_live = bitgrid_count(&data->cycle_board);
+        }
+        fprintf(stdout, "Cycles: %s of period %d from round %d (confirmed at "
+                "round %d), %d rounds skipped\n",
+                data->total_live == 0 ? "died out"
+                : cycles->period == 1 ? "still life" : "oscillator",
+                cycles->period, cycles->start, cycles->confirmed,
+                data->iters - data->last_round);
+        data->current_round = data->iters;
+    }
+    cycle_free(&data->cycles);
+    if (data->grid != GRID_PACKED) {
+        bitgrid_free(&data->cycle_board);
+    }
+}
+
+
+/*Function to add up the threads' --stats for the round just played and
+hand them to the stats writer.*/
+void push_stats(struct gol_data *data) {
+    struct gen_stats stats;
+
+    gen_stats_clear(&stats);
+    for (int t = 0; t < data->num_threads; t++) {
+        gen_stats_merge(&stats, &data->live[t].stats);
+    }
+    stats.round = data->current_round;
+    stats_writer_push(&data->stats, &stats);
+}
+
+
+/*Function run by one thread once the board after the rounds rounds just
+played is in place (by end_round, or by a libgol handle's hooks): hands it
+to the render thread in the animation modes and the round's stats to the
+stats writer, looks for a cycle, and takes a snapshot every
+checkpoint_every rounds.*/
+void finish_round(struct gol_data *data, int rounds) {
+    data->current_round = data->current_round + rounds;
+    if (data->stats_path != NULL) {
+        push_stats(data);
+    }
+    if (data->detect_cycles && data->cycles.period == 0) {
+        check_cycle(data);
+    }
+    if (data->output_mode != OUTPUT_NONE) {
+        PROF_START(publish_start);
+
+        publish_frame(data);
+        PROF_STOP(&data->prof, PROF_PUBLISH, publish_start);
+    }
+    if (data->export_target != NULL) {
+        export_frame(data);
+    }
+    if (data->checkpoint_every > 0
+            && data->current_round / data->checkpoint_every
+            != (data->current_round - rounds) / data->checkpoint_every) {
+        take_checkpoint(data);
+    }
+}
+
+
+/*Function run by one thread once all threads have finished round k (the
+last of the rounds rounds just played, more than one with --temporal):
+adds up the threads' live cell counts (if the round counted them), swaps
+in next round's board and finishes the round with finish_round.*/
+void end_round(struct gol_data *data, int k, int rounds) {
+#ifdef GOL_PROFILE
+    long evaluated, changed;
+
+    profile_round(data, &evaluated, &changed);
+#endif
+    PROF_START(count_start);
+
+    //the tile pool keeps its own count
+    if (data->sched != SCHED_ROWS) {
+        tiles_end_round(&data->tiles);
+        data->total_live = data->tiles.total_live;
+    }
+    else if (round_needs_count(data, k)) {
+        data->total_live = 0;
+        for (int t = 0; t < data->num_threads; t++) {
+            data->total_live += data->live[t].count;
+        }
+    }
+    PROF_STOP(&data->prof, PROF_COUNT, count_start);
+
+    PROF_START(swap_start);
+    if (data->grid == GRID_PACKED) {
+        struct bitgrid temp_board;
+        temp_board = data->board;
+        data->board = data->next;
+        data->next = temp_board;
+    }
+    else {
+        uint8_t * temp_array;
         temp_array = data->cells;
-        data->cells = new_world;
-        new_world = temp_array; 
+        data->cells = data->new_world;
+        data->new_world = temp_array;
+        if (kernel_uses_halo(data->kernel)) {
+            refresh_halo(data);
+        }
+    }
+    PROF_STOP(&data->prof, PROF_SWAP, swap_start);
+    finish_round(data, rounds);
+#ifdef GOL_PROFILE
+    prof_end_round(&data->prof, k, evaluated, changed);
+#endif
+}
+
 
-        if (data->output_mode == OUTPUT_ASCII){
-            system("clear");
-            print_board(data, data->iters);
-            usleep(200000);
+/*The main loop of each thread: plays every round on the thread's own
+block of rows (temporal_depth rounds at a time with --temporal), waiting
+at the barrier for the other threads before and after the end of each
+round.*/
+void *play_rows(void *arg) {
+    struct gol_thread *thread = arg;
+    struct gol_data *data = thread->data;
+    int rounds;
+
+    if (data->first_touch) {
+        size_t words = data->board.words;
+
+        memcpy(bitgrid_row(&data->placed, thread->row_start),
+                bitgrid_row(&data->board, thread->row_start),
+                (thread->row_end - thread->row_start) * words
+                * sizeof(uint64_t));
+        pthread_barrier_wait(&data->barrier);
+        if (thread->id == 0) {
+            bitgrid_free(&data->board);
+            data->board = data->placed;
         }
+        pthread_barrier_wait(&data->barrier);
+    }
+
+    for (int k = data->start_round; k < data->last_round; k += rounds) {
+#ifdef GOL_PROFILE
+        data->live[thread->id].changed = 0;
+        data->live[thread->id].diff_ns = 0;
+#endif
+        PROF_START(step_start);
 
-        if (data->output_mode == OUTPUT_VISI){
-            update_color(data);
-            draw_ready(data->handle);
-            usleep(SLEEP_USECS);
+        rounds = data->last_round - k;
+        if (rounds > data->temporal_depth) {
+            rounds = data->temporal_depth;
+        }
+        if (data->temporal_depth > 1) {
+            data->live[thread->id].count = temporal_play(&data->temporal,
+                    thread->id, &data->board, &data->next, rounds,
+                    &data->swar, round_needs_count(data, k + rounds - 1));
+        }
+        else if (data->sched != SCHED_ROWS) {
+            tiles_play(&data->tiles, thread->id, &data->board, &data->next,
+                    &data->swar);
         }
+        else if (data->stats_path != NULL) {
+            data->live[thread->id].count = stats_step_rows(data,
+                    thread->row_start, thread->row_end,
+                    &data->live[thread->id]);
+        }
+        else {
+#ifdef GOL_PROFILE
+            data->live[thread->id].count = profile_step_rows(data,
+                    thread->row_start, thread->row_end,
+                    round_needs_count(data, k), &data->live[thread->id]);
+#else
+            data->live[thread->id].count = step_rows(data, thread->row_start,
+                    thread->row_end, round_needs_count(data, k));
+#endif
+        }
+#ifdef GOL_PROFILE
+        //the changed cells are counted in their own phase
+        data->live[thread->id].step_ns = prof_now() - step_start
+            - data->live[thread->id].diff_ns;
+#endif
+
+        //wait for every thread to finish this round, then have one of them
+        //swap the boards while the others wait for it
+        pthread_barrier_wait(&data->barrier);
+        if (thread->id == 0) {
+            end_round(data, k + rounds - 1, rounds);
+        }
+        pthread_barrier_wait(&data->barrier);
+    }
+    return NULL;
+}
 
-        data->current_round = data->current_round + 1;
+
+/*Function to allocate data->live, the threads' live cell counters, with
+a --stats column mask each on the packed grid.*/
+void alloc_counters(struct gol_data *data) {
+    data->live = aligned_alloc(CACHE_LINE,
+            data->num_threads * sizeof(struct live_counter));
+    if (data->live == NULL) {
+        printf("Error: Failure to allocate threads.\n");
+        exit(1);
+    }
+    for (int t = 0; t < data->num_threads; t++) {
+        data->live[t].count = 0;
+        gen_stats_clear(&data->live[t].stats);
+        data->live[t].stats_cols = NULL;
+        if (data->stats_path != NULL && data->grid == GRID_PACKED) {
+            data->live[t].stats_cols = calloc(data->board.words,
+                    sizeof(uint64_t));
+            if (data->live[t].stats_cols == NULL) {
+                printf("Error: Failure to allocate stats columns.\n");
+                exit(1);
+            }
+        }
+    }
+}
+
+
+/*Function to free data->live and the stats columns it holds.*/
+void free_counters(struct gol_data *data) {
+    for (int t = 0; t < data->num_threads; t++) {
+        free(data->live[t].stats_cols);
+    }
+    free(data->live);
+}
+
+
+/*Hook for gol_play (see libgol.h): returns 1 if the handle's round round,
+round data->start_round + round - 1 of the run, must count its live
+cells.*/
+int handle_count(void *arg, long round) {
+    struct gol_data *data = arg;
+
+    //with --stats, handle_rows counts them every round
+    if (data->stats_path != NULL) {
+        return 0;
+    }
+    return round_needs_count(data, data->start_round + round - 1);
+}
+
+
+/*Function to copy the board of a libgol handle into data->board, gol's own
+copy of it, row by row (the handle's rows may only be read until its next
+round).*/
+void copy_handle_board(struct gol_data *data, struct gol_sim *sim) {
+    long stride;
+
+    for (int i = 0; i < data->rows; i++) {
+        memcpy(bitgrid_row(&data->board, i), gol_region(sim, i, &stride),
+                data->board.words * sizeof(uint64_t));
+    }
+}
+
+
+/*Function to tell whether finish_round will read data->board: for the
+cycle check, the animation, --export or a checkpoint.
+Return: 1 if it will (or may), 0 if not.*/
+int round_reads_board(struct gol_data *data) {
+    return (data->detect_cycles && data->cycles.period == 0)
+        || data->output_mode != OUTPUT_NONE || data->export_target != NULL
+        || data->checkpoint_every > 0;
+}
+
+
+/*Hook for gol_play, run by handle thread id once it has computed a block
+of rows, with --stats: gathers the block's stats into the thread's counter
+like stats_step_rows does, while the rows are still in cache.*/
+void handle_rows(void *arg, int id, const uint64_t *before,
+        const uint64_t *after, long stride, int row_start, int row_end)
+{
+    struct gol_data *data = arg;
+    struct live_counter *counter = &data->live[id];
+    struct bitgrid from = {data->rows, data->cols, stride, (uint64_t *)before};
+    struct bitgrid to = {data->rows, data->cols, stride, (uint64_t *)after};
+
+    gen_stats_block(&counter->stats, counter->stats_cols, &from, &to,
+            row_start, row_end);
+}
+
+
+/*Hook for gol_play, after each round the handle plays: copies the handle's
+board into data->board if the extras read it this round, and finishes the
+round like end_round does once it has swapped the boards (with the
+threads' --stats, which start over for the next round).
+Return: the rounds still to play, fewer once a cycle is found.*/
+long handle_after(void *arg, struct gol_sim *sim, long left) {
+    struct gol_data *data = arg;
+
+    if (round_reads_board(data)) {
+        copy_handle_board(data, sim);
+    }
+    if (data->stats_path != NULL) {
+        data->total_live = 0;
+        for (int t = 0; t < data->num_threads; t++) {
+            gen_stats_cols(&data->live[t].stats, data->live[t].stats_cols,
+                    data->board.words);
+            data->total_live += data->live[t].stats.live;
+        }
+    }
+    else if (round_needs_count(data, data->current_round)) {
+        data->total_live = gol_live(sim);
+    }
+    finish_round(data, 1);
+    if (data->stats_path != NULL) {
+        for (int t = 0; t < data->num_threads; t++) {
+            gen_stats_clear(&data->live[t].stats);
+        }
+    }
+    return data->last_round - data->current_round;
+}
+
+
+/*Function to tell whether play_gol can play the rounds on a libgol handle
+(see libgol.h), which plays packed boards with the bit-parallel kernels,
+split into even blocks of rows.  The rest stay on play_rows' threads: the
+int grid (Generations rules, and the naive, halo and lut kernels), the
+naive kernel on the packed grid, the tile schedulers and --temporal, which
+split up the board their own ways, and the per-thread, per-phase timers of
+a PROFILE=1 build.
+Return: 1 if it can, 0 if not.*/
+int plays_on_handle(struct gol_data *data) {
+#ifdef GOL_PROFILE
+    return 0;
+#else
+    return data->grid == GRID_PACKED && kernel_is_swar(data->kernel)
+        && data->sched == SCHED_ROWS && data->temporal_depth == 1;
+#endif
+}
+
+
+/*Function to play the rounds on a libgol handle, which does the stepping,
+counting and swapping of the boards on its own threads, with the extras
+(animation, cycles, export, checkpoints, stats) run by its hooks.
+The handle plays a copy of the board, copied back into data->board after
+the rounds that the extras read and at the end.*/
+void play_handle(struct gol_data *data) {
+    struct gol_config config = {data->num_threads, data->rule.name,
+        kernel_names[data->kernel]};
+    struct gol_hooks hooks = {handle_count, handle_after, data, NULL, 0};
+    struct gol_sim *sim;
+    int ret;
+
+    ret = gol_create_bits(&sim, data->rows, data->cols, data->board.bits,
+            data->board.words, &config);
+    if (ret != GOL_OK) {
+        printf("Error: Failure to start the board: %s.\n",
+                gol_strerror(ret));
+        exit(1);
     }
+    if (data->stats_path != NULL) {
+        alloc_counters(data);
+        hooks.rows = handle_rows;
+        hooks.block = block_rows(data);
+    }
+
+    ret = gol_play(sim, data->last_round - data->current_round, &hooks);
+    if (ret != GOL_OK) {
+        printf("Error: Failure to play the board: %s.\n", gol_strerror(ret));
+        exit(1);
+    }
+
+    copy_handle_board(data, sim);
+    data->total_live = gol_live(sim);
+    gol_destroy(sim);
+    if (data->stats_path != NULL) {
+        free_counters(data);
+    }
+}
+
+
+/*Function to play the rounds on play_gol's own threads, one play_rows loop
+each (the calling thread plays the first block of rows).*/
+void play_threads(struct gol_data *data) {
+    int nthreads = data->num_threads;
+    struct gol_thread *threads;
+
+    if (data->grid == GRID_PACKED) {
+        if (bitgrid_init(&data->next, data->rows, data->cols) != 0) {
+            printf("Error: Failure to allocate board.\n");
+            exit(1);
+        }
+    }
+    else {
+        data->new_world = boardmem_alloc(int_board_bytes(data));
+        if (data->new_world == NULL) {
+            printf("Error: Failure to allocate board.\n");
+            exit(1);
+        }
+        if (kernel_uses_halo(data->kernel)) {
+            refresh_halo(data);
+        }
+    }
+
+    //The board was filled in by this thread, so its pages are all on this
+    //thread's NUMA node.  With threads playing blocks of rows, each one
+    //copies its own rows to a fresh board first (next's pages are placed
+    //the same way, by each thread's first round).
+    data->first_touch = data->grid == GRID_PACKED && nthreads > 1
+        && data->sched == SCHED_ROWS && (size_t)data->rows
+        * data->board.words * sizeof(uint64_t) >= BOARDMEM_MMAP_BYTES;
+    if (data->first_touch) {
+        if (bitgrid_init(&data->placed, data->rows, data->cols) != 0) {
+            printf("Error: Failure to allocate board.\n");
+            exit(1);
+        }
+    }
+
+    if (data->sched != SCHED_ROWS) {
+        if (tiles_init(&data->tiles, &data->board, nthreads,
+                    data->sched == SCHED_ACTIVE) != 0) {
+            printf("Error: Failure to allocate tiles.\n");
+            exit(1);
+        }
+    }
+    if (data->temporal_depth > 1) {
+        if (temporal_init(&data->temporal, &data->board, data->temporal_depth,
+                    nthreads) != 0) {
+            printf("Error: Failure to allocate the bands.\n");
+            exit(1);
+        }
+    }
+
+    //Split the rows as evenly as possible between the threads.
+    threads = malloc(nthreads * sizeof(struct gol_thread));
+    if (threads == NULL) {
+        printf("Error: Failure to allocate threads.\n");
+        exit(1);
+    }
+    alloc_counters(data);
+    for (int t = 0; t < nthreads; t++) {
+        threads[t].data = data;
+        threads[t].id = t;
+        threads[t].row_start = (long)t * data->rows / nthreads;
+        threads[t].row_end = (long)(t+1) * data->rows / nthreads;
+        if (data->temporal_depth > 1) {
+            temporal_rows(&data->temporal, t, &threads[t].row_start,
+                    &threads[t].row_end);
+        }
+    }
+
+    if (pthread_barrier_init(&data->barrier, NULL, nthreads)) {
+        printf("Error: pthread_barrier_init failed\n");
+        exit(1);
+    }
+    for (int t = 1; t < nthreads; t++) {
+        if (pthread_create(&threads[t].tid, NULL, play_rows, &threads[t])) {
+            printf("Error: pthread_create failed\n");
+            exit(1);
+        }
+    }
+    play_rows(&threads[0]);
+    for (int t = 1; t < nthreads; t++) {
+        pthread_join(threads[t].tid, NULL);
+    }
+    pthread_barrier_destroy(&data->barrier);
+    free(threads);
+    free_counters(data);
+
+    if (data->sched != SCHED_ROWS) {
+        tiles_report(&data->tiles, stdout);
+        tiles_free(&data->tiles);
+    }
+    if (data->temporal_depth > 1) {
+        temporal_free(&data->temporal);
+    }
+
     //frees the heap memory used by the temporary array
-    free(new_world);
+    if (data->grid == GRID_PACKED) {
+        bitgrid_free(&data->next);
+    }
+    else {
+        boardmem_free(data->new_world, int_board_bytes(data));
+    }
 }
 
 
+/* the gol application main loop function:
+ *  runs rounds of GOL,
+ *    * updates program state for next round (world and data->total_live)
+ *    * performs any animation step based on the output/run mode
+ *
+ *  The packed grid's rounds are played on a libgol handle (see
+ *  play_handle) unless the kernel, the scheduler or the build needs them
+ *  played on gol's own threads (play_threads, see plays_on_handle).
+ *
+ *   data: pointer to a struct gol_data  initialized with
+ *         all GOL game playing state
+ */
+void play_gol(struct gol_data *data) {
 
+    data->last_round = data->iters;
+    if (data->detect_cycles) {
+        start_cycles(data);
+    }
+    start_render(data);
+    start_export(data);
+    if (data->checkpoint_every > 0) {
+        if (snapshot_writer_start(&data->snapshots, data->checkpoint_path,
+                    data->rows, data->cols, &data->rule) != 0) {
+            printf("Error: Failure to start the snapshot writer.\n");
+            exit(1);
+        }
+    }
+    if (data->stats_path != NULL) {
+        if (stats_writer_start(&data->stats, data->stats_path,
+                    data->stats_drop) != 0) {
+            printf("Error: Failure to create stats file %s.\n",
+                    data->stats_path);
+            exit(1);
+        }
+    }
 
-/* Print the board to the terminal.
- *   data: gol game specific data
- *   round: the current round number
+    if (plays_on_handle(data)) {
+        play_handle(data);
+    }
+    else {
+        play_threads(data);
+    }
+
+    stop_render(data);
+    stop_export(data);
+    if (data->detect_cycles) {
+        stop_cycles(data);
+    }
+
+    if (data->checkpoint_every > 0) {
+        if (snapshot_writer_stop(&data->snapshots) != 0) {
+            printf("Error: Failure to write some snapshots to %s\n",
+                    data->checkpoint_path);
+            data->write_failed = 1;
+        }
+        fprintf(stdout, "Checkpoints: %ld written to %s, %ld replaced by a "
+                "newer one before being written\n", data->snapshots.written,
+                data->checkpoint_path, data->snapshots.replaced);
+    }
+    if (data->stats_path != NULL) {
+        if (stats_writer_stop(&data->stats) != 0) {
+            printf("Error: Failure to write some stats to %s\n",
+                    data->stats_path);
+            data->write_failed = 1;
+        }
+        fprintf(stdout, "Stats: %ld rounds written to %s, %ld dropped with "
+                "the writer behind\n", data->stats.written, data->stats_path,
+                data->stats.dropped);
+    }
+}
+
+
+
+
+/* Run all data->iters rounds at once with the HashLife engine, leaving the
+ * final board in data->board (no animation between rounds).
+ *   data: pointer to a struct gol_data  initialized with
+ *         all GOL game playing state
  */
-void print_board(struct gol_data *data, int round) {
+void play_hashlife(struct gol_data *data) {
+    struct hashlife_stats stats;
+
+    data->total_live = hashlife_run(&data->board,
+            data->iters - data->start_round,
+            data->hashlife_nodes, &stats);
+    if (data->total_live < 0) {
+        printf("Error: Failure to allocate HashLife nodes.\n");
+        exit(1);
+    }
+    data->current_round = data->iters;
+    fprintf(stdout, "HashLife: %ld jumps, %zu nodes (peak %zu), "
+            "%ld garbage collections\n", stats.steps, stats.nodes,
+            stats.peak_nodes, stats.collections);
+}
+
+
+/* Run the rounds with the sparse engine, which only stores and plays the
+ * chunks of the board around live cells, printing each round in ASCII mode.
+ *   data: pointer to a struct gol_data  initialized with
+ *         all GOL game playing state
+ */
+void play_sparse(struct gol_data *data) {
+
+    start_render(data);
+    for (int k = data->start_round; k < data->iters; k++) {
+        if (sparse_step(&data->world) != 0) {
+            printf("Error: Failure to allocate chunks.\n");
+            exit(1);
+        }
+        data->total_live = data->world.live;
+        data->current_round = data->current_round + 1;
+        if (data->output_mode != OUTPUT_NONE) {
+            publish_frame(data);
+        }
+    }
+    stop_render(data);
+    fprintf(stdout, "Sparse: %zu chunks (peak %zu)\n",
+            data->world.map.count, data->world.peak_chunks);
+}
 
-    int i, j;
-    /* Print the round number. */
-    fprintf(stderr, "Round: %d\n", data->current_round);
-    for (i = 0; i < data->rows; ++i) {
-        for (j = 0; j < data->cols; ++j) { 
 
-            //Convert 2D world's i-j coordinates to array's index.     
-            int idx = i*data->cols + j;
+#ifdef GOL_CUDA
+/* Run the rounds on the GPU (see gpu.h).  Both boards stay on the device:
+ * the board only comes back to the host at the end of the run, and every
+ * round in ASCII mode, for the render thread.  ParaVisi frames are painted
+ * on the device straight into the image buffer, at most --fps a second.
+ *   data: pointer to a struct gol_data  initialized with
+ *         all GOL game playing state
+ */
+void play_cuda(struct gol_data *data) {
+    struct gpu_life gpu;
+    double frame_secs = 1.0 / (data->fps ? data->fps : VISI_FPS);
+    struct timeval last_frame, now;
 
-            //If cell is alive, prints '@', if not prints '.'
-            if (data->cells[idx]==1) {
-                fprintf(stderr, " @");
+    if (gpu_init(&gpu, &data->board) != 0) {
+        printf("Error: Failure to set up the GPU.\n");
+        exit(1);
+    }
+    data->last_round = data->iters;
+    if (data->output_mode == OUTPUT_VISI) {
+        if (gpu_paint_setup(&gpu, &data->lut, &data->view,
+                    (struct rgb *)data->image_buff) != 0
+                || gpu_paint(&gpu) != 0) {
+            printf("Error: Failure to paint on the GPU.\n");
+            exit(1);
+        }
+        draw_ready(data->handle);
+        gettimeofday(&last_frame, NULL);
+    }
+    else {
+        start_render(data);
+    }
+
+    for (int k = data->start_round; k < data->iters; k++) {
+        int count = round_needs_count(data, k);
+
+        if (gpu_step(&gpu, count) != 0) {
+            exit(1);
+        }
+        data->current_round = data->current_round + 1;
+        if (count) {
+            data->total_live = gpu_live(&gpu);
+        }
+        if (data->output_mode == OUTPUT_ASCII) {
+            if (gpu_download(&gpu, &data->board) != 0) {
+                exit(1);
             }
-            else {
-                fprintf(stderr, " .");
+            publish_frame(data);
+        }
+        else if (data->output_mode == OUTPUT_VISI) {
+            gettimeofday(&now, NULL);
+            if (k == data->iters - 1 || now.tv_sec - last_frame.tv_sec
+                    + (now.tv_usec - last_frame.tv_usec) / 1000000.0
+                    >= frame_secs) {
+                if (gpu_paint(&gpu) != 0) {
+                    exit(1);
+                }
+                draw_ready(data->handle);
+                last_frame = now;
             }
         }
-        fprintf(stderr, "\n");
     }
 
-    /* Print the total number of live cells. */
-    fprintf(stderr, "Live cells: %d\n\n", total_live);
+    if (gpu_download(&gpu, &data->board) != 0) {
+        exit(1);
+    }
+    if (data->output_mode != OUTPUT_VISI) {
+        stop_render(data);
+    }
+    gpu_free(&gpu);
+}
+#endif
+
+
+
+
+/* Print the board to the terminal, over the last board printed, as one
+ * frame of the ASCII animation (see ascii.h).
+ *   data: gol game specific data
+ *   round: the current round number
+ */
+void print_board(struct gol_data *data, int round) {
+    PROF_START(start);
+
+    /* The round number, then '@' for each live cell and '.' for each dead
+     * one, then the total number of live cells. */
+    if (ascii_draw(&data->ascii, data->current_round, data->total_live,
+                board_cell_alive, data) != 0) {
+        perror("print_board");
+        exit(1);
+    }
+    PROF_STOP(&data->prof, PROF_DRAW, start);
 }
 
 //$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
@@ -425,9 +2634,12 @@ void print_board(struct gol_data *data, int round) {
 /* initialize ParaVisi animation */
 int setup_animation(struct gol_data* data) {
     /* connect handle to the animation */
+    //the threads that call draw_ready: since the rounds are drawn by the
+    //render thread (see start_render), it is the only one, however many
+    //-t threads play the rounds
     int num_threads = 1;
-    data->handle = init_pthread_animation(num_threads, data->rows,
-            data->cols, visi_name);
+    data->handle = init_pthread_animation(num_threads, data->view.image_rows,
+            data->view.image_cols, visi_name);
     if (data->handle == NULL) {
         printf("ERROR init_pthread_animation\n");
         exit(1);
@@ -0,0 +1,190 @@
+/*
+This is the Game Of Life for a cluster: one board played across all the
+ranks of an MPI job, each keeping its own block of it (see distrib.h).
+*/
+
+
+/*
+ * To run:
+ * mpirun -np 16 ./gol_mpi file1.txt 0  # play file1.txt on 16 ranks
+ * mpirun -np 16 ./gol_mpi gol.snap 0   # resume from a snapshot, which may
+ *                                      # have come from ./gol --checkpoint
+ *
+ * There is no animation: the run mode must be 0.
+ *
+ * Options (given before the file name):
+ *   --kernel=swar   compute 64 cells per word operation (default)
+ *   --kernel=avx2   compute 256 cells per operation
+ *   --kernel=avx512 compute 512 cells per operation
+ *   --rule=B36/S23  play another two-state rule than Life's B3/S23 (swar
+ *                   kernel), see rule.h
+ *   --count=needed  count live cells only after the last round (default)
+ *   --count=all     count live cells every round
+ *   --rounds=N      play N rounds, whatever the input file says
+ *   --checkpoint=N  save a snapshot of the board every N rounds, each rank
+ *                   writing its own block of the one file
+ *   --checkpoint-file=PATH  where to save snapshots (default gol.snap)
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <mpi.h>
+#include "distrib.h"
+#include "rule.h"
+
+/* Two possible ways of keeping the live cell count (--count=) */
+#define COUNT_NEEDED  (0)   // only after the last round
+#define COUNT_ALL     (1)   // every round
+
+int main(int argc, char **argv) {
+
+    int opt, rank, ret;
+    int count_mode = COUNT_NEEDED;
+    int rounds = -1;
+    int checkpoint_every = 0;
+    char *checkpoint_path = "gol.snap";
+    swar_kernel step = swar_step_block;
+    struct swar_rule kernel;
+    struct life_rule rule;
+    struct distrib d;
+    int iters, round;
+    long total_live;
+    double start_time, secs;
+    static struct option long_options[] = {
+        {"kernel", required_argument, NULL, 'k'},
+        {"count", required_argument, NULL, 'c'},
+        {"rounds", required_argument, NULL, 'r'},
+        {"checkpoint", required_argument, NULL, 'p'},
+        {"checkpoint-file", required_argument, NULL, 'f'},
+        {"rule", required_argument, NULL, 'R'},
+        {NULL, 0, NULL, 0}
+    };
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    rule_init_life(&rule);
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        if (opt == 'k' && strcmp(optarg, "swar") == 0) {
+            step = swar_step_block;
+        }
+        else if (opt == 'k' && strcmp(optarg, "avx2") == 0
+                && swar_have_avx2()) {
+            step = avx2_step_block;
+        }
+        else if (opt == 'k' && strcmp(optarg, "avx512") == 0
+                && swar_have_avx512()) {
+            step = avx512_step_block;
+        }
+        else if (opt == 'c' && strcmp(optarg, "all") == 0) {
+            count_mode = COUNT_ALL;
+        }
+        else if (opt == 'c' && strcmp(optarg, "needed") == 0) {
+            count_mode = COUNT_NEEDED;
+        }
+        else if (opt == 'r') {
+            rounds = atoi(optarg);
+            if (rounds < 0) {
+                argc = 0;
+            }
+        }
+        else if (opt == 'p') {
+            checkpoint_every = atoi(optarg);
+            if (checkpoint_every < 1) {
+                argc = 0;
+            }
+        }
+        else if (opt == 'f') {
+            checkpoint_path = optarg;
+        }
+        else if (opt == 'R') {
+            //the packed blocks hold no Generations dying states
+            if (rule_parse(optarg, &rule) != 0 || rule.states > 2) {
+                argc = 0;
+            }
+        }
+        else {
+            argc = 0;  // bad option, or a kernel this CPU can't run
+        }
+    }
+
+    /* check number of command line arguments */
+    if (argc - optind != 2 || strcmp(argv[optind + 1], "0") != 0) {
+        if (rank == 0) {
+            printf("usage: mpirun -np N %s "
+                    "[--kernel=swar|avx2|avx512] [--count=needed|all] "
+                    "[--rounds=N] [--checkpoint=N] [--checkpoint-file=PATH] "
+                    "[--rule=B3/S23] <infile.txt> 0\n", argv[0]);
+            printf("(infile.txt may also be a --checkpoint snapshot)\n");
+        }
+        MPI_Finalize();
+        exit(1);
+    }
+
+    if (!rule_is_life(&rule) && step != swar_step_block) {
+        if (rank == 0) {
+            printf("Error: --kernel=avx2 and avx512 only play B3/S23 "
+                    "(use --kernel=swar for --rule=%s)\n", rule.name);
+        }
+        MPI_Finalize();
+        exit(1);
+    }
+    //Life plays on the kernel asked for, other rules on whichever swar
+    //kernel swar_rule_init finds for them
+    swar_rule_init(&kernel, rule.birth, rule.survive);
+    if (rule_is_life(&rule)) {
+        kernel.step = step;
+    }
+
+    /* each rank reads its own block of the board */
+    if (distrib_load(&d, MPI_COMM_WORLD, argv[optind], &rule, &iters,
+                &round) != 0) {
+        if (rank == 0) {
+            printf("Initialization error: file %s\n", argv[optind]);
+        }
+        MPI_Finalize();
+        exit(1);
+    }
+    if (rounds >= 0) {
+        if (rounds < round) {
+            if (d.rank == 0) {
+                printf("Error: the snapshot is already past round %d\n",
+                        rounds);
+            }
+            distrib_free(&d);
+            MPI_Finalize();
+            exit(1);
+        }
+        iters = rounds;
+    }
+    if (d.rank == 0) {
+        printf("MPI: %d ranks, in a %d x %d grid of blocks\n", d.num_ranks,
+                d.dims[0], d.dims[1]);
+    }
+
+    /* play the rounds, stopping every checkpoint_every for a snapshot */
+    total_live = distrib_count(&d);
+    MPI_Barrier(d.comm);
+    start_time = MPI_Wtime();
+    ret = 0;
+    for (int k = round; k < iters; k++) {
+        total_live = distrib_step(&d, &kernel,
+                count_mode == COUNT_ALL || k == iters - 1);
+        if (checkpoint_every > 0 && (k + 1) % checkpoint_every == 0) {
+            ret |= distrib_save(&d, checkpoint_path, &rule, iters, k + 1);
+        }
+    }
+    MPI_Barrier(d.comm);
+    secs = MPI_Wtime() - start_time;
+
+    if (d.rank == 0) {
+        fprintf(stdout, "Total time: %0.3f seconds\n", secs);
+        fprintf(stdout, "Number of live cells after %d rounds: %ld\n\n",
+                iters, total_live);
+    }
+
+    distrib_free(&d);
+    MPI_Finalize();
+    return ret;
+}
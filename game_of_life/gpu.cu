@@ -0,0 +1,316 @@
+/*
+ * CUDA engine for the Game Of Life.
+ * See gpu.h for what stays on the device and how a round is played.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <cuda_runtime.h>
+#include "gpu.h"
+#include "swar.h"
+
+#define TILE_THREADS  (GPU_TILE_ROWS * GPU_TILE_WORDS)
+#define PAINT_SIDE    (16)  // a paint block is PAINT_SIDE x PAINT_SIDE pixels
+
+/* the dead to alive shades of the paint table (see paint.h) */
+__constant__ struct rgb shades[256];
+
+/* print what failed if err is an error
+ * returns: 1 if it is, 0 if not */
+static int failed(cudaError_t err, const char *what) {
+    if (err != cudaSuccess) {
+        printf("Error: CUDA %s: %s\n", what, cudaGetErrorString(err));
+        return 1;
+    }
+    return 0;
+}
+
+/* return x wrapped around into [0, n) */
+__device__ static inline int wrap(int x, int n) {
+    return ((x % n) + n) % n;
+}
+
+/* return the mask of real (non-padding) bits in word k of a row */
+__device__ static inline uint64_t word_mask(int k, int words, int cols) {
+    if (k == words - 1 && (cols & 63) != 0) {
+        return ((uint64_t)1 << (cols & 63)) - 1;
+    }
+    return ~(uint64_t)0;
+}
+
+/* return word k, w, shifted so each bit holds its west neighbor, given the
+ * word left of it in the row (the row's last word, for word 0) */
+__device__ static inline uint64_t west_word(uint64_t w, uint64_t left, int k,
+        int cols)
+{
+    // column 0 wraps around to the last column
+    uint64_t carry = (k > 0) ? left >> 63 : (left >> ((cols-1) & 63)) & 1;
+
+    return (w << 1) | carry;
+}
+
+/* return word k, w, shifted so each bit holds its east neighbor, given the
+ * word right of it in the row (word 0, for the row's last word) */
+__device__ static inline uint64_t east_word(uint64_t w, uint64_t right,
+        int k, int words, int cols)
+{
+    // the last column wraps around to column 0
+    uint64_t carry = (k < words - 1) ? right << 63
+        : (right & 1) << ((cols-1) & 63);
+
+    return (w >> 1) | carry;
+}
+
+/* play one round from board into next: each block a tile of words, each
+ * thread a word, adding the tile's live cells to *live if live isn't NULL
+ * (blockIdx.x picks the tile's rows, blockIdx.y its words) */
+__global__ static void life_kernel(const uint64_t *board, uint64_t *next,
+        int rows, int cols, int words, unsigned long long *live)
+{
+    __shared__ uint64_t tile[GPU_TILE_ROWS + 2][GPU_TILE_WORDS + 2];
+    __shared__ unsigned int warp_live[TILE_THREADS / 32];
+    int i0 = blockIdx.x * GPU_TILE_ROWS;
+    int k0 = blockIdx.y * GPU_TILE_WORDS;
+    int tx = threadIdx.x;
+    int ty = threadIdx.y;
+    int i = i0 + ty;
+    int k = k0 + tx;
+    int lane = ty * GPU_TILE_WORDS + tx;
+    uint64_t result = 0;
+
+    //the tile and the ring of words around it, wrapping around the board
+    //(words past the board's right edge are only read as word 0, the
+    //neighbor of the last word)
+    for (int t = lane; t < (GPU_TILE_ROWS + 2) * (GPU_TILE_WORDS + 2);
+            t += TILE_THREADS) {
+        int r = t / (GPU_TILE_WORDS + 2);
+        int c = t % (GPU_TILE_WORDS + 2);
+
+        tile[r][c] = board[(size_t)wrap(i0 - 1 + r, rows) * words
+            + wrap(k0 - 1 + c, words)];
+    }
+    __syncthreads();
+
+    if (i < rows && k < words) {
+        const uint64_t *up = tile[ty];
+        const uint64_t *mid = tile[ty + 1];
+        const uint64_t *down = tile[ty + 2];
+        int c = tx + 1;
+
+        LIFE_ADDERS(west_word(up[c], up[c-1], k, cols), up[c],
+                east_word(up[c], up[c+1], k, words, cols),
+                west_word(mid[c], mid[c-1], k, cols),
+                east_word(mid[c], mid[c+1], k, words, cols),
+                west_word(down[c], down[c-1], k, cols), down[c],
+                east_word(down[c], down[c+1], k, words, cols),
+                mid[c], result);
+        result &= word_mask(k, words, cols);
+        next[(size_t)i * words + k] = result;
+    }
+
+    //add up the block's live cells: each warp with shuffles, then one
+    //atomic add for the block
+    if (live != NULL) {
+        unsigned int n = __popcll(result);
+
+        for (int offset = 16; offset > 0; offset /= 2) {
+            n += __shfl_down_sync(0xffffffff, n, offset);
+        }
+        if (lane % 32 == 0) {
+            warp_live[lane / 32] = n;
+        }
+        __syncthreads();
+        if (lane == 0) {
+            unsigned long long sum = 0;
+
+            for (int w = 0; w < TILE_THREADS / 32; w++) {
+                sum += warp_live[w];
+            }
+            atomicAdd(live, sum);
+        }
+    }
+}
+
+/* return the number of live cells in columns [col_start, col_end) of row */
+__device__ static inline int count_cells(const uint64_t *row, int col_start,
+        int col_end)
+{
+    int first = col_start >> 6;
+    int last = (col_end - 1) >> 6;
+    uint64_t first_mask = ~(uint64_t)0 << (col_start & 63);
+    uint64_t last_mask = ~(uint64_t)0 >> (63 - ((col_end - 1) & 63));
+    int count;
+
+    if (first == last) {
+        return __popcll(row[first] & first_mask & last_mask);
+    }
+    count = __popcll(row[first] & first_mask);
+    for (int k = first + 1; k < last; k++) {
+        count += __popcll(row[k]);
+    }
+    return count + __popcll(row[last] & last_mask);
+}
+
+/* return the first board row or column of pixel p of n across a region of
+ * size cells starting at start */
+__device__ static inline int block_start(int start, int size, int p, int n) {
+    return start + (int)((long)p * size / n);
+}
+
+/* paint the view's region of board into image, a pixel per thread, shaded
+ * by how much of its block of cells is alive (a block of one cell, at one
+ * pixel per cell, gets the dead or the live color) */
+__global__ static void paint_kernel(const uint64_t *board, int words,
+        struct paint_view view, struct rgb *image)
+{
+    int x = blockIdx.x * blockDim.x + threadIdx.x;
+    int y = blockIdx.y * blockDim.y + threadIdx.y;
+    int row_start, row_end, col_start, col_end;
+    long live = 0;
+
+    if (x >= view.image_cols || y >= view.image_rows) {
+        return;
+    }
+    row_start = block_start(view.row, view.rows, y, view.image_rows);
+    row_end = block_start(view.row, view.rows, y + 1, view.image_rows);
+    col_start = block_start(view.col, view.cols, x, view.image_cols);
+    col_end = block_start(view.col, view.cols, x + 1, view.image_cols);
+    if (row_end == row_start) {
+        row_end++;
+    }
+    if (col_end == col_start) {
+        col_end++;
+    }
+    for (int i = row_start; i < row_end; i++) {
+        live += count_cells(board + (size_t)i * words, col_start, col_end);
+    }
+
+    //row 0 of the board is at the top of the image, which is stored last
+    image[(long)(view.image_rows - 1 - y) * view.image_cols + x] =
+        shades[live * 255 / ((long)(row_end - row_start)
+                * (col_end - col_start))];
+}
+
+/* copy board to the device, see gpu.h
+ * returns: 0 on success, 1 on error
+ */
+int gpu_init(struct gpu_life *gpu, const struct bitgrid *board) {
+    size_t bytes = (size_t)board->rows * board->words * sizeof(uint64_t);
+
+    memset(gpu, 0, sizeof(*gpu));
+    gpu->rows = board->rows;
+    gpu->cols = board->cols;
+    gpu->words = board->words;
+    if ((board->words + GPU_TILE_WORDS - 1) / GPU_TILE_WORDS > 65535) {
+        printf("Error: the board is too wide for the CUDA engine\n");
+        return 1;
+    }
+
+    //mapped host memory (for the image) has to be asked for up front
+    cudaSetDeviceFlags(cudaDeviceMapHost);
+    if (failed(cudaMalloc(&gpu->board, bytes), "board")
+            || failed(cudaMalloc(&gpu->next, bytes), "board")
+            || failed(cudaMalloc(&gpu->live, sizeof(*gpu->live)), "count")
+            || failed(cudaMemcpy(gpu->board, board->bits, bytes,
+                    cudaMemcpyHostToDevice), "copy to the device")) {
+        gpu_free(gpu);
+        return 1;
+    }
+    return 0;
+}
+
+/* free the device's boards, and unmap the image */
+void gpu_free(struct gpu_life *gpu) {
+    cudaFree(gpu->board);
+    cudaFree(gpu->next);
+    cudaFree(gpu->live);
+    if (gpu->host_image != NULL) {
+        cudaHostUnregister(gpu->host_image);
+    }
+    gpu->board = gpu->next = NULL;
+    gpu->live = NULL;
+    gpu->image = gpu->host_image = NULL;
+}
+
+/* play one round on the device, see gpu.h
+ * returns: 0 on success, 1 on error
+ */
+int gpu_step(struct gpu_life *gpu, int count) {
+    dim3 threads(GPU_TILE_WORDS, GPU_TILE_ROWS);
+    dim3 blocks((gpu->rows + GPU_TILE_ROWS - 1) / GPU_TILE_ROWS,
+            (gpu->words + GPU_TILE_WORDS - 1) / GPU_TILE_WORDS);
+    uint64_t *temp;
+
+    //launches run in order, so the count is cleared before the round
+    if (count && failed(cudaMemsetAsync(gpu->live, 0, sizeof(*gpu->live)),
+                "count")) {
+        return 1;
+    }
+    life_kernel<<<blocks, threads>>>(gpu->board, gpu->next, gpu->rows,
+            gpu->cols, gpu->words, count ? gpu->live : NULL);
+    if (failed(cudaGetLastError(), "round")) {
+        return 1;
+    }
+    temp = gpu->board;
+    gpu->board = gpu->next;
+    gpu->next = temp;
+    return 0;
+}
+
+/* return the live cells after the last round that counted them, or -1 on
+ * error */
+long gpu_live(struct gpu_life *gpu) {
+    unsigned long long live;
+
+    if (failed(cudaMemcpy(&live, gpu->live, sizeof(live),
+                    cudaMemcpyDeviceToHost), "count")) {
+        return -1;
+    }
+    return (long)live;
+}
+
+/* copy the device's board back into board
+ * returns: 0 on success, 1 on error
+ */
+int gpu_download(struct gpu_life *gpu, struct bitgrid *board) {
+    return failed(cudaMemcpy(board->bits, gpu->board, (size_t)gpu->rows
+                * gpu->words * sizeof(uint64_t), cudaMemcpyDeviceToHost),
+            "copy from the device");
+}
+
+/* map the image buffer for painting the view into, see gpu.h
+ * returns: 0 on success, 1 on error
+ */
+int gpu_paint_setup(struct gpu_life *gpu, const struct paint_lut *lut,
+        const struct paint_view *view, struct rgb *image)
+{
+    size_t bytes = (size_t)view->image_rows * view->image_cols
+        * sizeof(struct rgb);
+
+    if (failed(cudaMemcpyToSymbol(shades, lut->shades, sizeof(lut->shades)),
+                "paint table")
+            || failed(cudaHostRegister(image, bytes, cudaHostRegisterMapped),
+                "image buffer")) {
+        return 1;
+    }
+    gpu->host_image = image;
+    gpu->view = *view;
+    if (failed(cudaHostGetDevicePointer((void **)&gpu->image, image, 0),
+                "image buffer")) {
+        return 1;
+    }
+    return 0;
+}
+
+/* paint the board into the mapped image, and wait for it to be done
+ * returns: 0 on success, 1 on error
+ */
+int gpu_paint(struct gpu_life *gpu) {
+    dim3 threads(PAINT_SIDE, PAINT_SIDE);
+    dim3 blocks((gpu->view.image_cols + PAINT_SIDE - 1) / PAINT_SIDE,
+            (gpu->view.image_rows + PAINT_SIDE - 1) / PAINT_SIDE);
+
+    paint_kernel<<<blocks, threads>>>(gpu->board, gpu->words, gpu->view,
+            gpu->image);
+    return failed(cudaGetLastError(), "paint")
+        || failed(cudaDeviceSynchronize(), "paint");
+}
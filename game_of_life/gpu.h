@@ -0,0 +1,83 @@
+#ifndef __GPU_H__
+#define __GPU_H__
+
+#include <stdint.h>
+#include "bitgrid.h"
+#include "paint.h"
+
+/* CUDA engine for the Game Of Life (--engine=cuda, built in with
+ * make CUDA=1).
+ *
+ * Both boards stay in device memory for the whole run, in the bitgrid
+ * layout.  Each round is one kernel launch: every block of GPU_TILE_ROWS x
+ * GPU_TILE_WORDS threads loads its tile of words and the ring of words
+ * around it (wrapping around the torus) into shared memory, and each thread
+ * computes the next state of its word's 64 cells from there, with the same
+ * full adders as the CPU kernels (LIFE_ADDERS in swar.h).  On rounds that
+ * need the live count, each block adds up its cells with warp shuffles and
+ * adds its total to a counter in device memory, so that only those 8 bytes
+ * come back to the host.
+ *
+ * In ParaVisi mode, the image buffer is pinned and mapped into the device's
+ * address space, and a paint kernel shades the view's pixels straight into
+ * it (a pixel per thread, like paint_view), so the board never comes back
+ * to the host and update_color drops out of the loop.
+ */
+
+#define GPU_TILE_ROWS   (8)   // rows of words in a block's tile
+#define GPU_TILE_WORDS  (32)  // words across a block's tile (one warp)
+
+struct gpu_life {
+    int rows;          // the row dimension
+    int cols;          // the column dimension
+    int words;         // 64-bit words in each row
+    uint64_t *board;   // the board, in device memory
+    uint64_t *next;    // next round's board, in device memory
+    unsigned long long *live;  // live cells after the last counted round,
+                               // in device memory
+
+    /* the ParaVisi image, once gpu_paint_setup has mapped it */
+    struct rgb *image;       // the image buffer, as the device sees it
+    struct rgb *host_image;  // the image buffer, as the host sees it
+    struct paint_view view;  // the region of the board painted into it
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* copy board to the device, and set up the engine to play it
+ * returns 0 on success, 1 on error */
+int gpu_init(struct gpu_life *gpu, const struct bitgrid *board);
+
+/* free the device's boards, and unmap the image */
+void gpu_free(struct gpu_life *gpu);
+
+/* play one round on the device, counting its live cells if count is
+ * nonzero (see gpu_live)
+ * returns 0 on success, 1 on error */
+int gpu_step(struct gpu_life *gpu, int count);
+
+/* return the live cells after the last round that counted them, or -1 on
+ * error */
+long gpu_live(struct gpu_life *gpu);
+
+/* copy the device's board back into board (of the same size)
+ * returns 0 on success, 1 on error */
+int gpu_download(struct gpu_life *gpu, struct bitgrid *board);
+
+/* map the image_rows x image_cols image buffer for painting the view into,
+ * shaded with lut's colors (see paint.h)
+ * returns 0 on success, 1 on error */
+int gpu_paint_setup(struct gpu_life *gpu, const struct paint_lut *lut,
+        const struct paint_view *view, struct rgb *image);
+
+/* paint the board into the mapped image, and wait for it to be done
+ * returns 0 on success, 1 on error */
+int gpu_paint(struct gpu_life *gpu);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __GPU_H__ */
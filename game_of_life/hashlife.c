@@ -0,0 +1,470 @@
+/*
+ * HashLife engine for the Game Of Life.  See hashlife.h.
+ *
+ * A node at level k is a 2^k x 2^k square: level 0 nodes are single cells
+ * and every other node is built from four level k-1 quadrants.  Nodes are
+ * hash-consed, so two equal squares are always the same node, and a node's
+ * result (its center 2^(k-1) x 2^(k-1) square, 2^j generations on, for some
+ * j <= k-2) can be memoized in the node itself.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include "hashlife.h"
+
+#define HL_MAX_LEVEL   (64)
+#define HL_BLOCK_NODES (4096)  // nodes allocated at a time
+
+struct hl_node {
+    struct hl_node *nw, *ne, *sw, *se;  // quadrants (NULL at level 0)
+    struct hl_node *result;  // memoized future, or NULL
+    struct hl_node *next;    // next node in the same hash table chain
+    uint64_t population;     // number of live cells in the square
+    int level;               // the square is 2^level cells on a side
+    int result_step;         // result is 2^result_step generations on
+    int mark;                // reachable in the current collection
+};
+
+/* a block of nodes, allocated together */
+struct hl_block {
+    struct hl_block *next;
+    struct hl_node nodes[HL_BLOCK_NODES];
+};
+
+struct hashlife {
+    struct hl_node **table;   // hash table of all nodes above level 0
+    size_t table_size;        // number of chains, a power of two
+    size_t num_nodes;         // nodes in the table
+    size_t max_nodes;         // collect garbage above this many nodes
+    struct hl_node leaf[2];   // the dead and alive cells
+    struct hl_node *empty[HL_MAX_LEVEL];  // the all-dead node of each level
+    struct hl_block *blocks;  // every block allocated
+    struct hl_node *free_list;  // unused nodes, chained through next
+    struct hashlife_stats stats;
+    jmp_buf out_of_memory;    // where to go if an allocation fails
+};
+
+/* return the hash table chain for the node with these quadrants */
+static size_t hash_quads(const struct hashlife *hl, const struct hl_node *nw,
+        const struct hl_node *ne, const struct hl_node *sw,
+        const struct hl_node *se)
+{
+    uint64_t h = (uintptr_t)nw;
+
+    h = h * 0x9E3779B97F4A7C15ULL + (uintptr_t)ne;
+    h = h * 0x9E3779B97F4A7C15ULL + (uintptr_t)sw;
+    h = h * 0x9E3779B97F4A7C15ULL + (uintptr_t)se;
+    h ^= h >> 29;
+    return h & (hl->table_size - 1);
+}
+
+/* double the number of hash table chains */
+static void grow_table(struct hashlife *hl) {
+    size_t old_size = hl->table_size;
+    struct hl_node **old_table = hl->table;
+
+    hl->table = calloc(old_size * 2, sizeof(struct hl_node *));
+    if (hl->table == NULL) {
+        longjmp(hl->out_of_memory, 1);
+    }
+    hl->table_size = old_size * 2;
+    for (size_t c = 0; c < old_size; c++) {
+        struct hl_node *n = old_table[c];
+        while (n != NULL) {
+            struct hl_node *next = n->next;
+            size_t h = hash_quads(hl, n->nw, n->ne, n->sw, n->se);
+            n->next = hl->table[h];
+            hl->table[h] = n;
+            n = next;
+        }
+    }
+    free(old_table);
+}
+
+/* return the one node with these four quadrants, making it if need be */
+static struct hl_node *find_node(struct hashlife *hl, struct hl_node *nw,
+        struct hl_node *ne, struct hl_node *sw, struct hl_node *se)
+{
+    size_t h = hash_quads(hl, nw, ne, sw, se);
+    struct hl_node *n;
+
+    for (n = hl->table[h]; n != NULL; n = n->next) {
+        if (n->nw == nw && n->ne == ne && n->sw == sw && n->se == se) {
+            return n;
+        }
+    }
+
+    if (hl->free_list == NULL) {
+        struct hl_block *block = malloc(sizeof(struct hl_block));
+        if (block == NULL) {
+            longjmp(hl->out_of_memory, 1);
+        }
+        block->next = hl->blocks;
+        hl->blocks = block;
+        for (int b = 0; b < HL_BLOCK_NODES; b++) {
+            block->nodes[b].next = hl->free_list;
+            hl->free_list = &block->nodes[b];
+        }
+    }
+    n = hl->free_list;
+    hl->free_list = n->next;
+
+    n->nw = nw;
+    n->ne = ne;
+    n->sw = sw;
+    n->se = se;
+    n->result = NULL;
+    n->result_step = -1;
+    n->population = nw->population + ne->population
+        + sw->population + se->population;
+    n->level = nw->level + 1;
+    n->mark = 0;
+    n->next = hl->table[h];
+    hl->table[h] = n;
+
+    hl->num_nodes++;
+    if (hl->num_nodes > hl->stats.peak_nodes) {
+        hl->stats.peak_nodes = hl->num_nodes;
+    }
+    if (hl->num_nodes > hl->table_size) {
+        grow_table(hl);
+    }
+    return n;
+}
+
+/* return the all-dead node of the given level */
+static struct hl_node *empty_node(struct hashlife *hl, int level) {
+    if (hl->empty[level] == NULL) {
+        struct hl_node *e = empty_node(hl, level - 1);
+        hl->empty[level] = find_node(hl, e, e, e, e);
+    }
+    return hl->empty[level];
+}
+
+/* return the node made of four copies of n: the same plane, if n is one
+ * tile of a periodic plane */
+static struct hl_node *tile4(struct hashlife *hl, struct hl_node *n) {
+    return find_node(hl, n, n, n, n);
+}
+
+/* return the center half of n, with no time passing */
+static struct hl_node *center(struct hashlife *hl, struct hl_node *n) {
+    return find_node(hl, n->nw->se, n->ne->sw, n->sw->ne, n->se->nw);
+}
+
+/* return the next generation of the center 2x2 cells of a level 2 node */
+static struct hl_node *base_result(struct hashlife *hl, struct hl_node *n) {
+    struct hl_node *quads[4] = { n->nw, n->ne, n->sw, n->se };
+    struct hl_node *out[4];
+    int cells[4][4];
+
+    //unpack the 4x4 cells, quadrant by quadrant
+    for (int q = 0; q < 4; q++) {
+        int r = (q / 2) * 2, c = (q % 2) * 2;
+        cells[r][c] = quads[q]->nw == &hl->leaf[1];
+        cells[r][c+1] = quads[q]->ne == &hl->leaf[1];
+        cells[r+1][c] = quads[q]->sw == &hl->leaf[1];
+        cells[r+1][c+1] = quads[q]->se == &hl->leaf[1];
+    }
+
+    for (int q = 0; q < 4; q++) {
+        int i = 1 + q / 2, j = 1 + q % 2;
+        int neighbors = -cells[i][j];
+
+        for (int l = -1; l <= 1; l++) {
+            for (int k = -1; k <= 1; k++) {
+                neighbors += cells[i+l][j+k];
+            }
+        }
+        out[q] = &hl->leaf[neighbors == 3 || (neighbors == 2 && cells[i][j])];
+    }
+    return find_node(hl, out[0], out[1], out[2], out[3]);
+}
+
+/* return the center half of n (level >= 2), 2^step generations on, where
+ * step <= level - 2 */
+static struct hl_node *result(struct hashlife *hl, struct hl_node *n,
+        int step)
+{
+    struct hl_node *sub[3][3], *res[2][2];
+    int full = (step == n->level - 2);
+
+    if (n->result != NULL && n->result_step == step) {
+        return n->result;
+    }
+    if (n->population == 0) {
+        return empty_node(hl, n->level - 1);
+    }
+    if (n->level == 2) {
+        n->result = base_result(hl, n);
+        n->result_step = step;
+        return n->result;
+    }
+
+    //the nine overlapping squares of half n's size
+    sub[0][0] = n->nw;
+    sub[0][1] = find_node(hl, n->nw->ne, n->ne->nw, n->nw->se, n->ne->sw);
+    sub[0][2] = n->ne;
+    sub[1][0] = find_node(hl, n->nw->sw, n->nw->se, n->sw->nw, n->sw->ne);
+    sub[1][1] = find_node(hl, n->nw->se, n->ne->sw, n->sw->ne, n->se->nw);
+    sub[1][2] = find_node(hl, n->ne->sw, n->ne->se, n->se->nw, n->se->ne);
+    sub[2][0] = n->sw;
+    sub[2][1] = find_node(hl, n->sw->ne, n->se->nw, n->sw->se, n->se->sw);
+    sub[2][2] = n->se;
+
+    //a full step spends half its time on each of two stages, a shorter
+    //one spends it all on the second
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+            sub[r][c] = full ? result(hl, sub[r][c], step - 1)
+                : center(hl, sub[r][c]);
+        }
+    }
+    for (int r = 0; r < 2; r++) {
+        for (int c = 0; c < 2; c++) {
+            struct hl_node *quad = find_node(hl, sub[r][c], sub[r][c+1],
+                    sub[r+1][c], sub[r+1][c+1]);
+            res[r][c] = result(hl, quad, full ? step - 1 : step);
+        }
+    }
+
+    n->result = find_node(hl, res[0][0], res[0][1], res[1][0], res[1][1]);
+    n->result_step = step;
+    return n->result;
+}
+
+/* return the level node whose cell (y, x) is board cell
+ * ((y0 + y) mod rows, (x0 + x) mod cols), for y0, x0 >= 0 */
+static struct hl_node *build(struct hashlife *hl, const struct bitgrid *board,
+        int level, long y0, long x0)
+{
+    long half;
+
+    if (level == 0) {
+        return &hl->leaf[bitgrid_get(board, y0 % board->rows,
+                x0 % board->cols)];
+    }
+    half = 1L << (level - 1);
+    return find_node(hl, build(hl, board, level - 1, y0, x0),
+            build(hl, board, level - 1, y0, x0 + half),
+            build(hl, board, level - 1, y0 + half, x0),
+            build(hl, board, level - 1, y0 + half, x0 + half));
+}
+
+/* copy the live cells of n, whose top left corner is at (y0, x0), into
+ * the part of board they cover */
+static void extract(const struct hashlife *hl, const struct hl_node *n,
+        struct bitgrid *board, long y0, long x0)
+{
+    long half;
+
+    if (n->population == 0 || y0 >= board->rows || x0 >= board->cols) {
+        return;
+    }
+    if (n->level == 0) {
+        bitgrid_set(board, y0, x0, 1);
+        return;
+    }
+    half = 1L << (n->level - 1);
+    extract(hl, n->nw, board, y0, x0);
+    extract(hl, n->ne, board, y0, x0 + half);
+    extract(hl, n->sw, board, y0 + half, x0);
+    extract(hl, n->se, board, y0 + half, x0 + half);
+}
+
+/* mark n and everything reachable from it, following results too if
+ * keep_results is set */
+static void mark(struct hl_node *n, int keep_results) {
+    if (n == NULL || n->level == 0 || n->mark) {
+        return;
+    }
+    n->mark = 1;
+    mark(n->nw, keep_results);
+    mark(n->ne, keep_results);
+    mark(n->sw, keep_results);
+    mark(n->se, keep_results);
+    if (keep_results) {
+        mark(n->result, keep_results);
+    }
+}
+
+/* free every node not reachable from the root (which may be NULL) */
+static void sweep(struct hashlife *hl, struct hl_node *root,
+        int keep_results)
+{
+    mark(root, keep_results);
+    for (int l = 0; l < HL_MAX_LEVEL; l++) {
+        mark(hl->empty[l], keep_results);
+    }
+
+    for (size_t c = 0; c < hl->table_size; c++) {
+        struct hl_node **link = &hl->table[c];
+        while (*link != NULL) {
+            struct hl_node *n = *link;
+            if (n->mark) {
+                n->mark = 0;
+                if (!keep_results) {
+                    n->result = NULL;
+                }
+                link = &n->next;
+            }
+            else {
+                *link = n->next;
+                n->next = hl->free_list;
+                hl->free_list = n;
+                hl->num_nodes--;
+            }
+        }
+    }
+}
+
+/* collect garbage if there are too many nodes: first keeping what the root
+ * remembers about its future, then, if that wasn't enough, forgetting it */
+static void collect(struct hashlife *hl, struct hl_node *root) {
+    if (hl->num_nodes <= hl->max_nodes) {
+        return;
+    }
+    hl->stats.collections++;
+    sweep(hl, root, 1);
+    if (hl->num_nodes > hl->max_nodes / 2) {
+        sweep(hl, root, 0);
+    }
+}
+
+/* return the log base 2 of the smallest power of two >= n */
+static int log2_ceil(long n) {
+    int k = 0;
+    while ((1L << k) < n) {
+        k++;
+    }
+    return k;
+}
+
+/* return the log base 2 of the largest power of two <= n (n >= 1) */
+static int log2_floor(long n) {
+    return 63 - __builtin_clzl(n);
+}
+
+/* advance a board with power-of-two sides: the board stays in the
+ * quadtree as one tile of a periodic plane for the whole run */
+static void run_periodic(struct hashlife *hl, struct bitgrid *board,
+        long iters)
+{
+    int k = log2_ceil(board->rows > board->cols ? board->rows : board->cols);
+    struct hl_node *tile;
+
+    if (k < 2) {
+        k = 2;
+    }
+    tile = build(hl, board, k, 0, 0);
+
+    while (iters > 0) {
+        int step = log2_floor(iters);
+        struct hl_node *plane = tile, *res;
+
+        //the jump needs a square at least 2^(step+2) on a side
+        while (plane->level < step + 1) {
+            plane = tile4(hl, plane);
+        }
+        res = result(hl, tile4(hl, plane), step);
+
+        //res is the plane shifted by half its size: shift it back
+        plane = find_node(hl, res->se, res->sw, res->ne, res->nw);
+        while (plane->level > k) {
+            plane = plane->nw;
+        }
+        tile = plane;
+        iters -= 1L << step;
+        hl->stats.steps++;
+        collect(hl, tile);
+    }
+
+    bitgrid_clear(board);
+    extract(hl, tile, board, 0, 0);
+}
+
+/* advance a board of any size: every jump copies the board into a square
+ * twice the smallest power of two that holds it, tiled with copies of the
+ * board so that the torus wrap comes out right, and copies the center of
+ * the result back (the nodes, and what they remember of their futures,
+ * carry over from jump to jump until the cache fills) */
+static void run_chunked(struct hashlife *hl, struct bitgrid *board,
+        long iters)
+{
+    int k = log2_ceil(board->rows > board->cols ? board->rows : board->cols);
+    long size, y0, x0;
+
+    if (k < 2) {
+        k = 2;
+    }
+    size = 1L << k;
+
+    //start the square half a size up and to the left of cell (0, 0), so
+    //that the result's top left corner is cell (0, 0)
+    y0 = board->rows - (size / 2) % board->rows;
+    x0 = board->cols - (size / 2) % board->cols;
+
+    while (iters > 0) {
+        int step = log2_floor(iters);
+        struct hl_node *res;
+
+        //the result of a square 2^(k+1) on a side reaches 2^(k-1) on
+        if (step > k - 1) {
+            step = k - 1;
+        }
+        res = result(hl, build(hl, board, k + 1, y0, x0), step);
+        bitgrid_clear(board);
+        extract(hl, res, board, 0, 0);
+        iters -= 1L << step;
+        hl->stats.steps++;
+        collect(hl, NULL);
+    }
+}
+
+/* free all of the engine's storage */
+static void hashlife_free(struct hashlife *hl) {
+    while (hl->blocks != NULL) {
+        struct hl_block *next = hl->blocks->next;
+        free(hl->blocks);
+        hl->blocks = next;
+    }
+    free(hl->table);
+}
+
+/* advance board by iters generations, see hashlife.h
+ * returns: the number of live cells, or -1 on allocation failure
+ */
+long hashlife_run(struct bitgrid *board, long iters, size_t max_nodes,
+        struct hashlife_stats *stats)
+{
+    struct hashlife *hl = calloc(1, sizeof(struct hashlife));
+    long live = -1;
+    int rows = board->rows, cols = board->cols;
+
+    if (hl == NULL) {
+        return -1;
+    }
+    hl->table_size = 1 << 16;
+    hl->table = calloc(hl->table_size, sizeof(struct hl_node *));
+    hl->max_nodes = max_nodes;
+    hl->leaf[1].population = 1;
+    hl->empty[0] = &hl->leaf[0];
+
+    if (hl->table != NULL && setjmp(hl->out_of_memory) == 0) {
+        if ((rows & (rows - 1)) == 0 && (cols & (cols - 1)) == 0) {
+            run_periodic(hl, board, iters);
+        }
+        else {
+            run_chunked(hl, board, iters);
+        }
+        live = bitgrid_count(board);
+    }
+
+    hl->stats.nodes = hl->num_nodes;
+    if (stats != NULL) {
+        *stats = hl->stats;
+    }
+    hashlife_free(hl);
+    free(hl);
+    return live;
+}
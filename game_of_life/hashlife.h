@@ -0,0 +1,42 @@
+#ifndef __HASHLIFE_H__
+#define __HASHLIFE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "bitgrid.h"
+
+/* HashLife engine for the Game Of Life.
+ *
+ * The board is held as a quadtree of hash-consed nodes: every distinct
+ * 2^k x 2^k square of cells is stored once, and each node remembers its
+ * future (the center half of the square, 2^j generations on), so repeated
+ * patterns in space and in time are only ever computed once.
+ *
+ * The board wraps around at its edges like the direct engine does.  When
+ * rows and cols are both powers of two, that torus is the same as an
+ * infinite plane tiled with copies of the board, which lets the board stay
+ * in the quadtree and jump ahead 2^j generations at a time for any j.
+ * Other board sizes get copied into the smallest power-of-two square that
+ * holds them, tiled with copies of the board for the wrap, and back out
+ * every jump of up to half that square's side, so they run much slower.
+ */
+
+/* counts of what a hashlife_run did */
+struct hashlife_stats {
+    size_t nodes;         // nodes alive at the end of the run
+    size_t peak_nodes;    // most nodes alive at any one time
+    long collections;     // number of garbage collections
+    long steps;           // number of jumps ahead it took
+};
+
+/* default bound on the node cache (--hashlife-nodes=) */
+#define HASHLIFE_MAX_NODES  (1 << 22)
+
+/* advance board by iters generations, collecting garbage whenever more
+ * than max_nodes nodes are alive between jumps, and fill in stats if it
+ * isn't NULL
+ * returns: the number of live cells, or -1 on allocation failure */
+long hashlife_run(struct bitgrid *board, long iters, size_t max_nodes,
+        struct hashlife_stats *stats);
+
+#endif  /* __HASHLIFE_H__ */
@@ -0,0 +1,519 @@
+/*
+ * libgol: the direct engine behind an opaque handle.
+ * See libgol.h for the calls.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "libgol.h"
+#include "bitgrid.h"
+#include "swar.h"
+#include "boardmem.h"
+#include "rule.h"
+
+#define CACHE_LINE  (64)
+
+struct gol_sim {
+    struct bitgrid board;  // the board
+    struct bitgrid next;   // next round's board
+    size_t capacity;       // words allocated for each board
+    struct swar_rule swar; // the rule's kernel
+    int num_threads;
+    int placed;            // 1 once the threads have copied their rows
+                           // onto their own NUMA nodes
+    long live;             // live cells on the board
+    long round;            // rounds played since the board was loaded
+};
+
+/* a thread's live cell count, on a cache line of its own */
+struct step_count {
+    long live;
+} __attribute__((aligned(CACHE_LINE)));
+
+/* one gol_play call, shared by the threads playing it */
+struct step_run {
+    struct gol_sim *sim;
+    const struct gol_hooks *hooks;
+    long n;                     // rounds to play
+    long k;                     // rounds played so far
+    int count;                  // 1 if round k counts its live cells
+    uint64_t *placed;           // a fresh board for the threads to copy
+                                // their rows to first, or NULL
+    int num_threads;            // threads that could be started
+    pthread_barrier_t barrier;  // threads wait here between rounds
+    struct step_count *counts;  // each thread's count for its own rows
+
+    /* threads wait at the gate until every thread that can be started has
+     * been, and their rows have been split between them */
+    int go;
+    pthread_mutex_t lock;
+    pthread_cond_t gate;
+};
+
+/* one thread of a gol_play call, with its block of rows */
+struct step_thread {
+    struct step_run *run;
+    int id;
+    int row_start;
+    int row_end;
+    pthread_t tid;
+};
+
+/* compute rows [row_start, row_end) of sim's next board
+ * returns: the number of live cells in them, or 0 if count is 0 */
+static long step_block(struct gol_sim *sim, int row_start, int row_end,
+        int count)
+{
+    return swar_rule_step(&sim->swar, &sim->board, &sim->next, row_start,
+            row_end, 0, sim->board.words, count);
+}
+
+/* compute rows [row_start, row_end) of run's next board for thread id,
+ * handing them to the rows hook, if there is one, a block at a time
+ * returns: the number of live cells in them, or 0 if the round doesn't
+ * count them */
+static long play_block(struct step_run *run, int id, int row_start,
+        int row_end)
+{
+    struct gol_sim *sim = run->sim;
+    const struct gol_hooks *hooks = run->hooks;
+    long live = 0;
+    int block;
+
+    if (hooks == NULL || hooks->rows == NULL) {
+        return step_block(sim, row_start, row_end, run->count);
+    }
+    block = (hooks->block > 0) ? hooks->block : row_end - row_start;
+    for (int i = row_start; i < row_end; i += block) {
+        int end = (i + block < row_end) ? i + block : row_end;
+
+        live += step_block(sim, i, end, run->count);
+        hooks->rows(hooks->arg, id, sim->board.bits, sim->next.bits,
+                sim->board.words, i, end);
+    }
+    return live;
+}
+
+/* swap in the next board after a round */
+static void swap_boards(struct gol_sim *sim) {
+    struct bitgrid temp = sim->board;
+
+    sim->board = sim->next;
+    sim->next = temp;
+    sim->round++;
+}
+
+/* decide whether run's next round counts its live cells: the last one
+ * always does, and the others if the hooks ask for it */
+static void next_count(struct step_run *run) {
+    const struct gol_hooks *hooks = run->hooks;
+
+    run->count = run->k == run->n - 1 || (hooks != NULL
+            && hooks->count != NULL
+            && hooks->count(hooks->arg, run->sim->round + 1));
+}
+
+/* finish one of run's rounds, with every thread done with it: swap in the
+ * next board, add up its live cells if it counted them, and call the
+ * hooks */
+static void end_round(struct step_run *run) {
+    struct gol_sim *sim = run->sim;
+    const struct gol_hooks *hooks = run->hooks;
+
+    swap_boards(sim);
+    run->k++;
+    if (run->count) {
+        sim->live = 0;
+        for (int t = 0; t < run->num_threads; t++) {
+            sim->live += run->counts[t].live;
+        }
+    }
+    if (hooks != NULL && hooks->after != NULL) {
+        long left = hooks->after(hooks->arg, sim, run->n - run->k);
+
+        if (left < 0) {
+            left = 0;
+        }
+        if (left < run->n - run->k) {
+            run->n = run->k + left;
+        }
+    }
+    next_count(run);
+}
+
+/* the main loop of each thread of a gol_play call: plays every round on
+ * the thread's own block of rows, with thread 0 finishing each round while
+ * the others wait */
+static void *step_main(void *arg) {
+    struct step_thread *thread = arg;
+    struct step_run *run = thread->run;
+    struct gol_sim *sim = run->sim;
+
+    pthread_mutex_lock(&run->lock);
+    while (!run->go) {
+        pthread_cond_wait(&run->gate, &run->lock);
+    }
+    pthread_mutex_unlock(&run->lock);
+
+    //the board was filled in by the caller, so its pages are all on the
+    //caller's NUMA node: each thread copies its own rows to a fresh board
+    //first (next's pages are placed the same way, by each thread's first
+    //round)
+    if (run->placed != NULL) {
+        long words = sim->board.words;
+
+        memcpy(run->placed + thread->row_start * words,
+                bitgrid_row(&sim->board, thread->row_start),
+                (thread->row_end - thread->row_start) * words
+                * sizeof(uint64_t));
+        pthread_barrier_wait(&run->barrier);
+        if (thread->id == 0) {
+            boardmem_free(sim->board.bits, sim->capacity * sizeof(uint64_t));
+            sim->board.bits = run->placed;
+            sim->placed = 1;
+        }
+        pthread_barrier_wait(&run->barrier);
+    }
+
+    while (run->k < run->n) {
+        run->counts[thread->id].live = play_block(run, thread->id,
+                thread->row_start, thread->row_end);
+        pthread_barrier_wait(&run->barrier);
+        if (thread->id == 0) {
+            end_round(run);
+        }
+        pthread_barrier_wait(&run->barrier);
+    }
+    return NULL;
+}
+
+/* set sim's boards to rows x cols cells, growing their storage only if it
+ * is too small
+ * returns: GOL_OK or GOL_ERR_MEMORY */
+static int reserve_boards(struct gol_sim *sim, int rows, int cols) {
+    int words = (cols + 63) / 64;
+    size_t needed = (size_t)rows * words;
+    struct bitgrid *boards[2] = {&sim->board, &sim->next};
+
+    if (needed > sim->capacity) {
+        uint64_t *bits[2];
+
+        bits[0] = boardmem_alloc(needed * sizeof(uint64_t));
+        bits[1] = boardmem_alloc(needed * sizeof(uint64_t));
+        if (bits[0] == NULL || bits[1] == NULL) {
+            boardmem_free(bits[0], needed * sizeof(uint64_t));
+            boardmem_free(bits[1], needed * sizeof(uint64_t));
+            return GOL_ERR_MEMORY;
+        }
+        for (int b = 0; b < 2; b++) {
+            boardmem_free(boards[b]->bits, sim->capacity * sizeof(uint64_t));
+            boards[b]->bits = bits[b];
+        }
+        sim->capacity = needed;
+        sim->placed = 0;
+    }
+    for (int b = 0; b < 2; b++) {
+        boards[b]->rows = rows;
+        boards[b]->cols = cols;
+        boards[b]->words = words;
+    }
+    sim->round = 0;
+    return GOL_OK;
+}
+
+/* make a handle with no board yet, playing as config says
+ * returns: GOL_OK, or one of the GOL_ERR_ values with *out set to NULL */
+static int new_sim(struct gol_sim **out, const struct gol_config *config) {
+    struct gol_config defaults = {1, NULL, NULL};
+    struct life_rule rule;
+    struct gol_sim *sim;
+    const char *kernel;
+
+    *out = NULL;
+    if (config == NULL) {
+        config = &defaults;
+    }
+    if (config->num_threads < 0) {
+        return GOL_ERR_ARGS;
+    }
+    if (config->rule == NULL) {
+        rule_init_life(&rule);
+    }
+    else if (rule_parse(config->rule, &rule) != 0 || rule.states > 2) {
+        return GOL_ERR_RULE;
+    }
+
+    sim = calloc(1, sizeof(*sim));
+    if (sim == NULL) {
+        return GOL_ERR_MEMORY;
+    }
+    sim->num_threads = config->num_threads ? config->num_threads : 1;
+    swar_rule_init(&sim->swar, rule.birth, rule.survive);
+    kernel = config->kernel ? config->kernel : "swar";
+    if (strcmp(kernel, "avx2") == 0 && rule_is_life(&rule)
+            && swar_have_avx2()) {
+        sim->swar.step = avx2_step_block;
+    }
+    else if (strcmp(kernel, "avx512") == 0 && rule_is_life(&rule)
+            && swar_have_avx512()) {
+        sim->swar.step = avx512_step_block;
+    }
+    else if (strcmp(kernel, "swar") != 0) {
+        free(sim);
+        return GOL_ERR_KERNEL;
+    }
+    *out = sim;
+    return GOL_OK;
+}
+
+/* make a handle for a board of a byte per cell, see libgol.h
+ * returns: GOL_OK, or one of the GOL_ERR_ values with *sim set to NULL
+ */
+int gol_create(struct gol_sim **sim, int rows, int cols, const uint8_t *cells,
+        long stride, const struct gol_config *config)
+{
+    int ret;
+
+    *sim = NULL;
+    if (rows < 1 || cols < 1 || (cells != NULL && stride < cols)) {
+        return GOL_ERR_ARGS;
+    }
+    ret = new_sim(sim, config);
+    if (ret == GOL_OK) {
+        ret = reserve_boards(*sim, rows, cols);
+    }
+    if (ret != GOL_OK) {
+        gol_destroy(*sim);
+        *sim = NULL;
+        return ret;
+    }
+
+    bitgrid_clear(&(*sim)->board);
+    for (int i = 0; cells != NULL && i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            if (cells[(long)i * stride + j] != 0) {
+                bitgrid_set(&(*sim)->board, i, j, 1);
+            }
+        }
+    }
+    (*sim)->live = bitgrid_count(&(*sim)->board);
+    return GOL_OK;
+}
+
+/* make a handle for a packed board, see libgol.h
+ * returns: GOL_OK, or one of the GOL_ERR_ values with *sim set to NULL
+ */
+int gol_create_bits(struct gol_sim **sim, int rows, int cols,
+        const uint64_t *bits, long stride, const struct gol_config *config)
+{
+    int ret = new_sim(sim, config);
+
+    if (ret == GOL_OK) {
+        ret = gol_load_bits(*sim, rows, cols, bits, stride);
+    }
+    if (ret != GOL_OK) {
+        gol_destroy(*sim);
+        *sim = NULL;
+    }
+    return ret;
+}
+
+/* start sim over on a new packed board, see libgol.h
+ * returns: GOL_OK, or one of the GOL_ERR_ values with sim unchanged
+ */
+int gol_load_bits(struct gol_sim *sim, int rows, int cols,
+        const uint64_t *bits, long stride)
+{
+    int words = (cols + 63) / 64;
+    uint64_t tail = (cols & 63) ? ((uint64_t)1 << (cols & 63)) - 1
+        : ~(uint64_t)0;
+    int ret;
+
+    if (rows < 1 || cols < 1 || bits == NULL || stride < words) {
+        return GOL_ERR_ARGS;
+    }
+    ret = reserve_boards(sim, rows, cols);
+    if (ret != GOL_OK) {
+        return ret;
+    }
+    for (int i = 0; i < rows; i++) {
+        uint64_t *row = bitgrid_row(&sim->board, i);
+
+        memcpy(row, bits + (long)i * stride, words * sizeof(uint64_t));
+        //the kernels count on the bits past the last column being 0
+        row[words - 1] &= tail;
+    }
+    sim->live = bitgrid_count(&sim->board);
+    return GOL_OK;
+}
+
+/* play n rounds of sim's board, see libgol.h
+ * returns: GOL_OK, or GOL_ERR_ARGS or GOL_ERR_THREADS with no rounds played
+ */
+int gol_step(struct gol_sim *sim, long n) {
+    return gol_play(sim, n, NULL);
+}
+
+/* play n rounds of sim's board, calling hooks between them, see libgol.h
+ * returns: GOL_OK, or GOL_ERR_ARGS or GOL_ERR_THREADS with no rounds played
+ */
+int gol_play(struct gol_sim *sim, long n, const struct gol_hooks *hooks) {
+    struct step_run run;
+    struct step_thread *threads;
+    int nthreads = sim->num_threads;
+
+    if (n < 0) {
+        return GOL_ERR_ARGS;
+    }
+    if (n == 0) {
+        return GOL_OK;
+    }
+    if (nthreads > sim->board.rows) {
+        nthreads = sim->board.rows;
+    }
+    run.sim = sim;
+    run.hooks = hooks;
+    run.n = n;
+    run.k = 0;
+    run.placed = NULL;
+    next_count(&run);
+    if (nthreads == 1) {
+        struct step_count count;
+
+        run.counts = &count;
+        run.num_threads = 1;
+        while (run.k < run.n) {
+            count.live = play_block(&run, 0, 0, sim->board.rows);
+            end_round(&run);
+        }
+        return GOL_OK;
+    }
+
+    run.go = 0;
+    threads = malloc(nthreads * sizeof(*threads));
+    run.counts = aligned_alloc(CACHE_LINE, nthreads * sizeof(*run.counts));
+    if (threads == NULL || run.counts == NULL) {
+        free(threads);
+        free(run.counts);
+        return GOL_ERR_THREADS;
+    }
+    pthread_mutex_init(&run.lock, NULL);
+    pthread_cond_init(&run.gate, NULL);
+    run.num_threads = 1;
+    threads[0].run = &run;
+    threads[0].id = 0;
+    for (int t = 1; t < nthreads; t++) {
+        threads[t].run = &run;
+        threads[t].id = t;
+        if (pthread_create(&threads[t].tid, NULL, step_main, &threads[t])) {
+            break;  // play with the threads started so far
+        }
+        run.num_threads++;
+    }
+    nthreads = run.num_threads;
+
+    //split the rows as evenly as possible between the threads, then open
+    //the gate
+    for (int t = 0; t < nthreads; t++) {
+        threads[t].row_start = (long)t * sim->board.rows / nthreads;
+        threads[t].row_end = (long)(t + 1) * sim->board.rows / nthreads;
+    }
+    if (nthreads > 1 && !sim->placed
+            && sim->capacity * sizeof(uint64_t) >= BOARDMEM_MMAP_BYTES) {
+        //with no room for a fresh board, play on the one there is
+        run.placed = boardmem_alloc(sim->capacity * sizeof(uint64_t));
+    }
+    pthread_barrier_init(&run.barrier, NULL, nthreads);
+    pthread_mutex_lock(&run.lock);
+    run.go = 1;
+    pthread_cond_broadcast(&run.gate);
+    pthread_mutex_unlock(&run.lock);
+
+    step_main(&threads[0]);
+    for (int t = 1; t < nthreads; t++) {
+        pthread_join(threads[t].tid, NULL);
+    }
+    pthread_barrier_destroy(&run.barrier);
+    pthread_mutex_destroy(&run.lock);
+    pthread_cond_destroy(&run.gate);
+    free(threads);
+    free(run.counts);
+    return GOL_OK;
+}
+
+/* return the number of live cells on sim's board */
+long gol_live(const struct gol_sim *sim) {
+    return sim->live;
+}
+
+/* return the number of rounds sim has played since it was last loaded */
+long gol_round(const struct gol_sim *sim) {
+    return sim->round;
+}
+
+/* return the number of rows of sim's board */
+int gol_rows(const struct gol_sim *sim) {
+    return sim->board.rows;
+}
+
+/* return the number of columns of sim's board */
+int gol_cols(const struct gol_sim *sim) {
+    return sim->board.cols;
+}
+
+/* return row i of sim's packed board, without copying it, see libgol.h
+ * returns: the row, or NULL if there's no row i */
+const uint64_t *gol_region(const struct gol_sim *sim, int i, long *stride) {
+    if (i < 0 || i >= sim->board.rows) {
+        return NULL;
+    }
+    *stride = sim->board.words;
+    return bitgrid_row(&sim->board, i);
+}
+
+/* copy a region of sim's board out a byte per cell, see libgol.h
+ * returns: GOL_OK, or GOL_ERR_ARGS if the region isn't on the board
+ */
+int gol_copy_region(const struct gol_sim *sim, int row, int col, int rows,
+        int cols, uint8_t *out, long stride)
+{
+    if (row < 0 || col < 0 || rows < 0 || cols < 0 || stride < cols
+            || row + (long)rows > sim->board.rows
+            || col + (long)cols > sim->board.cols) {
+        return GOL_ERR_ARGS;
+    }
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            out[(long)i * stride + j] = bitgrid_get(&sim->board, row + i,
+                    col + j);
+        }
+    }
+    return GOL_OK;
+}
+
+/* free a handle (or NULL) */
+void gol_destroy(struct gol_sim *sim) {
+    if (sim == NULL) {
+        return;
+    }
+    boardmem_free(sim->board.bits, sim->capacity * sizeof(uint64_t));
+    boardmem_free(sim->next.bits, sim->capacity * sizeof(uint64_t));
+    free(sim);
+}
+
+/* return a message for one of the return values of libgol.h */
+const char *gol_strerror(int error) {
+    static const char *messages[] = {
+        "success",
+        "bad size, region or buffer",
+        "not a two-state rule in B/S notation",
+        "no such kernel, or one this CPU or rule can't run",
+        "out of memory for the boards",
+        "out of memory for the threads",
+    };
+
+    if (error < 0 || error >= (int)(sizeof(messages) / sizeof(messages[0]))) {
+        return "unknown error";
+    }
+    return messages[error];
+}
@@ -0,0 +1,138 @@
+#ifndef __LIBGOL_H__
+#define __LIBGOL_H__
+
+#include <stdint.h>
+
+/* libgol: the direct engine as a library, for programs that want to play
+ * boards themselves instead of running gol on them (make lib builds
+ * libgol.a, which needs no Qt5 or ParaVis: link it with -lpthread).
+ *
+ * Each board is played through a handle of its own, made by gol_create and
+ * freed by gol_destroy.  A handle keeps all of its state (its two packed
+ * boards, its rule, its kernel and its counts), and the library keeps none
+ * outside the handles, so any number of them can be played at once from
+ * different threads.  A handle itself is for one thread at a time.
+ *
+ *     struct gol_sim *sim;
+ *     struct gol_config config = {4, "B36/S23", NULL};
+ *
+ *     if (gol_create(&sim, rows, cols, cells, cols, &config) == GOL_OK) {
+ *         gol_step(sim, 1000);
+ *         printf("%ld live\n", gol_live(sim));
+ *         gol_destroy(sim);
+ *     }
+ *
+ * Boards wrap around at their edges (a torus), as in gol, and play
+ * two-state rules only (Generations rules need gol's int grid).  Boards go
+ * in and come out either a byte per cell or packed like a bitgrid: cell
+ * (i, j) in bit (j % 64) of word (j / 64) of row i.
+ */
+
+/* Return values of the calls below */
+#define GOL_OK           (0)
+#define GOL_ERR_ARGS     (1)   // a bad size, region or buffer
+#define GOL_ERR_RULE     (2)   // not a two-state rule in B/S notation
+#define GOL_ERR_KERNEL   (3)   // no such kernel, or it can't run this rule here
+#define GOL_ERR_MEMORY   (4)   // out of memory for the boards
+#define GOL_ERR_THREADS  (5)   // out of memory for the threads
+
+/* a handle: one board being played */
+struct gol_sim;
+
+/* how a handle plays its board; a NULL config gets all the defaults */
+struct gol_config {
+    int num_threads;     // threads splitting up the rows each step (1 if 0)
+    const char *rule;    // the rule (see rule.h), or NULL for B3/S23
+    const char *kernel;  // "swar", "avx2" or "avx512" (B3/S23 only), or
+                         // NULL for swar
+};
+
+/* make a handle for a rows x cols board, with cell (i, j) alive if
+ * cells[i * stride + j] isn't 0 (or all cells dead if cells is NULL), and
+ * store it in *sim
+ * returns GOL_OK, or one of the GOL_ERR_ values with *sim set to NULL */
+int gol_create(struct gol_sim **sim, int rows, int cols, const uint8_t *cells,
+        long stride, const struct gol_config *config);
+
+/* the same, from a packed board whose row i starts at bits + i * stride
+ * (stride at least (cols + 63) / 64 words) */
+int gol_create_bits(struct gol_sim **sim, int rows, int cols,
+        const uint64_t *bits, long stride, const struct gol_config *config);
+
+/* start sim over on a new packed board, laid out as for gol_create_bits,
+ * reusing the handle's memory if the board fits in it
+ * returns GOL_OK, or one of the GOL_ERR_ values with sim unchanged */
+int gol_load_bits(struct gol_sim *sim, int rows, int cols,
+        const uint64_t *bits, long stride);
+
+/* play n rounds of sim's board, on its num_threads threads (started for
+ * the call and joined before it returns: if some can't be started, the
+ * others share out the rows)
+ * returns GOL_OK, or GOL_ERR_ARGS (n < 0) or GOL_ERR_THREADS with no
+ * rounds played */
+int gol_step(struct gol_sim *sim, long n);
+
+/* what gol_play does between rounds, for a program that wants to look at
+ * every round (any of the functions may be NULL) */
+struct gol_hooks {
+    /* return 1 if sim's round round (its gol_round once played) must
+     * count its live cells, 0 if not: the last round always does */
+    int (*count)(void *arg, long round);
+
+    /* called after every round, once its board is in place, with left
+     * rounds still to play: it may read the board (gol_region,
+     * gol_copy_region, and gol_live if the round counted), and returns
+     * the rounds still to play, left or fewer to cut the run short */
+    long (*after)(void *arg, struct gol_sim *sim, long left);
+
+    void *arg;  // passed to all three
+
+    /* called by each playing thread (id 0 up to num_threads - 1, all at
+     * once) as soon as it has computed rows [row_start, row_end) of the
+     * round's board, block rows at a time (all of its rows at once if
+     * block is 0): before and after point at row 0 of the boards the round
+     * came from and went to, packed as for gol_create_bits with stride
+     * words a row, and it may read all of before but only those rows of
+     * after, and only until it returns */
+    void (*rows)(void *arg, int id, const uint64_t *before,
+            const uint64_t *after, long stride, int row_start, int row_end);
+    int block;
+};
+
+/* play n rounds of sim's board like gol_step, calling hooks (or nothing,
+ * if it's NULL) between rounds: count and after run on one of the playing
+ * threads, while the others wait for them
+ * returns GOL_OK, or GOL_ERR_ARGS (n < 0) or GOL_ERR_THREADS with no
+ * rounds played */
+int gol_play(struct gol_sim *sim, long n, const struct gol_hooks *hooks);
+
+/* return the number of live cells on sim's board */
+long gol_live(const struct gol_sim *sim);
+
+/* return the number of rounds sim has played since it was last loaded */
+long gol_round(const struct gol_sim *sim);
+
+/* return the size of sim's board */
+int gol_rows(const struct gol_sim *sim);
+int gol_cols(const struct gol_sim *sim);
+
+/* return row i of sim's packed board, with row i + 1 starting *stride
+ * words on, without copying it: the board's rows from i down to the last
+ * one can be read from it until the next call to gol_step, gol_load_bits
+ * or gol_destroy */
+const uint64_t *gol_region(const struct gol_sim *sim, int i, long *stride);
+
+/* copy the rows x cols region of sim's board whose top left cell is
+ * (row, col) to out, a byte per cell (1 alive, 0 dead), with cell (i, j)
+ * of the region at out[i * stride + j]
+ * returns GOL_OK, or GOL_ERR_ARGS if the region isn't on the board */
+int gol_copy_region(const struct gol_sim *sim, int row, int col, int rows,
+        int cols, uint8_t *out, long stride);
+
+/* free a handle (or NULL) */
+void gol_destroy(struct gol_sim *sim);
+
+/* return a message for one of the return values above */
+const char *gol_strerror(int error);
+
+#endif  /* __LIBGOL_H__ */
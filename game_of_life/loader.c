@@ -0,0 +1,331 @@
+/*
+ * Bulk loader for board input files.
+ * See loader.h for the file format and how it gets parsed.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "loader.h"
+
+/* One byte range of the file, and the integers parsed out of it.  A range
+ * never starts or ends in the middle of a number.
+ */
+struct scan_range {
+    const char *start;  // first byte of the range
+    const char *end;    // one past the last byte of the range
+    long limit;         // stop after this many integers (-1 for no limit)
+    const char *stop;   // where the scan stopped
+    int *values;        // the integers, in file order
+    long count;         // number of integers in values
+    long capacity;      // number of integers values has room for
+    const char *error;  // start of the first bad number, or NULL
+    int no_memory;      // 1 if values couldn't grow
+    int threaded;       // 1 if a thread of its own is parsing it
+    pthread_t tid;
+};
+
+/* return 1 if c separates numbers, 0 if not */
+static inline int is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t'
+        || c == '\v' || c == '\f';
+}
+
+/* parse the integers in range->start .. range->end into range->values,
+ * stopping at the first bad one (run by each loader thread) */
+static void *scan_range(void *arg) {
+    struct scan_range *range = arg;
+    const char *p = range->start;
+    const char *end = range->end;
+
+    while (p < end && range->count != range->limit) {
+        const char *number = p;
+        long value = 0;
+        int negative = 0;
+
+        if (is_space(*p)) {
+            p++;
+            continue;
+        }
+        if (*p == '-') {
+            negative = 1;
+            p++;
+        }
+        //every digit is checked against INT_MAX, so value can't overflow
+        while (p < end && (unsigned)(*p - '0') < 10 && value <= INT_MAX) {
+            value = value * 10 + (*p - '0');
+            p++;
+        }
+        if (p == number + negative || value > INT_MAX
+                || (p < end && !is_space(*p))) {
+            range->error = number;
+            break;
+        }
+
+        if (range->count == range->capacity) {
+            long capacity = range->capacity ? 2 * range->capacity : 1024;
+            int *values = realloc(range->values, capacity * sizeof(int));
+
+            if (values == NULL) {
+                range->no_memory = 1;
+                break;
+            }
+            range->values = values;
+            range->capacity = capacity;
+        }
+        range->values[range->count++] = negative ? -value : value;
+    }
+    range->stop = p;
+    return NULL;
+}
+
+/* print what is wrong with range, if anything, giving its line in text
+ * returns: 0 if nothing is wrong, 1 if something is */
+static int range_failed(const struct scan_range *range, const char *path,
+        const char *text)
+{
+    long line = 1;
+
+    if (range->no_memory) {
+        printf("Error: Failure to allocate cells for %s.\n", path);
+        return 1;
+    }
+    if (range->error == NULL) {
+        return 0;
+    }
+    for (const char *p = text; p < range->error; p++) {
+        line += (*p == '\n');
+    }
+    printf("Error: %s line %ld: expected a number that fits in an int\n",
+            path, line);
+    return 1;
+}
+
+/* read all of fd into a malloc'ed buffer (for files that can't be mapped)
+ * returns: the buffer, or NULL on error */
+static char *read_whole(int fd, size_t *size) {
+    size_t capacity = 1 << 16;
+    char *text = malloc(capacity);
+    ssize_t n;
+
+    *size = 0;
+    if (text == NULL) {
+        return NULL;
+    }
+    while ((n = read(fd, text + *size, capacity - *size)) > 0) {
+        *size += n;
+        if (*size == capacity) {
+            char *bigger = realloc(text, 2 * capacity);
+
+            if (bigger == NULL) {
+                free(text);
+                return NULL;
+            }
+            text = bigger;
+            capacity *= 2;
+        }
+    }
+    if (n < 0) {
+        free(text);
+        return NULL;
+    }
+    return text;
+}
+
+/* parse the cell list that starts at body into file->cells, splitting it
+ * into num_threads byte ranges
+ * returns: 0 on success, 1 on error */
+static int load_cells(struct board_file *file, const char *path,
+        const char *text, const char *body, const char *end, int num_threads)
+{
+    struct scan_range *ranges;
+    long total = 0, wanted = 2 * file->num_alive;
+    int ret = 0;
+
+    if (end - body < LOADER_THREAD_BYTES) {
+        num_threads = 1;
+    }
+    ranges = calloc(num_threads, sizeof(struct scan_range));
+    if (ranges == NULL) {
+        printf("Error: Failure to allocate cells for %s.\n", path);
+        return 1;
+    }
+
+    //Cut the body into even byte ranges, moving each cut forward to the
+    //start of a number.
+    for (int t = 0; t < num_threads; t++) {
+        const char *cut = body + (end - body) * t / num_threads;
+
+        while (t > 0 && cut < end && !is_space(cut[-1])) {
+            cut++;
+        }
+        ranges[t].start = cut;
+        ranges[t].limit = -1;
+        if (t > 0) {
+            ranges[t-1].end = cut;
+        }
+    }
+    ranges[num_threads-1].end = end;
+
+    for (int t = 1; t < num_threads; t++) {
+        ranges[t].threaded = (pthread_create(&ranges[t].tid, NULL,
+                    scan_range, &ranges[t]) == 0);
+        if (!ranges[t].threaded) {
+            //parse this range on the calling thread instead
+            scan_range(&ranges[t]);
+        }
+    }
+    scan_range(&ranges[0]);
+    for (int t = 1; t < num_threads; t++) {
+        if (ranges[t].threaded) {
+            pthread_join(ranges[t].tid, NULL);
+        }
+    }
+
+    //The cells are the first num_alive pairs, in file order: anything
+    //after them is ignored, as it always has been.
+    for (int t = 0; t < num_threads && total < wanted && ret == 0; t++) {
+        total += ranges[t].count;
+        if (total < wanted) {
+            ret = range_failed(&ranges[t], path, text);
+        }
+    }
+    if (ret == 0 && total < wanted) {
+        printf("Error: %s lists %ld of its %ld live cells\n", path,
+                total / 2, file->num_alive);
+        ret = 1;
+    }
+    if (ret == 0 && num_threads == 1) {
+        file->cells = ranges[0].values;
+        ranges[0].values = NULL;
+    }
+    else if (ret == 0 && wanted > 0) {
+        file->cells = malloc(wanted * sizeof(int));
+        if (file->cells == NULL) {
+            printf("Error: Failure to allocate cells for %s.\n", path);
+            ret = 1;
+        }
+        total = 0;
+        for (int t = 0; t < num_threads && total < wanted && ret == 0; t++) {
+            long n = ranges[t].count;
+
+            if (n > wanted - total) {
+                n = wanted - total;
+            }
+            memcpy(file->cells + total, ranges[t].values, n * sizeof(int));
+            total += n;
+        }
+    }
+
+    for (int t = 0; t < num_threads; t++) {
+        free(ranges[t].values);
+    }
+    free(ranges);
+    return ret;
+}
+
+/* read the board file at path into file, see loader.h
+ * returns: 0 on success, 1 on error
+ */
+int board_load(const char *path, struct board_file *file, int num_threads) {
+    struct scan_range header;
+    struct stat st;
+    size_t size = 0;
+    char *text = MAP_FAILED;
+    int mapped = 0, ret = 0;
+    int fd;
+
+    memset(file, 0, sizeof(*file));
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("Error: Failure to open file.\n");
+        return 1;
+    }
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        size = st.st_size;
+        text = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        mapped = (text != MAP_FAILED);
+    }
+    if (mapped) {
+        madvise(text, size, MADV_SEQUENTIAL);
+    }
+    else {
+        text = read_whole(fd, &size);
+        if (text == NULL) {
+            printf("Error: Failure to read file.\n");
+            close(fd);
+            return 1;
+        }
+    }
+
+    //rows, cols, rounds, and live cells
+    memset(&header, 0, sizeof(header));
+    header.start = text;
+    header.end = text + size;
+    header.limit = 4;
+    scan_range(&header);
+    if (range_failed(&header, path, text)) {
+        ret = 1;
+    }
+    else if (header.count < 4) {
+        printf("Error: %s is missing its board size, rounds, or number "
+                "of live cells\n", path);
+        ret = 1;
+    }
+    else {
+        file->rows = header.values[0];
+        file->cols = header.values[1];
+        file->iters = header.values[2];
+        file->num_alive = header.values[3];
+        if (file->rows < 1 || file->cols < 1 || file->iters < 0
+                || file->num_alive < 0) {
+            printf("Error: %s has a %d x %d board, %d rounds, and %ld live "
+                    "cells\n", path, file->rows, file->cols, file->iters,
+                    file->num_alive);
+            ret = 1;
+        }
+    }
+    free(header.values);
+
+    if (ret == 0) {
+        ret = load_cells(file, path, text, header.stop, text + size,
+                num_threads);
+    }
+
+    //Check every cell against the board, as setting an off-board cell
+    //would write outside of it.
+    for (long n = 0; ret == 0 && n < file->num_alive; n++) {
+        int x = file->cells[2*n];
+        int y = file->cells[2*n + 1];
+
+        if (x < 0 || x >= file->rows || y < 0 || y >= file->cols) {
+            printf("Error: %s: live cell %ld at (%d, %d) is off the "
+                    "%d x %d board\n", path, n + 1, x, y, file->rows,
+                    file->cols);
+            ret = 1;
+        }
+    }
+
+    if (mapped) {
+        munmap(text, size);
+    }
+    else {
+        free(text);
+    }
+    close(fd);
+    if (ret != 0) {
+        board_file_free(file);
+    }
+    return ret;
+}
+
+/* free the cell list of a loaded file */
+void board_file_free(struct board_file *file) {
+    free(file->cells);
+    file->cells = NULL;
+}
@@ -0,0 +1,34 @@
+#ifndef __LOADER_H__
+#define __LOADER_H__
+
+/* Bulk loader for board input files.
+ *
+ * A board file holds whitespace-separated decimal integers: the number of
+ * rows, columns, rounds, and live cells, followed by the row and column of
+ * each live cell.  The file is mapped into memory and scanned with a
+ * hand-rolled integer parser instead of one fscanf call per number, and the
+ * cell list of a big file is cut into byte ranges that are parsed by
+ * separate threads.  Every cell is checked against the board's size, so a
+ * bad coordinate is reported instead of being written out of bounds.
+ */
+
+/* files smaller than this are parsed by one thread, whatever was asked */
+#define LOADER_THREAD_BYTES  (1 << 20)
+
+struct board_file {
+    int rows;        // the row dimension
+    int cols;        // the column dimension
+    int iters;       // number of rounds to run
+    long num_alive;  // number of live cells listed
+    int *cells;      // row and column of each live cell, in pairs
+};
+
+/* read the board file at path into file, parsing with up to num_threads
+ * threads, and print what is wrong with it if anything is
+ * returns: 0 on success, 1 on error */
+int board_load(const char *path, struct board_file *file, int num_threads);
+
+/* free the cell list of a loaded file */
+void board_file_free(struct board_file *file);
+
+#endif  /* __LOADER_H__ */
@@ -0,0 +1,33 @@
+#ifndef __NOVISI_H__
+#define __NOVISI_H__
+
+#include <stddef.h>
+#include "paint.h"
+
+/* Stand-ins for the parts of the ParaVis library (pthreadGridVisi.h) that
+ * gol.c uses, for the headless build (make headless), which links no Qt5,
+ * OpenGL or ParaVis and so starts faster.  gol turns down mode 2 there
+ * before anything here is called: the stand-ins make no window, and
+ * init_pthread_animation fails if it is ever reached.
+ */
+
+typedef struct rgb color3;
+typedef struct novisi *visi_handle;
+
+static inline visi_handle init_pthread_animation(int num_tids, int rows,
+        int cols, char *name)
+{
+    return NULL;
+}
+
+static inline color3 *get_animation_buffer(visi_handle handle) {
+    return NULL;
+}
+
+static inline void draw_ready(visi_handle handle) {
+}
+
+static inline void run_animation(visi_handle handle, int iters) {
+}
+
+#endif  /* __NOVISI_H__ */
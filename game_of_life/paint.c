@@ -0,0 +1,121 @@
+/*
+ * Coloring a packed board into an RGB image.
+ * See paint.h for the table-driven and shaded ways of painting.
+ */
+#include <string.h>
+#include "paint.h"
+
+/* fill in the tables for cells that are dead or alive */
+void paint_lut_init(struct paint_lut *lut, struct rgb dead, struct rgb alive)
+{
+    for (int byte = 0; byte < 256; byte++) {
+        for (int bit = 0; bit < 8; bit++) {
+            lut->pixels[byte][bit] = ((byte >> bit) & 1) ? alive : dead;
+        }
+    }
+    for (int s = 0; s < 256; s++) {
+        lut->shades[s].r = dead.r + (alive.r - dead.r) * s / 255;
+        lut->shades[s].g = dead.g + (alive.g - dead.g) * s / 255;
+        lut->shades[s].b = dead.b + (alive.b - dead.b) * s / 255;
+    }
+}
+
+/* return the 8 cells of row starting at column col, one per bit */
+static inline unsigned cells_at(const uint64_t *row, int words, int col) {
+    int k = col >> 6;
+    int shift = col & 63;
+    uint64_t cells = row[k] >> shift;
+
+    if (shift > 56 && k + 1 < words) {
+        cells |= row[k+1] << (64 - shift);
+    }
+    return cells & 0xff;
+}
+
+/* paint n cells of row, from column col on, into out */
+static void paint_row(const struct paint_lut *lut, const uint64_t *row,
+        int words, int col, int n, struct rgb *out)
+{
+    int j;
+
+    for (j = 0; j + 8 <= n; j += 8) {
+        memcpy(out + j, lut->pixels[cells_at(row, words, col + j)],
+                sizeof(lut->pixels[0]));
+    }
+    if (j < n) {
+        memcpy(out + j, lut->pixels[cells_at(row, words, col + j)],
+                (n - j) * sizeof(struct rgb));
+    }
+}
+
+/* return the number of live cells in columns [col_start, col_end) of row */
+static inline int count_cells(const uint64_t *row, int col_start,
+        int col_end)
+{
+    int first = col_start >> 6;
+    int last = (col_end - 1) >> 6;
+    uint64_t first_mask = ~(uint64_t)0 << (col_start & 63);
+    uint64_t last_mask = ~(uint64_t)0 >> (63 - ((col_end - 1) & 63));
+    int count;
+
+    if (first == last) {
+        return __builtin_popcountll(row[first] & first_mask & last_mask);
+    }
+    count = __builtin_popcountll(row[first] & first_mask);
+    for (int k = first + 1; k < last; k++) {
+        count += __builtin_popcountll(row[k]);
+    }
+    return count + __builtin_popcountll(row[last] & last_mask);
+}
+
+/* return the first board row or column of pixel p of n across a region of
+ * size cells starting at start */
+static inline int block_start(int start, int size, int p, int n) {
+    return start + (int)((long)p * size / n);
+}
+
+/* paint the view's region of board into image, see paint.h */
+void paint_view(const struct paint_lut *lut, const struct paint_view *view,
+        const struct bitgrid *board, struct rgb *image)
+{
+    //one pixel per cell: straight from the table
+    if (view->image_rows == view->rows && view->image_cols == view->cols) {
+        for (int i = 0; i < view->rows; i++) {
+            paint_row(lut, bitgrid_row(board, view->row + i), board->words,
+                    view->col, view->cols,
+                    image + (long)(view->image_rows - 1 - i) * view->cols);
+        }
+        return;
+    }
+
+    //a block of cells per pixel (at least one cell, when zoomed in)
+    for (int y = 0; y < view->image_rows; y++) {
+        struct rgb *out = image + (long)(view->image_rows - 1 - y)
+            * view->image_cols;
+        int row_start = block_start(view->row, view->rows, y,
+                view->image_rows);
+        int row_end = block_start(view->row, view->rows, y + 1,
+                view->image_rows);
+
+        if (row_end == row_start) {
+            row_end++;
+        }
+        for (int x = 0; x < view->image_cols; x++) {
+            int col_start = block_start(view->col, view->cols, x,
+                    view->image_cols);
+            int col_end = block_start(view->col, view->cols, x + 1,
+                    view->image_cols);
+            long live = 0;
+
+            if (col_end == col_start) {
+                col_end++;
+            }
+            for (int i = row_start; i < row_end; i++) {
+                live += count_cells(bitgrid_row(board, i), col_start,
+                        col_end);
+            }
+            out[x] = lut->shades[live * 255 / ((long)(row_end - row_start)
+                    * (col_end - col_start))];
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef __PAINT_H__
+#define __PAINT_H__
+
+#include <stdint.h>
+#include "bitgrid.h"
+
+/* Coloring a packed board into an RGB image (VISI mode's image_buff).
+ *
+ * At one pixel per cell, each byte of a row (8 cells) is looked up in a
+ * 256-entry table holding its 8 pixels ready-made, so a row is painted by
+ * copying 24 bytes at a time, with no branch per cell.
+ *
+ * For boards bigger than the window, a view paints just a region of the
+ * board into a fixed-size image: each pixel covers a block of cells, and is
+ * shaded from the dead color to the live color by the fraction of the block
+ * that is alive.  Blocks are counted with popcount, a word at a time.
+ *
+ * Row 0 of the board is at the top of the image, which the VISI image
+ * buffer stores last.
+ */
+
+/* one pixel, laid out like the ParaVis color3 */
+struct rgb {
+    unsigned char r, g, b;
+};
+
+struct paint_lut {
+    struct rgb pixels[256][8];  // the 8 pixels of each byte of cells
+    struct rgb shades[256];     // dead (0) to alive (255) for the views
+};
+
+/* a region of the board, and the image it is painted into */
+struct paint_view {
+    int row;         // top row of the region
+    int col;         // left column of the region
+    int rows;        // rows in the region
+    int cols;        // columns in the region
+    int image_rows;  // rows of pixels in the image
+    int image_cols;  // columns of pixels in the image
+};
+
+/* fill in the tables for cells that are dead or alive */
+void paint_lut_init(struct paint_lut *lut, struct rgb dead, struct rgb alive);
+
+/* paint the view's region of board into image (image_rows * image_cols
+ * pixels): one pixel per cell if the image is the region's size, shaded
+ * blocks of cells otherwise */
+void paint_view(const struct paint_lut *lut, const struct paint_view *view,
+        const struct bitgrid *board, struct rgb *image);
+
+#endif  /* __PAINT_H__ */
@@ -0,0 +1,89 @@
+/*
+ * Per-phase timers and cell counters for play_gol (make PROFILE=1).
+ * See prof.h for what each phase covers.
+ */
+#include <string.h>
+#include "prof.h"
+
+#ifdef GOL_PROFILE
+
+static const char *phase_names[PROF_PHASES] = {
+    "step", "count", "swap", "publish", "diff", "draw", "paint"
+};
+
+/* start counting, see prof.h
+ * returns: 0 on success, 1 if the trace file couldn't be opened
+ */
+int prof_init(struct prof *prof, const char *trace_path) {
+    memset(prof, 0, sizeof(*prof));
+    if (trace_path == NULL) {
+        return 0;
+    }
+    prof->trace = fopen(trace_path, "w");
+    if (prof->trace == NULL) {
+        perror(trace_path);
+        return 1;
+    }
+    fprintf(prof->trace, "round,step_ns,count_ns,swap_ns,publish_ns,"
+            "diff_ns,evaluated,changed\n");
+    return 0;
+}
+
+/* add ns nanoseconds to phase */
+void prof_add(struct prof *prof, int phase, uint64_t ns) {
+    struct prof_phase *p = &prof->phases[phase];
+
+    p->ns += ns;
+    p->calls++;
+    if (ns > p->max_ns) {
+        p->max_ns = ns;
+    }
+    prof->round_ns[phase] += ns;
+}
+
+/* finish round, which evaluated and changed that many cells */
+void prof_end_round(struct prof *prof, int round, long evaluated,
+        long changed)
+{
+    prof->rounds++;
+    prof->evaluated += evaluated;
+    prof->changed += changed;
+    if (prof->trace != NULL) {
+        fprintf(prof->trace, "%d,%llu,%llu,%llu,%llu,%llu,%ld,%ld\n", round,
+                (unsigned long long)prof->round_ns[PROF_STEP],
+                (unsigned long long)prof->round_ns[PROF_COUNT],
+                (unsigned long long)prof->round_ns[PROF_SWAP],
+                (unsigned long long)prof->round_ns[PROF_PUBLISH],
+                (unsigned long long)prof->round_ns[PROF_DIFF],
+                evaluated, changed);
+    }
+    prof->round_ns[PROF_STEP] = prof->round_ns[PROF_COUNT] = 0;
+    prof->round_ns[PROF_SWAP] = prof->round_ns[PROF_PUBLISH] = 0;
+    prof->round_ns[PROF_DIFF] = 0;
+}
+
+/* print the totals to out, and close the trace file */
+void prof_report(struct prof *prof, FILE *out) {
+    fprintf(out, "Profile: %ld rounds, %ld cells evaluated, %ld changed\n",
+            prof->rounds, prof->evaluated, prof->changed);
+    for (int p = 0; p < PROF_PHASES; p++) {
+        const struct prof_phase *phase = &prof->phases[p];
+
+        if (phase->calls == 0) {
+            continue;
+        }
+        fprintf(out, "  %-8s %10.6f s in %ld calls (%.3f us each, max "
+                "%.3f us)\n", phase_names[p], phase->ns / 1e9, phase->calls,
+                phase->ns / 1e3 / phase->calls, phase->max_ns / 1e3);
+    }
+    if (prof->evaluated > 0) {
+        fprintf(out, "  %.3f ns per cell evaluated\n",
+                (double)prof->phases[PROF_STEP].ns / prof->evaluated);
+    }
+    if (prof->trace != NULL) {
+        fclose(prof->trace);
+        prof->trace = NULL;
+    }
+}
+
+#endif  /* GOL_PROFILE */
@@ -0,0 +1,96 @@
+#ifndef __PROF_H__
+#define __PROF_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+/* Optional instrumentation of the hot paths of play_gol, built in with
+ * make PROFILE=1 (-DGOL_PROFILE).  Without it, the PROF_ macros expand to
+ * nothing and none of this is compiled.
+ *
+ * Each phase is timed with clock_gettime(CLOCK_MONOTONIC), a few calls a
+ * round rather than one per cell:
+ *   PROF_STEP     computing next round's cells: count_neighbors and
+ *                 update_world, or the kernels (the slowest thread's time)
+ *   PROF_COUNT    adding up the threads' live cell counts
+ *   PROF_SWAP     swapping in next round's board (and refreshing the halo)
+ *   PROF_PUBLISH  copying the board for the render thread
+ *   PROF_DIFF     counting the cells that changed, which only a PROFILE=1
+ *                 build does (a block of rows at a time, by the threads
+ *                 that just computed it, or the whole board on one
+ *                 thread for the tile and --temporal schedules)
+ *   PROF_DRAW     print_board, or drawing an ASCII frame
+ *   PROF_PAINT    update_color, painting a ParaVis frame
+ * along with the cells evaluated and changed each round.  The simulation
+ * phases are also written to the --trace file, one line per round; drawing
+ * and painting happen on the render thread, a frame at a time, and are only
+ * in the summary.
+ */
+
+enum {
+    PROF_STEP,
+    PROF_COUNT,
+    PROF_SWAP,
+    PROF_PUBLISH,
+    PROF_DIFF,
+    PROF_DRAW,
+    PROF_PAINT,
+    PROF_PHASES
+};
+
+struct prof_phase {
+    uint64_t ns;      // total time in this phase
+    uint64_t max_ns;  // longest single call
+    long calls;
+};
+
+struct prof {
+    struct prof_phase phases[PROF_PHASES];
+    uint64_t round_ns[PROF_PHASES];  // this round's time, for the trace
+    long rounds;
+    long evaluated;  // cells whose next state was computed
+    long changed;    // cells whose state changed
+    FILE *trace;     // one line per round, or NULL
+};
+
+#ifdef GOL_PROFILE
+
+/* return the time on the monotonic clock, in nanoseconds */
+static inline uint64_t prof_now(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+/* start counting, with a per-round trace written to trace_path if it isn't
+ * NULL
+ * returns: 0 on success, 1 if the trace file couldn't be opened */
+int prof_init(struct prof *prof, const char *trace_path);
+
+/* add ns nanoseconds to phase (each phase must be added to by one thread
+ * at a time) */
+void prof_add(struct prof *prof, int phase, uint64_t ns);
+
+/* finish round, which evaluated and changed that many cells */
+void prof_end_round(struct prof *prof, int round, long evaluated,
+        long changed);
+
+/* print the totals to out, and close the trace file */
+void prof_report(struct prof *prof, FILE *out);
+
+/* declare a start time named t */
+#define PROF_START(t)              uint64_t t = prof_now()
+
+/* add the time since t to phase */
+#define PROF_STOP(prof, phase, t)  prof_add((prof), (phase), prof_now() - (t))
+
+#else
+
+#define PROF_START(t)
+#define PROF_STOP(prof, phase, t)
+
+#endif  /* GOL_PROFILE */
+
+#endif  /* __PROF_H__ */
@@ -0,0 +1,274 @@
+/*
+ * Reading and writing RLE patterns.
+ * See rle.h for the format.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "rle.h"
+#include "rule.h"
+
+#define RLE_LINE_WIDTH  (70)   // longest line rle_write writes
+
+/* return 1 if the file at path looks like an RLE pattern, 0 if not */
+int rle_check(const char *path) {
+    FILE *file = fopen(path, "r");
+    int c;
+
+    if (file == NULL) {
+        return 0;
+    }
+    do {
+        c = getc(file);
+    } while (c == ' ' || c == '\t' || c == '\r' || c == '\n');
+    fclose(file);
+
+    //board files start with a number, patterns with a comment or header
+    return c == '#' || c == 'x';
+}
+
+/* check that the rule named at the start of text is the rule being
+ * played, printing what is wrong if not
+ * returns: 0 if it is, 1 if not */
+static int check_rule(struct rle_reader *reader, const char *text,
+        const struct life_rule *rule)
+{
+    char name[RULE_NAME_MAX];
+    struct life_rule pattern_rule;
+    int len = 0;
+
+    while (*text == ' ' || *text == '\t') {
+        text++;
+    }
+    while (len < (int)sizeof(name) - 1 && text[len] != '\0'
+            && strchr(", \t\r\n", text[len]) == NULL) {
+        name[len] = text[len];
+        len++;
+    }
+    name[len] = '\0';
+    if (rule_parse(name, &pattern_rule) != 0) {
+        printf("Error: %s line %ld: can't read the rule %s\n", reader->path,
+                reader->line, name);
+        return 1;
+    }
+    if (pattern_rule.states > 2) {
+        printf("Error: %s line %ld: multi-state patterns (rule %s) can't be "
+                "read\n", reader->path, reader->line, pattern_rule.name);
+        return 1;
+    }
+    if (!rule_equal(&pattern_rule, rule)) {
+        printf("Error: %s line %ld: the pattern is for rule %s: play it with "
+                "--rule=%s\n", reader->path, reader->line, pattern_rule.name,
+                pattern_rule.name);
+        return 1;
+    }
+    return 0;
+}
+
+/* open the pattern at path and read its header, see rle.h
+ * returns: 0 on success, 1 on error
+ */
+int rle_open(struct rle_reader *reader, const char *path,
+        const struct life_rule *rule)
+{
+    char *line = NULL;
+    size_t size = 0;
+    int ret = 1;
+
+    memset(reader, 0, sizeof(*reader));
+    reader->path = path;
+    reader->file = fopen(path, "r");
+    if (reader->file == NULL) {
+        printf("Error: Failure to open file.\n");
+        return 1;
+    }
+
+    //skip the comment lines, down to the header
+    while (getline(&line, &size, reader->file) > 0) {
+        char *rule_text;
+
+        reader->line++;
+        if (line[0] == '#' || strspn(line, " \t\r\n") == strlen(line)) {
+            continue;
+        }
+        if (sscanf(line, " x = %d , y = %d", &reader->cols,
+                    &reader->rows) != 2
+                || reader->cols < 0 || reader->rows < 0) {
+            printf("Error: %s line %ld: expected a header like "
+                    "\"x = 3, y = 3\"\n", path, reader->line);
+            break;
+        }
+        rule_text = strstr(line, "rule");
+        if (rule_text != NULL && (rule_text = strchr(rule_text, '=')) != NULL
+                && check_rule(reader, rule_text + 1, rule) != 0) {
+            break;
+        }
+        ret = 0;
+        break;
+    }
+    if (ret != 0 && !ferror(reader->file) && feof(reader->file)) {
+        printf("Error: %s has no \"x = , y = \" header\n", path);
+    }
+    free(line);
+    if (ret != 0) {
+        rle_close(reader);
+    }
+    return ret;
+}
+
+/* decode the pattern's live cells at (row, col) of the board, see rle.h
+ * returns: 0 on success, 1 on error
+ */
+int rle_decode(struct rle_reader *reader, int row, int col,
+        rle_run_func set_run, void *arg)
+{
+    FILE *file = reader->file;
+    long count = 0;
+    long i = 0, j = 0;
+    int c;
+
+    reader->line++;
+    while ((c = getc_unlocked(file)) != EOF && c != '!') {
+        long n = count ? count : 1;
+
+        if (c >= '0' && c <= '9') {
+            count = count * 10 + (c - '0');
+            if (count > INT_MAX) {
+                printf("Error: %s line %ld: repeat count is too big\n",
+                        reader->path, reader->line);
+                return 1;
+            }
+            continue;
+        }
+        count = 0;
+        if (c == '\n') {
+            reader->line++;
+        }
+        else if (c == ' ' || c == '\t' || c == '\r') {
+            continue;
+        }
+        else if (c == '$') {
+            i += n;
+            j = 0;
+            if (i > reader->rows) {
+                i = reader->rows;  // blank rows past the end don't matter
+            }
+        }
+        else if (c == 'b' || c == '.') {
+            j += n;
+        }
+        else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+            //a run of live cells, which has to fit in the pattern's box
+            if (i >= reader->rows || n > reader->cols - j) {
+                printf("Error: %s line %ld: live cells fall outside the "
+                        "%d x %d pattern\n", reader->path, reader->line,
+                        reader->cols, reader->rows);
+                return 1;
+            }
+            if (set_run(arg, row + i, col + j, n) != 0) {
+                return 1;
+            }
+            reader->live += n;
+            j += n;
+        }
+        else {
+            printf("Error: %s line %ld: unexpected '%c' in pattern\n",
+                    reader->path, reader->line, c);
+            return 1;
+        }
+        if (j > reader->cols) {
+            j = reader->cols;  // dead cells past the end don't matter
+        }
+    }
+    return 0;
+}
+
+/* close the pattern file */
+void rle_close(struct rle_reader *reader) {
+    if (reader->file != NULL) {
+        fclose(reader->file);
+        reader->file = NULL;
+    }
+}
+
+/* one output line of rle_write */
+struct rle_line {
+    FILE *file;
+    int width;    // characters written to the line so far
+};
+
+/* write a run of n tags, starting a new line if this one is full */
+static void put_run(struct rle_line *out, long n, char tag) {
+    char run[24];
+    int len;
+
+    if (n > 1) {
+        len = snprintf(run, sizeof(run), "%ld%c", n, tag);
+    }
+    else {
+        len = snprintf(run, sizeof(run), "%c", tag);
+    }
+    if (out->width + len > RLE_LINE_WIDTH) {
+        putc('\n', out->file);
+        out->width = 0;
+    }
+    fputs(run, out->file);
+    out->width += len;
+}
+
+/* write the rows x cols board to path, see rle.h
+ * returns: 0 on success, 1 on error
+ */
+int rle_write(const char *path, int rows, int cols, int round,
+        const char *rule, rle_cell_func alive, void *arg)
+{
+    struct rle_line out;
+    long rows_ended = 0;   // '$'s owed before the next live cell
+    int ret = 0;
+
+    out.file = fopen(path, "w");
+    out.width = 0;
+    if (out.file == NULL) {
+        printf("Error: Failure to open %s for writing.\n", path);
+        return 1;
+    }
+    fprintf(out.file, "#C Game Of Life board after %d rounds\n", round);
+    fprintf(out.file, "x = %d, y = %d, rule = %s\n", cols, rows, rule);
+
+    //Dead cells at the end of a row, and blank rows at the end of the
+    //board, are left out.
+    for (int i = 0; i < rows; i++) {
+        int j = 0;
+
+        while (j < cols) {
+            int state = alive(arg, i, j);
+            int start = j;
+
+            while (j < cols && alive(arg, i, j) == state) {
+                j++;
+            }
+            if (state == 0 && j == cols) {
+                break;
+            }
+            if (rows_ended > 0) {
+                put_run(&out, rows_ended, '$');
+                rows_ended = 0;
+            }
+            put_run(&out, j - start, state ? 'o' : 'b');
+        }
+        rows_ended++;
+    }
+    put_run(&out, 1, '!');
+    putc('\n', out.file);
+
+    if (ferror(out.file)) {
+        ret = 1;
+    }
+    if (fclose(out.file) != 0) {
+        ret = 1;
+    }
+    if (ret != 0) {
+        printf("Error: Failure to write %s.\n", path);
+    }
+    return ret;
+}
@@ -0,0 +1,64 @@
+#ifndef __RLE_H__
+#define __RLE_H__
+
+#include <stdio.h>
+#include "rule.h"
+
+/* Reading and writing patterns in the run-length encoded (.rle) format
+ * used by Golly and most pattern collections:
+ *
+ *     #C any number of comment lines
+ *     x = 3, y = 3, rule = B3/S23
+ *     bo$2bo$3o!
+ *
+ * The header gives the pattern's width (x) and height (y), and the rule it
+ * is for (see rule.h), which has to be the rule being played.  In the body,
+ * 'b' is a dead cell, 'o' (or any other letter) a live one, '$' ends a row
+ * and '!' ends the pattern, each optionally preceded by a repeat count.
+ *
+ * The reader streams the body and hands each run of live cells straight to
+ * a callback, so a pattern is decoded into the board without ever building
+ * a list of its cells.
+ */
+
+struct rle_reader {
+    FILE *file;
+    const char *path;
+    int rows;       // height of the pattern (y)
+    int cols;       // width of the pattern (x)
+    long line;      // line of the file being read, for error messages
+    long live;      // live cells decoded so far
+};
+
+/* called with each run of n live cells starting at (i, j) of the board
+ * returns 0 to keep going, 1 to stop with an error */
+typedef int (*rle_run_func)(void *arg, int i, int j, int n);
+
+/* called to ask if cell (i, j) of the board being written is alive */
+typedef int (*rle_cell_func)(void *arg, int i, int j);
+
+/* return 1 if the file at path looks like an RLE pattern, 0 if not */
+int rle_check(const char *path);
+
+/* open the pattern at path and read its header into reader, printing what
+ * is wrong with it if anything is (a rule other than rule included)
+ * returns 0 on success, 1 on error */
+int rle_open(struct rle_reader *reader, const char *path,
+        const struct life_rule *rule);
+
+/* decode the pattern's live cells, with its top left corner at (row, col)
+ * of the board, calling set_run for each run of them
+ * returns 0 on success, 1 on error */
+int rle_decode(struct rle_reader *reader, int row, int col,
+        rle_run_func set_run, void *arg);
+
+/* close the pattern file */
+void rle_close(struct rle_reader *reader);
+
+/* write the rows x cols board, as of round, to path as a pattern for the
+ * rule named rule, asking alive about each cell
+ * returns 0 on success, 1 on error */
+int rle_write(const char *path, int rows, int cols, int round,
+        const char *rule, rle_cell_func alive, void *arg);
+
+#endif  /* __RLE_H__ */
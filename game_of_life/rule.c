@@ -0,0 +1,186 @@
+/*
+ * Rules in B/S notation, and the Generations rules.
+ * See rule.h for the notation and what the rules do.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "rule.h"
+
+#define LIFE_BIRTH    (1u << 3)
+#define LIFE_SURVIVE  ((1u << 2) | (1u << 3))
+
+/* fill in rule's name and next state tables from its birth and survival
+ * counts and its number of states */
+static void rule_build(struct life_rule *rule) {
+    char *name = rule->name;
+
+    *name++ = 'B';
+    for (int n = 0; n <= 8; n++) {
+        if ((rule->birth >> n) & 1) {
+            *name++ = '0' + n;
+        }
+    }
+    *name++ = '/';
+    *name++ = 'S';
+    for (int n = 0; n <= 8; n++) {
+        if ((rule->survive >> n) & 1) {
+            *name++ = '0' + n;
+        }
+    }
+    *name = '\0';
+    if (rule->states > 2) {
+        sprintf(name, "/C%d", rule->states);
+    }
+
+    memset(rule->next, 0, sizeof(rule->next));
+    for (int n = 0; n <= 8; n++) {
+        rule->next[0][n] = (rule->birth >> n) & 1;
+        if ((rule->survive >> n) & 1) {
+            rule->next[1][n] = 1;
+        }
+        else {
+            //a live cell that doesn't survive starts dying, if it can
+            rule->next[1][n] = (rule->states > 2) ? 2 : 0;
+        }
+        for (int s = 2; s < rule->states; s++) {
+            rule->next[s][n] = (s + 1 < rule->states) ? s + 1 : 0;
+        }
+    }
+}
+
+/* set rule to Conway's Life, see rule.h */
+void rule_init_life(struct life_rule *rule) {
+    rule->birth = LIFE_BIRTH;
+    rule->survive = LIFE_SURVIVE;
+    rule->states = 2;
+    rule_build(rule);
+}
+
+/* set rule to a two-state rule from its counts, see rule.h */
+void rule_init_counts(struct life_rule *rule, unsigned birth,
+        unsigned survive)
+{
+    rule->birth = birth & 0x1ff;
+    rule->survive = survive & 0x1ff;
+    rule->states = 2;
+    rule_build(rule);
+}
+
+/* parse the neighbor counts in [start, end) into *mask
+ * returns: 0 on success, 1 if they aren't distinct digits 0 to 8
+ */
+static int parse_counts(const char *start, const char *end, unsigned *mask) {
+    *mask = 0;
+    for (const char *p = start; p < end; p++) {
+        if (*p < '0' || *p > '8' || ((*mask >> (*p - '0')) & 1)) {
+            return 1;
+        }
+        *mask |= 1u << (*p - '0');
+    }
+    return 0;
+}
+
+/* parse the number of states in [start, end) into *states
+ * returns: 0 on success, 1 if it isn't a number 2 to RULE_MAX_STATES
+ */
+static int parse_states(const char *start, const char *end, int *states) {
+    int n = 0;
+
+    if (start == end) {
+        return 1;
+    }
+    for (const char *p = start; p < end; p++) {
+        if (!isdigit((unsigned char)*p) || n > RULE_MAX_STATES) {
+            return 1;
+        }
+        n = n * 10 + (*p - '0');
+    }
+    *states = n;
+    return n < 2 || n > RULE_MAX_STATES;
+}
+
+/* parse the rule in text, see rule.h
+ * returns: 0 on success, 1 if text isn't a rule
+ */
+int rule_parse(const char *text, struct life_rule *rule) {
+    const char *start[3], *end[3];
+    int fields = 0;
+    int seen[3] = {0, 0, 0};  // the B, S and C fields, if they're labeled
+    int labeled;
+    const char *p = text;
+
+    //split text into its one to three fields
+    while (fields < 3) {
+        start[fields] = p;
+        while (*p != '\0' && *p != '/') {
+            p++;
+        }
+        end[fields++] = p;
+        if (*p == '\0') {
+            break;
+        }
+        p++;
+    }
+    if (*p != '\0' || fields < 2) {
+        return 1;
+    }
+
+    rule->birth = rule->survive = 0;
+    rule->states = 2;
+    labeled = isalpha((unsigned char)*start[0]);
+    for (int f = 0; f < fields; f++) {
+        const char *s = start[f];
+        int field = f;  // 0 birth, 1 survival, 2 states
+        int bad;
+
+        if (labeled) {
+            char *letters = "BSC";
+            char *letter = (*s != '\0') ? strchr(letters, toupper(*s)) : NULL;
+
+            if (letter == NULL) {
+                return 1;
+            }
+            field = letter - letters;
+            s++;
+        }
+        else {
+            //unlabeled fields go survival, birth, states
+            field = (f == 0) ? 1 : (f == 1) ? 0 : 2;
+        }
+        if (seen[field]) {
+            return 1;
+        }
+        seen[field] = 1;
+        if (field == 0) {
+            bad = parse_counts(s, end[f], &rule->birth);
+        }
+        else if (field == 1) {
+            bad = parse_counts(s, end[f], &rule->survive);
+        }
+        else {
+            bad = parse_states(s, end[f], &rule->states);
+        }
+        if (bad) {
+            return 1;
+        }
+    }
+    if (!seen[0] || !seen[1]) {
+        return 1;
+    }
+    rule_build(rule);
+    return 0;
+}
+
+/* return 1 if rule is Conway's Life, 0 if not */
+int rule_is_life(const struct life_rule *rule) {
+    return rule->birth == LIFE_BIRTH && rule->survive == LIFE_SURVIVE
+        && rule->states == 2;
+}
+
+/* return 1 if a and b are the same rule, 0 if not */
+int rule_equal(const struct life_rule *a, const struct life_rule *b) {
+    return a->birth == b->birth && a->survive == b->survive
+        && a->states == b->states;
+}
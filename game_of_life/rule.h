@@ -0,0 +1,60 @@
+#ifndef __RULE_H__
+#define __RULE_H__
+
+/* Rules other than Conway's Life (--rule), in the B/S notation used by
+ * Golly and most pattern collections:
+ *
+ *     B3/S23     born with 3 live neighbors, survives with 2 or 3 (Life)
+ *     B36/S23    HighLife
+ *     23/3       the same as B3/S23, survival counts first
+ *     B2/S/C3    a Generations rule (Brian's Brain): 3 states
+ *     /2/3       the same, survival counts first
+ *
+ * A Generations rule with C states has, besides dead (0) and alive (1),
+ * C - 2 dying states: a live cell that doesn't survive starts dying instead
+ * of dying at once, moves one state on every round, and is dead once it
+ * gets to state C, neither counting as a neighbor nor coming back to life
+ * along the way.  Only live cells count as neighbors.
+ *
+ * Two-state rules run on every grid and kernel: Life itself on the kernels
+ * of swar.h, a few common rules on kernels specialized for them at compile
+ * time, and the rest on a generic one (see swar_rule_init).  Generations
+ * rules need a state per cell, so they only run on the int grid, with the
+ * naive, halo and lut kernels looking each cell's next state up in the
+ * rule's tables.
+ */
+
+#define RULE_MAX_STATES  (256)  // most states a Generations rule can have
+#define RULE_NAME_MAX    (32)   // longest rule name, its '\0' included
+
+struct life_rule {
+    unsigned birth;    // bit n set: a dead cell with n live neighbors is born
+    unsigned survive;  // bit n set: a live cell with n live neighbors lives on
+    int states;        // 2, or the C of a Generations rule
+    char name[RULE_NAME_MAX];  // as B3/S23, or B2/S/C3 for Generations
+
+    /* the state of a cell next round, by its state and number of live
+     * neighbors now */
+    unsigned char next[RULE_MAX_STATES][9];
+};
+
+/* set rule to Conway's Life, B3/S23 */
+void rule_init_life(struct life_rule *rule);
+
+/* set rule to the two-state rule with the birth and survive counts (bit n
+ * for n live neighbors, as in struct life_rule) */
+void rule_init_counts(struct life_rule *rule, unsigned birth,
+        unsigned survive);
+
+/* parse the rule in text (see above) into rule
+ * returns 0 on success, 1 if text isn't a rule */
+int rule_parse(const char *text, struct life_rule *rule);
+
+/* return 1 if rule is Conway's Life, 0 if not */
+int rule_is_life(const struct life_rule *rule);
+
+/* return 1 if a and b are the same rule, however they were written, 0 if
+ * not */
+int rule_equal(const struct life_rule *a, const struct life_rule *b);
+
+#endif  /* __RULE_H__ */
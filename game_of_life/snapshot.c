@@ -0,0 +1,273 @@
+/*
+ * Binary snapshots of a board, and the thread that writes them.
+ * See snapshot.h for the file format.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot.h"
+
+_Static_assert(sizeof(struct snapshot_header) == 64,
+        "snapshot header must stay 64 bytes");
+
+/* return 1 if the file at path starts like a snapshot, 0 if not */
+int snapshot_check(const char *path) {
+    char magic[SNAPSHOT_MAGIC_LEN];
+    int fd = open(path, O_RDONLY);
+    int is_snapshot;
+
+    if (fd < 0) {
+        return 0;
+    }
+    is_snapshot = read(fd, magic, sizeof(magic)) == sizeof(magic)
+        && memcmp(magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN) == 0;
+    close(fd);
+    return is_snapshot;
+}
+
+/* map the snapshot at path into snap, see snapshot.h
+ * returns: 0 on success, 1 on error
+ */
+int snapshot_open(const char *path, struct snapshot *snap) {
+    const struct snapshot_header *header;
+    struct stat st;
+    int fd;
+
+    memset(snap, 0, sizeof(*snap));
+    fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        printf("Error: Failure to open file.\n");
+        if (fd >= 0) {
+            close(fd);
+        }
+        return 1;
+    }
+    if ((size_t)st.st_size < sizeof(struct snapshot_header)) {
+        printf("Error: snapshot %s is cut short\n", path);
+        close(fd);
+        return 1;
+    }
+    snap->size = st.st_size;
+    snap->map = mmap(NULL, snap->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (snap->map == MAP_FAILED) {
+        printf("Error: Failure to map snapshot %s.\n", path);
+        snap->map = NULL;
+        return 1;
+    }
+
+    header = snap->header = snap->map;
+    snap->bits = (const uint64_t *)(header + 1);
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN) != 0
+            || header->rows < 1 || header->cols < 1
+            || header->words != (header->cols + 63) / 64
+            || header->round < 0 || header->round > header->iters) {
+        printf("Error: %s is not a snapshot this program can read\n", path);
+        snapshot_close(snap);
+        return 1;
+    }
+    if (snap->size != sizeof(struct snapshot_header)
+            + (size_t)header->rows * header->words * sizeof(uint64_t)) {
+        printf("Error: snapshot %s is the wrong size for its board\n", path);
+        snapshot_close(snap);
+        return 1;
+    }
+    return 0;
+}
+
+/* unmap a snapshot */
+void snapshot_close(struct snapshot *snap) {
+    if (snap->map != NULL) {
+        munmap(snap->map, snap->size);
+    }
+    memset(snap, 0, sizeof(*snap));
+}
+
+/* write the writer's writing board to its temporary file, then rename it
+ * over the last snapshot
+ * returns: 0 on success, 1 on error */
+static int write_snapshot(struct snapshot_writer *writer) {
+    const char *out = (const char *)writer->writing.bits;
+    size_t size = (size_t)writer->writing.rows * writer->writing.words
+        * sizeof(uint64_t);
+    int fd = open(writer->temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int ret = 0;
+
+    if (fd < 0) {
+        return 1;
+    }
+    writer->writing_header.live = bitgrid_count(&writer->writing);
+    if (write(fd, &writer->writing_header, sizeof(struct snapshot_header))
+            != sizeof(struct snapshot_header)) {
+        ret = 1;
+    }
+    while (ret == 0 && size > 0) {
+        ssize_t n = write(fd, out, size);
+
+        if (n <= 0) {
+            ret = 1;
+            break;
+        }
+        out += n;
+        size -= n;
+    }
+    if (ret == 0 && fsync(fd) != 0) {
+        ret = 1;
+    }
+    if (close(fd) != 0) {
+        ret = 1;
+    }
+    if (ret == 0 && rename(writer->temp_path, writer->path) != 0) {
+        ret = 1;
+    }
+    return ret;
+}
+
+/* the writer thread: waits for pending snapshots and writes them out, until
+ * it is stopped with none left pending */
+static void *writer_main(void *arg) {
+    struct snapshot_writer *writer = arg;
+
+    pthread_mutex_lock(&writer->lock);
+    while (1) {
+        struct bitgrid temp;
+
+        while (!writer->have_pending && !writer->stopping) {
+            pthread_cond_wait(&writer->ready, &writer->lock);
+        }
+        if (!writer->have_pending) {
+            break;
+        }
+
+        //take the pending snapshot, leaving its buffer free for the next
+        temp = writer->writing;
+        writer->writing = writer->pending;
+        writer->pending = temp;
+        writer->writing_header = writer->pending_header;
+        writer->have_pending = 0;
+        pthread_mutex_unlock(&writer->lock);
+
+        if (write_snapshot(writer) != 0) {
+            fprintf(stderr, "Error: Failure to write snapshot %s\n",
+                    writer->path);
+            writer->failed++;
+        }
+        else {
+            writer->written++;
+        }
+        pthread_mutex_lock(&writer->lock);
+    }
+    pthread_mutex_unlock(&writer->lock);
+    return NULL;
+}
+
+/* record rule in header, see snapshot.h */
+void snapshot_set_rule(struct snapshot_header *header,
+        const struct life_rule *rule)
+{
+    //a Generations rule's dying cells aren't kept, so it can't resume
+    if (rule->states == 2) {
+        header->has_rule = 1;
+        header->birth = rule->birth;
+        header->survive = rule->survive;
+    }
+}
+
+/* check the rule a snapshot records against rule, see snapshot.h
+ * returns: 1 if they match (or there is none), 0 if not
+ */
+int snapshot_rule_matches(const struct snapshot_header *header,
+        const struct life_rule *rule, struct life_rule *recorded)
+{
+    if (!header->has_rule) {
+        return 1;
+    }
+    rule_init_counts(recorded, header->birth, header->survive);
+    return rule_equal(recorded, rule);
+}
+
+/* start a writer thread for rows x cols snapshots saved to path
+ * returns: 0 on success, 1 on error
+ */
+int snapshot_writer_start(struct snapshot_writer *writer, const char *path,
+        int rows, int cols, const struct life_rule *rule)
+{
+    memset(writer, 0, sizeof(*writer));
+    writer->rule = *rule;
+    writer->path = strdup(path);
+    writer->temp_path = malloc(strlen(path) + sizeof(".tmp"));
+    if (writer->path == NULL || writer->temp_path == NULL
+            || bitgrid_init(&writer->pending, rows, cols) != 0
+            || bitgrid_init(&writer->writing, rows, cols) != 0) {
+        free(writer->path);
+        free(writer->temp_path);
+        bitgrid_free(&writer->pending);
+        bitgrid_free(&writer->writing);
+        return 1;
+    }
+    sprintf(writer->temp_path, "%s.tmp", path);
+
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->ready, NULL);
+    if (pthread_create(&writer->tid, NULL, writer_main, writer)) {
+        pthread_mutex_destroy(&writer->lock);
+        pthread_cond_destroy(&writer->ready);
+        free(writer->path);
+        free(writer->temp_path);
+        bitgrid_free(&writer->pending);
+        bitgrid_free(&writer->writing);
+        return 1;
+    }
+    return 0;
+}
+
+/* return the pending board to fill in, holding the lock until
+ * snapshot_commit */
+struct bitgrid *snapshot_begin(struct snapshot_writer *writer) {
+    pthread_mutex_lock(&writer->lock);
+    if (writer->have_pending) {
+        writer->replaced++;
+    }
+    return &writer->pending;
+}
+
+/* hand the filled-in pending board to the writer thread */
+void snapshot_commit(struct snapshot_writer *writer, int iters, int round) {
+    struct snapshot_header *header = &writer->pending_header;
+
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN);
+    header->rows = writer->pending.rows;
+    header->cols = writer->pending.cols;
+    header->words = writer->pending.words;
+    header->iters = iters;
+    header->round = round;
+    snapshot_set_rule(header, &writer->rule);
+    writer->have_pending = 1;
+    pthread_cond_signal(&writer->ready);
+    pthread_mutex_unlock(&writer->lock);
+}
+
+/* write the last pending snapshot, stop the writer thread and free it
+ * returns: 0 if every snapshot was written, 1 if any failed
+ */
+int snapshot_writer_stop(struct snapshot_writer *writer) {
+    pthread_mutex_lock(&writer->lock);
+    writer->stopping = 1;
+    pthread_cond_signal(&writer->ready);
+    pthread_mutex_unlock(&writer->lock);
+    pthread_join(writer->tid, NULL);
+
+    pthread_mutex_destroy(&writer->lock);
+    pthread_cond_destroy(&writer->ready);
+    free(writer->path);
+    free(writer->temp_path);
+    bitgrid_free(&writer->pending);
+    bitgrid_free(&writer->writing);
+    writer->path = writer->temp_path = NULL;
+    return writer->failed != 0;
+}
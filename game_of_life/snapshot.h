@@ -0,0 +1,112 @@
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "bitgrid.h"
+#include "rule.h"
+
+/* Binary snapshots of a board, for checkpointing long runs and resuming
+ * them.
+ *
+ * A snapshot file is a 64-byte header followed by the board exactly as a
+ * bitgrid stores it: rows * words 64-bit words, row-major, one bit per
+ * cell, in the byte order of the machine that wrote it.  Resuming maps the
+ * file and copies the words straight into the board, with no parsing.
+ *
+ * The header records the (two-state) rule the board was played under, and
+ * a snapshot is only resumed under that rule: gol, gol_mpi and --batch turn
+ * it down otherwise, naming the --rule to give.  Snapshots from before
+ * rules were recorded have has_rule 0, and resume under any rule.
+ *
+ * Snapshots are written by a thread of their own.  Taking one only copies
+ * the board into the writer's pending buffer; if the writer is still busy
+ * with an older snapshot when a new one is taken, the new one replaces the
+ * pending one, so the rounds never wait on the disk.  Each snapshot is
+ * written to a temporary file and renamed over the old one, so a crash
+ * mid-write leaves the last complete snapshot in place.
+ */
+
+#define SNAPSHOT_MAGIC      "GOLSNAP1"
+#define SNAPSHOT_MAGIC_LEN  (8)
+
+struct snapshot_header {
+    char magic[SNAPSHOT_MAGIC_LEN];  // SNAPSHOT_MAGIC, no terminating 0
+    int32_t rows;       // the row dimension
+    int32_t cols;       // the column dimension
+    int32_t iters;      // rounds the run was asked to play in all
+    int32_t round;      // rounds played when the snapshot was taken
+    int64_t live;       // live cells on the board
+    int32_t words;      // 64-bit words in each row
+    int32_t has_rule;   // 1 if birth and survive hold the rule played
+    uint32_t birth;     // its birth and survival counts (see rule.h)
+    uint32_t survive;
+    char pad[16];       // pads the header out to 64 bytes
+};
+
+/* a snapshot file mapped into memory */
+struct snapshot {
+    const struct snapshot_header *header;
+    const uint64_t *bits;    // header->rows * header->words words
+    void *map;               // the whole mapped file
+    size_t size;             // size of the file in bytes
+};
+
+struct snapshot_writer {
+    char *path;          // where the snapshots go
+    char *temp_path;     // where each one is written before it's renamed
+    struct bitgrid pending;   // the newest snapshot, not yet being written
+    struct bitgrid writing;   // the snapshot being written
+    struct snapshot_header pending_header;
+    struct snapshot_header writing_header;
+    struct life_rule rule;    // the rule recorded in each snapshot
+    int have_pending;    // 1 if pending holds a snapshot to write
+    int stopping;        // 1 once the writer should finish up and exit
+    long written;        // snapshots written
+    long replaced;       // snapshots replaced before they were written
+    long failed;         // snapshots that couldn't be written
+    pthread_mutex_t lock;
+    pthread_cond_t ready;    // signaled when there's a snapshot or a stop
+    pthread_t tid;
+};
+
+/* return 1 if the file at path starts like a snapshot, 0 if not */
+int snapshot_check(const char *path);
+
+/* map the snapshot at path into snap, checking that it is whole, and print
+ * what is wrong with it if anything is
+ * returns 0 on success, 1 on error */
+int snapshot_open(const char *path, struct snapshot *snap);
+
+/* unmap a snapshot */
+void snapshot_close(struct snapshot *snap);
+
+/* record rule in header as the rule played, if it is a two-state rule */
+void snapshot_set_rule(struct snapshot_header *header,
+        const struct life_rule *rule);
+
+/* return 1 if the snapshot with header was played under rule, or records
+ * no rule, 0 if it was played under another one, set in *recorded */
+int snapshot_rule_matches(const struct snapshot_header *header,
+        const struct life_rule *rule, struct life_rule *recorded);
+
+/* start a writer thread for rows x cols snapshots of a board played under
+ * rule, saved to path
+ * returns 0 on success, 1 on error */
+int snapshot_writer_start(struct snapshot_writer *writer, const char *path,
+        int rows, int cols, const struct life_rule *rule);
+
+/* return the writer's pending board for the caller to fill in, holding the
+ * writer's lock until snapshot_commit */
+struct bitgrid *snapshot_begin(struct snapshot_writer *writer);
+
+/* hand the filled-in pending board to the writer thread, as the board after
+ * round of iters */
+void snapshot_commit(struct snapshot_writer *writer, int iters, int round);
+
+/* write the last pending snapshot, stop the writer thread and free it
+ * returns 0 if every snapshot was written, 1 if any failed */
+int snapshot_writer_stop(struct snapshot_writer *writer);
+
+#endif  /* __SNAPSHOT_H__ */
@@ -0,0 +1,162 @@
+/*
+ * Random soups, generated straight into the board.
+ * See soup.h for the generator.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "soup.h"
+
+#define DENSITY_BITS  (16)   // bits of the density that count
+
+/* One block of rows of the board being filled, by its own thread.
+ */
+struct soup_block {
+    const struct soup *soup;
+    struct bitgrid *board;  // the board, if packed
+    uint8_t *cells;         // or the board of a byte per cell
+    int stride;
+    int row_start;          // the block's rows: [row_start, row_end)
+    int row_end;
+    long live;              // live cells in the block
+    int threaded;           // 1 if a thread of its own is filling it
+    pthread_t tid;
+};
+
+/* return output n of a splitmix64 stream from state seed */
+static inline uint64_t splitmix(uint64_t seed, uint64_t n) {
+    uint64_t z = seed + (n + 1) * 0x9E3779B97F4A7C15ull;
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/* fill row i of the soup, see soup.h
+ * returns: the number of live cells in the row
+ */
+long soup_row(const struct soup *soup, int i, uint64_t *row) {
+    int words = (soup->cols + 63) / 64;
+    double scaled = soup->density * (1 << DENSITY_BITS) + 0.5;
+    unsigned threshold = (scaled <= 0) ? 0
+        : (scaled >= (1 << DENSITY_BITS)) ? (1 << DENSITY_BITS)
+        : (unsigned)scaled;
+    long live = 0;
+
+    for (int k = 0; k < words; k++) {
+        uint64_t counter = ((uint64_t)i * words + k) << 4;
+        uint64_t word = 0;
+
+        if (threshold == (1 << DENSITY_BITS)) {
+            word = ~(uint64_t)0;
+        }
+        else if (threshold != 0) {
+            //from the density's lowest 1 bit up, where word starts out as
+            //the hash alone
+            for (int b = __builtin_ctz(threshold); b < DENSITY_BITS; b++) {
+                uint64_t r = splitmix(soup->seed, counter + b);
+
+                word = ((threshold >> b) & 1) ? (word | r) : (word & r);
+            }
+        }
+        if (k == words - 1 && (soup->cols & 63) != 0) {
+            word &= ((uint64_t)1 << (soup->cols & 63)) - 1;
+        }
+        row[k] = word;
+        live += __builtin_popcountll(word);
+    }
+    return live;
+}
+
+/* fill one block of rows (run by each thread) */
+static void *fill_block(void *arg) {
+    struct soup_block *block = arg;
+    const struct soup *soup = block->soup;
+    uint64_t *row = NULL;
+
+    if (block->cells != NULL) {
+        row = malloc(((soup->cols + 63) / 64) * sizeof(uint64_t));
+        if (row == NULL) {
+            printf("Error: Failure to allocate board.\n");
+            exit(1);
+        }
+    }
+    block->live = 0;
+    for (int i = block->row_start; i < block->row_end; i++) {
+        if (block->cells == NULL) {
+            block->live += soup_row(soup, i, bitgrid_row(block->board, i));
+            continue;
+        }
+        block->live += soup_row(soup, i, row);
+        for (int j = 0; j < soup->cols; j++) {
+            block->cells[(long)i * block->stride + j] =
+                (row[j >> 6] >> (j & 63)) & 1;
+        }
+    }
+    free(row);
+    return NULL;
+}
+
+/* fill a board with the soup, num_threads threads each filling a block of
+ * rows (packed if cells is NULL)
+ * returns: the number of live cells
+ */
+static long fill(const struct soup *soup, struct bitgrid *board,
+        uint8_t *cells, int stride, int num_threads)
+{
+    struct soup_block *blocks;
+    long live = 0;
+
+    if (num_threads > soup->rows) {
+        num_threads = soup->rows > 0 ? soup->rows : 1;
+    }
+    blocks = calloc(num_threads, sizeof(*blocks));
+    if (blocks == NULL) {
+        printf("Error: Failure to allocate threads.\n");
+        exit(1);
+    }
+    for (int t = 0; t < num_threads; t++) {
+        blocks[t].soup = soup;
+        blocks[t].board = board;
+        blocks[t].cells = cells;
+        blocks[t].stride = stride;
+        blocks[t].row_start = (long)soup->rows * t / num_threads;
+        blocks[t].row_end = (long)soup->rows * (t + 1) / num_threads;
+    }
+    for (int t = 1; t < num_threads; t++) {
+        blocks[t].threaded = (pthread_create(&blocks[t].tid, NULL,
+                    fill_block, &blocks[t]) == 0);
+        if (!blocks[t].threaded) {
+            //fill this block on the calling thread instead
+            fill_block(&blocks[t]);
+        }
+    }
+    fill_block(&blocks[0]);
+    for (int t = 0; t < num_threads; t++) {
+        if (blocks[t].threaded) {
+            pthread_join(blocks[t].tid, NULL);
+        }
+        live += blocks[t].live;
+    }
+    free(blocks);
+    return live;
+}
+
+/* fill a packed board with the soup, see soup.h
+ * returns: the number of live cells
+ */
+long soup_fill(const struct soup *soup, struct bitgrid *board,
+        int num_threads)
+{
+    return fill(soup, board, NULL, 0, num_threads);
+}
+
+/* fill a board of a byte per cell with the soup, see soup.h
+ * returns: the number of live cells
+ */
+long soup_fill_bytes(const struct soup *soup, uint8_t *cells, int stride,
+        int num_threads)
+{
+    return fill(soup, NULL, cells, stride, num_threads);
+}
@@ -0,0 +1,45 @@
+#ifndef __SOUP_H__
+#define __SOUP_H__
+
+#include <stdint.h>
+#include "bitgrid.h"
+
+/* Random soups: boards with each cell alive with a given probability,
+ * generated straight into the board (--random, and --batch's soup jobs)
+ * rather than written out to a board file and read back.
+ *
+ * The generator is counter-based: each 64-bit word of a row comes from
+ * splitmix64 hashes of the seed and the word's place on the board, not from
+ * a stream, so any block of rows can be filled on its own and the board
+ * comes out the same whatever the number of threads filling it.  Each word
+ * takes one hash per significant bit of the density (kept to 16 bits): the
+ * hashes are combined from the lowest bit up, OR-ing where the density has
+ * a 1 and AND-ing where it has a 0, which leaves each bit set with just
+ * that probability.  A density of 0.5 costs one hash per 64 cells, and no
+ * density costs more than 16.
+ */
+
+struct soup {
+    int rows;              // the board's size
+    int cols;
+    double density;        // each cell's chance of being alive, 0 to 1
+    unsigned long long seed;
+};
+
+/* fill the (cols + 63) / 64 words of row with row i of the soup: cell j in
+ * bit j % 64 of word j / 64, like a bitgrid row (padding bits clear)
+ * returns the number of live cells in the row */
+long soup_row(const struct soup *soup, int i, uint64_t *row);
+
+/* fill board, of the soup's size, with the soup, num_threads threads each
+ * filling a block of rows
+ * returns the number of live cells */
+long soup_fill(const struct soup *soup, struct bitgrid *board,
+        int num_threads);
+
+/* the same, for a board of a byte per cell (0 dead, 1 alive) with cell
+ * (i, j) at cells[i * stride + j] */
+long soup_fill_bytes(const struct soup *soup, uint8_t *cells, int stride,
+        int num_threads);
+
+#endif  /* __SOUP_H__ */
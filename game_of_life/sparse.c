@@ -0,0 +1,316 @@
+/*
+ * Sparse chunk engine for the Game Of Life.
+ * See sparse.h for how the board is stored.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "sparse.h"
+#include "swar.h"
+
+#define SPARSE_MIN_SIZE  (16)  // smallest table and chunk array
+
+/* the cells of a chunk that isn't stored (all dead) */
+static const uint64_t no_bits[SPARSE_CHUNK];
+
+/* return the table slot to start looking for key in */
+static inline size_t hash_key(long key, size_t table_size) {
+    uint64_t h = (uint64_t)key * 0x9E3779B97F4A7C15ull;
+
+    return (size_t)(h ^ (h >> 29)) & (table_size - 1);
+}
+
+/* return the index of the chunk with key in map, or -1 if it isn't there */
+static int find_chunk(const struct sparse_map *map, long key) {
+    size_t mask = map->table_size - 1;
+
+    for (size_t s = hash_key(key, map->table_size); map->table[s] != -1;
+            s = (s + 1) & mask) {
+        if (map->chunks[map->table[s]].key == key) {
+            return map->table[s];
+        }
+    }
+    return -1;
+}
+
+/* empty map's table, resizing it to table_size slots
+ * returns: 0 on success, 1 on allocation failure */
+static int reset_table(struct sparse_map *map, size_t table_size) {
+    if (table_size != map->table_size) {
+        int *table = realloc(map->table, table_size * sizeof(int));
+
+        if (table == NULL) {
+            return 1;
+        }
+        map->table = table;
+        map->table_size = table_size;
+    }
+    memset(map->table, 0xff, table_size * sizeof(int));  // every slot -1
+    return 0;
+}
+
+/* put chunk c of map into its table, which must have a free slot */
+static void index_chunk(struct sparse_map *map, int c) {
+    size_t mask = map->table_size - 1;
+    size_t s = hash_key(map->chunks[c].key, map->table_size);
+
+    while (map->table[s] != -1) {
+        s = (s + 1) & mask;
+    }
+    map->table[s] = c;
+}
+
+/* return the smallest table size that keeps count chunks at most half full */
+static size_t table_size_for(size_t count) {
+    size_t size = SPARSE_MIN_SIZE;
+
+    while (size < 2 * count) {
+        size *= 2;
+    }
+    return size;
+}
+
+/* return the index of the chunk with key in map, adding it with no live
+ * cells if it isn't there yet, or -1 on allocation failure */
+static int add_chunk(struct sparse_map *map, long key) {
+    int c = find_chunk(map, key);
+
+    if (c != -1) {
+        return c;
+    }
+    if (map->count == map->capacity) {
+        size_t capacity = map->capacity ? 2 * map->capacity : SPARSE_MIN_SIZE;
+        struct sparse_chunk *chunks = realloc(map->chunks,
+                capacity * sizeof(struct sparse_chunk));
+
+        if (chunks == NULL) {
+            return -1;
+        }
+        map->chunks = chunks;
+        map->capacity = capacity;
+    }
+    if (2 * (map->count + 1) > map->table_size) {
+        if (reset_table(map, 2 * map->table_size) != 0) {
+            return -1;
+        }
+        for (size_t i = 0; i < map->count; i++) {
+            index_chunk(map, i);
+        }
+    }
+
+    c = map->count++;
+    map->chunks[c].key = key;
+    memset(map->chunks[c].bits, 0, sizeof(map->chunks[c].bits));
+    index_chunk(map, c);
+    return c;
+}
+
+/* return n wrapped around into [0, size) */
+static inline int wrap(int n, int size) {
+    return (n + size) % size;
+}
+
+/* return the number of rows in chunk row cr (the last one may be short) */
+static inline int chunk_height(const struct sparse_world *world, int cr) {
+    return (cr == world->chunk_rows - 1)
+        ? world->rows - cr * SPARSE_CHUNK : SPARSE_CHUNK;
+}
+
+/* return the number of columns in chunk column cc */
+static inline int chunk_width(const struct sparse_world *world, int cc) {
+    return (cc == world->chunk_cols - 1)
+        ? world->cols - cc * SPARSE_CHUNK : SPARSE_CHUNK;
+}
+
+/* return this round's cells of chunk (cr, cc), or no_bits if it isn't
+ * stored */
+static const uint64_t *chunk_bits(const struct sparse_world *world, int cr,
+        int cc)
+{
+    int c = find_chunk(&world->map, (long)cr * world->chunk_cols + cc);
+
+    return (c == -1) ? no_bits : world->map.chunks[c].bits;
+}
+
+/* compute next round's cells of chunk from this round's chunks around it
+ * returns: the number of live cells in it */
+static long play_chunk(const struct sparse_world *world,
+        struct sparse_chunk *chunk)
+{
+    int cr = chunk->key / world->chunk_cols;
+    int cc = chunk->key % world->chunk_cols;
+    int near_rows[3] = {wrap(cr - 1, world->chunk_rows), cr,
+        wrap(cr + 1, world->chunk_rows)};
+    int near_cols[3] = {wrap(cc - 1, world->chunk_cols), cc,
+        wrap(cc + 1, world->chunk_cols)};
+    int height = chunk_height(world, cr);
+    int width = chunk_width(world, cc);
+    int up_last = chunk_height(world, near_rows[0]) - 1;
+    int west_last = chunk_width(world, near_cols[0]) - 1;
+    uint64_t mask = (width == 64) ? ~(uint64_t)0 : ((uint64_t)1 << width) - 1;
+    const uint64_t *near[3][3];
+    long live = 0;
+
+    /* rows -1 to height of the chunk, as they are (mid) and shifted so that
+     * each bit holds its west or east neighbor */
+    uint64_t west[SPARSE_CHUNK + 2], mid[SPARSE_CHUNK + 2];
+    uint64_t east[SPARSE_CHUNK + 2];
+
+    for (int l = 0; l < 3; l++) {
+        for (int k = 0; k < 3; k++) {
+            near[l][k] = chunk_bits(world, near_rows[l], near_cols[k]);
+        }
+    }
+
+    //the rows just above and below the chunk come from the chunk rows
+    //next to it, wrapping around the board
+    for (int i = -1; i <= height; i++) {
+        int l = (i < 0) ? 0 : (i == height) ? 2 : 1;
+        int row = (i < 0) ? up_last : (i == height) ? 0 : i;
+
+        mid[i+1] = near[l][1][row];
+        west[i+1] = (mid[i+1] << 1) | ((near[l][0][row] >> west_last) & 1);
+        east[i+1] = (mid[i+1] >> 1) | ((near[l][2][row] & 1) << (width - 1));
+    }
+
+    for (int i = 0; i < height; i++) {
+        uint64_t next;
+
+        LIFE_ADDERS(west[i], mid[i], east[i], west[i+1], east[i+1],
+                west[i+2], mid[i+2], east[i+2], mid[i+1], next);
+        next &= mask;
+        chunk->bits[i] = next;
+        live += __builtin_popcountll(next);
+    }
+    return live;
+}
+
+/* set up an empty rows x cols world
+ * returns: 0 on success, 1 on error
+ */
+int sparse_init(struct sparse_world *world, int rows, int cols) {
+    memset(world, 0, sizeof(*world));
+    world->rows = rows;
+    world->cols = cols;
+    world->chunk_rows = (rows + SPARSE_CHUNK - 1) / SPARSE_CHUNK;
+    world->chunk_cols = (cols + SPARSE_CHUNK - 1) / SPARSE_CHUNK;
+    if (reset_table(&world->map, SPARSE_MIN_SIZE) != 0) {
+        return 1;
+    }
+    return 0;
+}
+
+/* free the world's storage */
+void sparse_free(struct sparse_world *world) {
+    free(world->map.chunks);
+    free(world->map.table);
+    free(world->next.chunks);
+    free(world->next.table);
+    memset(&world->map, 0, sizeof(world->map));
+    memset(&world->next, 0, sizeof(world->next));
+}
+
+/* return 1 if cell (i, j) is alive, 0 if not */
+int sparse_get(const struct sparse_world *world, int i, int j) {
+    const uint64_t *bits = chunk_bits(world, i / SPARSE_CHUNK,
+            j / SPARSE_CHUNK);
+
+    return (bits[i % SPARSE_CHUNK] >> (j % SPARSE_CHUNK)) & 1;
+}
+
+/* bring cell (i, j) to life
+ * returns: 0 on success, 1 on allocation failure
+ */
+int sparse_set(struct sparse_world *world, int i, int j) {
+    long key = (long)(i / SPARSE_CHUNK) * world->chunk_cols + j / SPARSE_CHUNK;
+    uint64_t bit = (uint64_t)1 << (j % SPARSE_CHUNK);
+    uint64_t *word;
+    int c;
+
+    c = add_chunk(&world->map, key);
+    if (c == -1) {
+        return 1;
+    }
+    word = &world->map.chunks[c].bits[i % SPARSE_CHUNK];
+    if (!(*word & bit)) {
+        *word |= bit;
+        world->live++;
+    }
+    if (world->map.count > world->peak_chunks) {
+        world->peak_chunks = world->map.count;
+    }
+    return 0;
+}
+
+/* play one round, updating world->live
+ * returns: 0 on success, 1 on allocation failure
+ */
+int sparse_step(struct sparse_world *world) {
+    struct sparse_map *map = &world->map;
+    struct sparse_map *next = &world->next;
+    struct sparse_map temp;
+    size_t kept = 0;
+
+    //Every chunk that might have live cells next round: the live chunks and
+    //the chunks around them.
+    next->count = 0;
+    if (reset_table(next, table_size_for(9 * map->count)) != 0) {
+        return 1;
+    }
+    for (size_t c = 0; c < map->count; c++) {
+        int cr = map->chunks[c].key / world->chunk_cols;
+        int cc = map->chunks[c].key % world->chunk_cols;
+
+        for (int l = -1; l <= 1; l++) {
+            long r = wrap(cr + l, world->chunk_rows);
+            for (int k = -1; k <= 1; k++) {
+                if (add_chunk(next, r * world->chunk_cols
+                            + wrap(cc + k, world->chunk_cols)) == -1) {
+                    return 1;
+                }
+            }
+        }
+    }
+    if (next->count > world->peak_chunks) {
+        world->peak_chunks = next->count;
+    }
+
+    //Play them all, packing the ones that stay alive to the front.
+    world->live = 0;
+    for (size_t c = 0; c < next->count; c++) {
+        long live = play_chunk(world, &next->chunks[c]);
+
+        if (live > 0) {
+            if (kept != c) {
+                next->chunks[kept] = next->chunks[c];
+            }
+            kept++;
+            world->live += live;
+        }
+    }
+    if (kept < next->count) {
+        next->count = kept;
+        reset_table(next, next->table_size);  // same size, can't fail
+        for (size_t c = 0; c < kept; c++) {
+            index_chunk(next, c);
+        }
+    }
+
+    //Give back the memory of chunks that have died off, leaving room for
+    //the chunks around the live ones.
+    if (next->capacity > 16 * kept && next->capacity > SPARSE_MIN_SIZE) {
+        size_t capacity = (kept > SPARSE_MIN_SIZE / 2)
+            ? 2 * kept : SPARSE_MIN_SIZE;
+        struct sparse_chunk *chunks = realloc(next->chunks,
+                capacity * sizeof(struct sparse_chunk));
+
+        if (chunks != NULL) {
+            next->chunks = chunks;
+            next->capacity = capacity;
+        }
+    }
+
+    temp = *map;
+    *map = *next;
+    *next = temp;
+    return 0;
+}
@@ -0,0 +1,66 @@
+#ifndef __SPARSE_H__
+#define __SPARSE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Sparse engine for huge, mostly empty boards.
+ *
+ * The board is cut into chunks of SPARSE_CHUNK x SPARSE_CHUNK cells, and
+ * only the chunks that hold live cells are stored, in a hash map keyed by
+ * chunk coordinate.  Each round plays every stored chunk and the chunks
+ * next to them, bit-parallel like the swar kernel; chunks that come alive
+ * are allocated as the pattern grows, and chunks that die are dropped.  So
+ * memory and time go with the number of live chunks, not rows * cols.
+ *
+ * The board still wraps around at its edges like the direct engine's: the
+ * chunks in the last chunk row and column are cut short to fit the board.
+ */
+
+/* size of one chunk: 64 x 64 cells, one 64-bit word per row */
+#define SPARSE_CHUNK  (64)
+
+struct sparse_chunk {
+    long key;                        // chunk row * chunk_cols + chunk col
+    uint64_t bits[SPARSE_CHUNK];     // bit j of word i is cell (i, j)
+};
+
+/* the live chunks of one round, found through an open-addressed table */
+struct sparse_map {
+    struct sparse_chunk *chunks;  // count chunks, in no particular order
+    size_t count;         // number of chunks in use
+    size_t capacity;      // number of chunks allocated
+    int *table;           // index into chunks, or -1 for an empty slot
+    size_t table_size;    // a power of two, at least twice count
+};
+
+struct sparse_world {
+    int rows;          // the row dimension of the board
+    int cols;          // the column dimension of the board
+    int chunk_rows;    // number of chunks down the board
+    int chunk_cols;    // number of chunks across the board
+    long live;         // live cells on the board
+    struct sparse_map map;    // this round's chunks
+    struct sparse_map next;   // next round's chunks, while playing a round
+    size_t peak_chunks;       // most chunks stored at any one time
+};
+
+/* set up an empty rows x cols world
+ * returns 0 on success, 1 on error */
+int sparse_init(struct sparse_world *world, int rows, int cols);
+
+/* free the world's storage */
+void sparse_free(struct sparse_world *world);
+
+/* return 1 if cell (i, j) is alive, 0 if not */
+int sparse_get(const struct sparse_world *world, int i, int j);
+
+/* bring cell (i, j) to life
+ * returns 0 on success, 1 on allocation failure */
+int sparse_set(struct sparse_world *world, int i, int j);
+
+/* play one round, updating world->live
+ * returns 0 on success, 1 on allocation failure */
+int sparse_step(struct sparse_world *world);
+
+#endif  /* __SPARSE_H__ */
@@ -0,0 +1,365 @@
+/*
+ * Per-round statistics, and the thread that writes them out.
+ * See stats.h for what is gathered and the file formats.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stats.h"
+
+_Static_assert(sizeof(struct gen_stats) == 48,
+        "stats records must stay 48 bytes");
+
+/* reset stats for a round, with no rows added yet */
+void gen_stats_clear(struct gen_stats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->min_row = stats->min_col = -1;
+    stats->max_row = stats->max_col = -1;
+}
+
+/* widen stats' bounding box to take in cells min_col to max_col of row i */
+static inline void add_box(struct gen_stats *stats, int i, int min_col,
+        int max_col)
+{
+    if (stats->min_row < 0) {
+        stats->min_row = stats->max_row = i;
+        stats->min_col = min_col;
+        stats->max_col = max_col;
+        return;
+    }
+    //rows are added in order within a thread, but merged in any order
+    if (i < stats->min_row) {
+        stats->min_row = i;
+    }
+    if (i > stats->max_row) {
+        stats->max_row = i;
+    }
+    if (min_col < stats->min_col) {
+        stats->min_col = min_col;
+    }
+    if (max_col > stats->max_col) {
+        stats->max_col = max_col;
+    }
+}
+
+/* add rows [row_start, row_end) of the boards before and after a round,
+ * see gen_stats_block: with no branch per word, the rows' columns only
+ * go into cols, for gen_stats_cols to find the bounding box's */
+static inline __attribute__((always_inline)) void stats_block(
+        struct gen_stats *stats, uint64_t *cols, const struct bitgrid *before,
+        const struct bitgrid *after, int row_start, int row_end)
+{
+    long live = 0, births = 0, changed = 0;
+    int words = after->words;
+
+    for (int i = row_start; i < row_end; i++) {
+        const uint64_t *b = bitgrid_row(before, i);
+        const uint64_t *a = bitgrid_row(after, i);
+        uint64_t any = 0;
+
+        for (int k = 0; k < words; k++) {
+            uint64_t flips = a[k] ^ b[k];
+
+            live += __builtin_popcountll(a[k]);
+            births += __builtin_popcountll(flips & a[k]);
+            changed += __builtin_popcountll(flips);
+            cols[k] |= a[k];
+            any |= a[k];
+        }
+        if (any != 0) {
+            if (stats->min_row < 0 || i < stats->min_row) {
+                stats->min_row = i;
+            }
+            if (i > stats->max_row) {
+                stats->max_row = i;
+            }
+        }
+    }
+    stats->live += live;
+    stats->births += births;
+    stats->deaths += changed - births;
+}
+
+/* stats_block with the popcnt instruction, on CPUs that have it */
+__attribute__((target("popcnt")))
+static void stats_block_popcnt(struct gen_stats *stats, uint64_t *cols,
+        const struct bitgrid *before, const struct bitgrid *after,
+        int row_start, int row_end)
+{
+    stats_block(stats, cols, before, after, row_start, row_end);
+}
+
+/* add rows [row_start, row_end) of the packed boards before and after a
+ * round, see stats.h */
+void gen_stats_block(struct gen_stats *stats, uint64_t *cols,
+        const struct bitgrid *before, const struct bitgrid *after,
+        int row_start, int row_end)
+{
+    if (__builtin_cpu_supports("popcnt")) {
+        stats_block_popcnt(stats, cols, before, after, row_start, row_end);
+    }
+    else {
+        stats_block(stats, cols, before, after, row_start, row_end);
+    }
+}
+
+/* set stats' bounding box columns from the words of live columns that
+ * gen_stats_block gathered in cols, and clear them for the next round */
+void gen_stats_cols(struct gen_stats *stats, uint64_t *cols, int words) {
+    int first = -1, last = -1;
+
+    for (int k = 0; k < words; k++) {
+        if (cols[k] != 0) {
+            if (first < 0) {
+                first = k;
+            }
+            last = k;
+        }
+    }
+    if (first >= 0 && stats->min_row >= 0) {
+        stats->min_col = first * 64 + __builtin_ctzll(cols[first]);
+        stats->max_col = last * 64 + 63 - __builtin_clzll(cols[last]);
+    }
+    memset(cols, 0, words * sizeof(uint64_t));
+}
+
+/* count the cells of rows [row_start, row_end) that differ between before
+ * and after, see gen_stats_changed */
+static inline __attribute__((always_inline)) long stats_changed(
+        const struct bitgrid *before, const struct bitgrid *after,
+        int row_start, int row_end)
+{
+    const uint64_t *b = bitgrid_row(before, row_start);
+    const uint64_t *a = bitgrid_row(after, row_start);
+    long words = (long)(row_end - row_start) * after->words;
+    long changed = 0;
+
+    for (long k = 0; k < words; k++) {
+        changed += __builtin_popcountll(a[k] ^ b[k]);
+    }
+    return changed;
+}
+
+/* stats_changed with the popcnt instruction, on CPUs that have it */
+__attribute__((target("popcnt")))
+static long stats_changed_popcnt(const struct bitgrid *before,
+        const struct bitgrid *after, int row_start, int row_end)
+{
+    return stats_changed(before, after, row_start, row_end);
+}
+
+/* return the number of cells of rows [row_start, row_end) that differ
+ * between the packed boards before and after a round */
+long gen_stats_changed(const struct bitgrid *before,
+        const struct bitgrid *after, int row_start, int row_end)
+{
+    if (__builtin_cpu_supports("popcnt")) {
+        return stats_changed_popcnt(before, after, row_start, row_end);
+    }
+    return stats_changed(before, after, row_start, row_end);
+}
+
+/* the same, for a row of cols cells of a byte each */
+long gen_stats_changed_bytes(const uint8_t *before, const uint8_t *after,
+        int cols)
+{
+    long changed = 0;
+
+    for (int j = 0; j < cols; j++) {
+        changed += (before[j] != after[j]);
+    }
+    return changed;
+}
+
+/* add row i of cols cells of a byte each (1 for alive) before and after a
+ * round */
+void gen_stats_row_bytes(struct gen_stats *stats, int i,
+        const uint8_t *before, const uint8_t *after, int cols)
+{
+    long live = 0, births = 0, deaths = 0;
+    int first = -1, last = -1;
+
+    for (int j = 0; j < cols; j++) {
+        int b = (before[j] == 1), a = (after[j] == 1);
+
+        live += a;
+        births += a & !b;
+        deaths += b & !a;
+        if (a) {
+            if (first < 0) {
+                first = j;
+            }
+            last = j;
+        }
+    }
+    stats->live += live;
+    stats->births += births;
+    stats->deaths += deaths;
+    if (first >= 0) {
+        add_box(stats, i, first, last);
+    }
+}
+
+/* add the rows in from to those in stats */
+void gen_stats_merge(struct gen_stats *stats, const struct gen_stats *from) {
+    stats->live += from->live;
+    stats->births += from->births;
+    stats->deaths += from->deaths;
+    if (from->min_row >= 0) {
+        add_box(stats, from->min_row, from->min_col, from->max_col);
+        add_box(stats, from->max_row, from->min_col, from->max_col);
+    }
+}
+
+/* write n records to the writer's file
+ * returns: 0 on success, 1 on error */
+static int write_records(struct stats_writer *writer,
+        const struct gen_stats *records, long n)
+{
+    if (writer->binary) {
+        return fwrite(records, sizeof(*records), n, writer->file)
+            != (size_t)n;
+    }
+    for (long r = 0; r < n; r++) {
+        const struct gen_stats *s = &records[r];
+
+        if (fprintf(writer->file, "%d,%ld,%ld,%ld,%d,%d,%d,%d\n", s->round,
+                    (long)s->live, (long)s->births, (long)s->deaths,
+                    s->min_row, s->min_col, s->max_row, s->max_col) < 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* the writer thread: takes records off the ring a chunk at a time and
+ * writes them out, until it is stopped with the ring empty */
+static void *writer_main(void *arg) {
+    struct stats_writer *writer = arg;
+
+    pthread_mutex_lock(&writer->lock);
+    while (1) {
+        long n = 0;
+
+        while (writer->head == writer->tail && !writer->stopping) {
+            pthread_cond_wait(&writer->ready, &writer->lock);
+        }
+        if (writer->head == writer->tail) {
+            break;
+        }
+
+        //copy out a chunk, which may wrap around the end of the ring
+        while (writer->tail < writer->head && n < STATS_CHUNK) {
+            writer->chunk[n++] = writer->ring[writer->tail % STATS_RING];
+            writer->tail++;
+        }
+        pthread_cond_signal(&writer->space);
+        pthread_mutex_unlock(&writer->lock);
+
+        if (!writer->failed) {
+            if (write_records(writer, writer->chunk, n) != 0) {
+                fprintf(stderr, "Error: Failure to write stats to %s\n",
+                        writer->path);
+                writer->failed = 1;
+            }
+            else {
+                writer->written += n;
+            }
+        }
+        pthread_mutex_lock(&writer->lock);
+    }
+    pthread_mutex_unlock(&writer->lock);
+    return NULL;
+}
+
+/* close the writer's file, if it's open, and free its buffers */
+static void free_writer(struct stats_writer *writer) {
+    if (writer->file != NULL) {
+        fclose(writer->file);
+    }
+    free(writer->ring);
+    free(writer->chunk);
+    writer->file = NULL;
+    writer->ring = writer->chunk = NULL;
+}
+
+/* create the file at path and start a writer thread for it
+ * returns: 0 on success, 1 on error
+ */
+int stats_writer_start(struct stats_writer *writer, const char *path,
+        int drop)
+{
+    size_t len = strlen(path);
+
+    memset(writer, 0, sizeof(*writer));
+    writer->path = path;
+    writer->drop = drop;
+    writer->binary = (len >= 4 && strcmp(path + len - 4, ".bin") == 0);
+    writer->ring = malloc(STATS_RING * sizeof(struct gen_stats));
+    writer->chunk = malloc(STATS_CHUNK * sizeof(struct gen_stats));
+    writer->file = fopen(path, writer->binary ? "wb" : "w");
+    if (writer->ring == NULL || writer->chunk == NULL
+            || writer->file == NULL
+            || (!writer->binary && fprintf(writer->file, "round,live,births,"
+                    "deaths,min_row,min_col,max_row,max_col\n") < 0)) {
+        free_writer(writer);
+        return 1;
+    }
+
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->ready, NULL);
+    pthread_cond_init(&writer->space, NULL);
+    if (pthread_create(&writer->tid, NULL, writer_main, writer)) {
+        pthread_mutex_destroy(&writer->lock);
+        pthread_cond_destroy(&writer->ready);
+        pthread_cond_destroy(&writer->space);
+        free_writer(writer);
+        return 1;
+    }
+    return 0;
+}
+
+/* put a copy of round's stats on the ring, waiting for room if it's full
+ * (or dropping them, if the writer was started to drop) */
+void stats_writer_push(struct stats_writer *writer,
+        const struct gen_stats *stats)
+{
+    pthread_mutex_lock(&writer->lock);
+    while (!writer->drop && writer->head - writer->tail >= STATS_RING) {
+        pthread_cond_wait(&writer->space, &writer->lock);
+    }
+    if (writer->head - writer->tail >= STATS_RING) {
+        writer->dropped++;
+    }
+    else {
+        writer->ring[writer->head % STATS_RING] = *stats;
+        writer->head++;
+        pthread_cond_signal(&writer->ready);
+    }
+    pthread_mutex_unlock(&writer->lock);
+}
+
+/* write out what is left on the ring, stop the writer thread and close
+ * the file
+ * returns: 0 if every record pushed (and not dropped) was written, 1 if
+ * not
+ */
+int stats_writer_stop(struct stats_writer *writer) {
+    pthread_mutex_lock(&writer->lock);
+    writer->stopping = 1;
+    pthread_cond_signal(&writer->ready);
+    pthread_mutex_unlock(&writer->lock);
+    pthread_join(writer->tid, NULL);
+
+    pthread_mutex_destroy(&writer->lock);
+    pthread_cond_destroy(&writer->ready);
+    pthread_cond_destroy(&writer->space);
+    if (fclose(writer->file) != 0 && !writer->failed) {
+        fprintf(stderr, "Error: Failure to write stats to %s\n",
+                writer->path);
+        writer->failed = 1;
+    }
+    writer->file = NULL;
+    free_writer(writer);
+    return writer->failed;
+}
@@ -0,0 +1,117 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "bitgrid.h"
+
+/* Per-round statistics (--stats=PATH): after every round, its live cells,
+ * births (cells that came to life), deaths (live cells that didn't stay
+ * alive) and the bounding box of its live cells.
+ *
+ * The statistics are gathered by the threads playing the round, a block of
+ * rows at a time: the kernel writes a block small enough to stay in cache,
+ * and then each row of it is compared with the row it came from, with no
+ * branch per word, so the board is never scanned again for them.  Thread 0
+ * adds the threads' blocks up at the end of the round and pushes the
+ * round's record onto a ring, which a writer thread drains to the file, so
+ * the rounds don't wait for the disk.  If the writer falls a whole ring
+ * behind, the rounds wait for it, so every round is recorded; with
+ * --stats-drop, new records are dropped (and counted) instead.
+ *
+ * The file is CSV, one line per round after a header line:
+ *     round,live,births,deaths,min_row,min_col,max_row,max_col
+ * or, if PATH ends in ".bin", a struct gen_stats per round, as laid out
+ * below (in the machine's byte order).  The bounding box is all -1s once
+ * the board is empty.
+ */
+
+#define STATS_RING   (65536)  // records the ring holds
+#define STATS_CHUNK  (1024)   // records the writer takes out at a time
+#define STATS_BLOCK  (16384)  // bytes of rows stepped before their stats
+
+struct gen_stats {
+    int32_t round;     // the round the board is after (1 on)
+    int32_t min_row;   // the bounding box of the live cells
+    int32_t min_col;
+    int32_t max_row;
+    int32_t max_col;
+    int32_t pad;
+    int64_t live;      // live cells after the round
+    int64_t births;    // cells dead before the round and alive after it
+    int64_t deaths;    // cells alive before the round and not after it
+};
+
+struct stats_writer {
+    FILE *file;
+    const char *path;
+    int binary;        // 1 for struct gen_stats records, 0 for CSV
+
+    struct gen_stats *ring;   // STATS_RING records
+    long head;                // records pushed
+    long tail;                // records taken out by the writer
+    struct gen_stats *chunk;  // the writer's records being written
+    int stopping;             // 1 once the writer should finish up
+    int failed;               // 1 if a write failed
+    long written;             // records written
+    int drop;                 // 1 to drop records with the ring full
+    long dropped;             // records dropped with the ring full
+
+    pthread_mutex_t lock;
+    pthread_cond_t ready;     // signaled when records are pushed
+    pthread_cond_t space;     // signaled when records are taken out
+    pthread_t tid;
+};
+
+/* reset stats for a round, with no rows added yet */
+void gen_stats_clear(struct gen_stats *stats);
+
+/* add rows [row_start, row_end) of the packed boards before and after a
+ * round; their live columns are or'ed into cols (a word per word of a row)
+ * rather than into stats' bounding box, which gen_stats_cols then fills in
+ * from them once the round's rows are all added */
+void gen_stats_block(struct gen_stats *stats, uint64_t *cols,
+        const struct bitgrid *before, const struct bitgrid *after,
+        int row_start, int row_end);
+
+/* set stats' bounding box columns from the live columns gen_stats_block
+ * or'ed into cols, and clear cols for the next round */
+void gen_stats_cols(struct gen_stats *stats, uint64_t *cols, int words);
+
+/* return the number of cells of rows [row_start, row_end) that differ
+ * between the packed boards before and after a round (the cells a
+ * PROFILE=1 build counts as changed, see prof.h) */
+long gen_stats_changed(const struct bitgrid *before,
+        const struct bitgrid *after, int row_start, int row_end);
+
+/* the same, for a row of cols cells of a byte each */
+long gen_stats_changed_bytes(const uint8_t *before, const uint8_t *after,
+        int cols);
+
+/* the same as gen_stats_block, for a row of cols cells of a byte each (1
+ * for alive) */
+void gen_stats_row_bytes(struct gen_stats *stats, int i,
+        const uint8_t *before, const uint8_t *after, int cols);
+
+/* add the rows in from to those in stats */
+void gen_stats_merge(struct gen_stats *stats, const struct gen_stats *from);
+
+/* create the file at path and start a writer thread for it, which drops
+ * records with the ring full if drop is 1
+ * returns 0 on success, 1 on error */
+int stats_writer_start(struct stats_writer *writer, const char *path,
+        int drop);
+
+/* put a copy of round's stats on the ring for the writer, waiting for room
+ * if it is full (or dropping them, if the writer drops) */
+void stats_writer_push(struct stats_writer *writer,
+        const struct gen_stats *stats);
+
+/* write out what is left on the ring, stop the writer thread and close
+ * the file
+ * returns 0 if every record pushed (and not dropped) was written, 1 if
+ * not */
+int stats_writer_stop(struct stats_writer *writer);
+
+#endif  /* __STATS_H__ */
@@ -0,0 +1,308 @@
+/*
+ * Bit-parallel (SWAR) next-generation kernels for a bitgrid.
+ *
+ * For each word of a row, the eight neighbors of all 64 cells are lined up
+ * as eight shifted copies of the rows above, at, and below the cell:
+ *
+ *     nw  n  ne
+ *      w  c  e
+ *     sw  s  se
+ *
+ * and summed with bitwise full adders, so that each bit of the result holds
+ * the next state of the cell in that bit.  The avx2/avx512 kernels run the
+ * same adders on 4 or 8 words at once using GCC vector extensions, and fall
+ * back to the 64-bit kernel for the first and last words of each row, where
+ * the board wraps around.
+ *
+ * Rules other than Life get 64-bit kernels stamped out of the same loop with
+ * RULE_ADDERS in place of LIFE_ADDERS, one per common rule, with the rule's
+ * masks as constants, and one generic kernel for any other rule.
+ *
+ * Kernels work on any block of words and rows, so that threads can each take
+ * a block of rows (play_gol) or a tile of the board (tiles.c).
+ */
+#include <string.h>
+#include "swar.h"
+
+/* return the mask of real (non-padding) bits in word k of a row */
+static inline uint64_t word_mask(int k, int words, int cols) {
+    if (k == words - 1 && (cols & 63) != 0) {
+        return ((uint64_t)1 << (cols & 63)) - 1;
+    }
+    return ~(uint64_t)0;
+}
+
+/* return word k of row, shifted so each bit holds its west neighbor */
+static inline uint64_t west_word(const uint64_t *row, int k, int cols) {
+    uint64_t carry;
+
+    if (k > 0) {
+        carry = row[k-1] >> 63;
+    }
+    else {
+        // column 0 wraps around to the last column
+        carry = (row[(cols-1) >> 6] >> ((cols-1) & 63)) & 1;
+    }
+    return (row[k] << 1) | carry;
+}
+
+/* return word k of row, shifted so each bit holds its east neighbor */
+static inline uint64_t east_word(const uint64_t *row, int k, int words,
+        int cols)
+{
+    uint64_t carry;
+
+    if (k < words - 1) {
+        carry = row[k+1] << 63;
+    }
+    else {
+        // the last column wraps around to column 0
+        carry = (row[0] & 1) << ((cols-1) & 63);
+    }
+    return (row[k] >> 1) | carry;
+}
+
+/* compute words [k_start, k_end) of the next round's row out from the rows
+ * above (up), at (mid), and below (down) it
+ * returns: number of live cells in those words of out (0 if count is 0)
+ */
+static long step_words(const uint64_t *up, const uint64_t *mid,
+        const uint64_t *down, uint64_t *out, int k_start, int k_end,
+        int words, int cols, int count)
+{
+    long live = 0;
+    uint64_t next;
+
+    for (int k = k_start; k < k_end; k++) {
+        LIFE_ADDERS(west_word(up, k, cols), up[k],
+                east_word(up, k, words, cols),
+                west_word(mid, k, cols), east_word(mid, k, words, cols),
+                west_word(down, k, cols), down[k],
+                east_word(down, k, words, cols),
+                mid[k], next);
+        next &= word_mask(k, words, cols);
+        out[k] = next;
+        if (count) {
+            live += __builtin_popcountll(next);
+        }
+    }
+    return live;
+}
+
+/* portable 64-bit word kernel, see swar.h */
+long swar_step_block(const struct bitgrid *src, struct bitgrid *dst,
+        int row_start, int row_end, int word_start, int word_end, int count)
+{
+    long live = 0;
+    int rows = src->rows;
+
+    for (int i = row_start; i < row_end; i++) {
+        live += step_words(bitgrid_row(src, (i + rows - 1) % rows),
+                bitgrid_row(src, i), bitgrid_row(src, (i + 1) % rows),
+                bitgrid_row(dst, i), word_start, word_end, src->words,
+                src->cols, count);
+    }
+    return live;
+}
+
+/* compute words [k_start, k_end) of the next round's row out like
+ * step_words, under the two-state rule with the given masks (inlined into
+ * each rule's kernel, so that constant masks fold away)
+ * returns: number of live cells in those words of out (0 if count is 0)
+ */
+static inline __attribute__((always_inline)) long rule_step_words(
+        const uint64_t *up, const uint64_t *mid, const uint64_t *down,
+        uint64_t *out, int k_start, int k_end, int words, int cols,
+        int count, unsigned birth, unsigned survive)
+{
+    long live = 0;
+    uint64_t next;
+
+    for (int k = k_start; k < k_end; k++) {
+        RULE_ADDERS(west_word(up, k, cols), up[k],
+                east_word(up, k, words, cols),
+                west_word(mid, k, cols), east_word(mid, k, words, cols),
+                west_word(down, k, cols), down[k],
+                east_word(down, k, words, cols),
+                mid[k], birth, survive, next);
+        next &= word_mask(k, words, cols);
+        out[k] = next;
+        if (count) {
+            live += __builtin_popcountll(next);
+        }
+    }
+    return live;
+}
+
+/* Stamp out a rule's kernel: name_step_block plays the two-state rule with
+ * masks birth and survive, like swar_step_block.
+ */
+#define RULE_KERNEL(name, birth, survive)                                   \
+static long name##_step_block(const struct bitgrid *src, struct bitgrid *dst, \
+        int row_start, int row_end, int word_start, int word_end, int count) \
+{                                                                           \
+    long live = 0;                                                          \
+    int rows = src->rows;                                                   \
+                                                                            \
+    for (int i = row_start; i < row_end; i++) {                             \
+        live += rule_step_words(bitgrid_row(src, (i + rows - 1) % rows),    \
+                bitgrid_row(src, i), bitgrid_row(src, (i + 1) % rows),      \
+                bitgrid_row(dst, i), word_start, word_end, src->words,      \
+                src->cols, count, birth, survive);                          \
+    }                                                                       \
+    return live;                                                            \
+}
+
+/* the mask of neighbor count n, for the rules below */
+#define NB(n)  (1u << (n))
+
+RULE_KERNEL(highlife, NB(3) | NB(6), NB(2) | NB(3))
+RULE_KERNEL(daynight, NB(3) | NB(6) | NB(7) | NB(8),
+        NB(3) | NB(4) | NB(6) | NB(7) | NB(8))
+RULE_KERNEL(seeds, NB(2), 0)
+RULE_KERNEL(nodeath, NB(3), 0x1ff)
+RULE_KERNEL(replicator, NB(1) | NB(3) | NB(5) | NB(7),
+        NB(1) | NB(3) | NB(5) | NB(7))
+RULE_KERNEL(morley, NB(3) | NB(6) | NB(8), NB(2) | NB(4) | NB(5))
+
+/* the rules with a kernel of their own */
+static const struct {
+    unsigned birth;
+    unsigned survive;
+    swar_kernel step;
+} rule_kernels[] = {
+    {NB(3) | NB(6), NB(2) | NB(3), highlife_step_block},
+    {NB(3) | NB(6) | NB(7) | NB(8), NB(3) | NB(4) | NB(6) | NB(7) | NB(8),
+        daynight_step_block},
+    {NB(2), 0, seeds_step_block},
+    {NB(3), 0x1ff, nodeath_step_block},
+    {NB(1) | NB(3) | NB(5) | NB(7), NB(1) | NB(3) | NB(5) | NB(7),
+        replicator_step_block},
+    {NB(3) | NB(6) | NB(8), NB(2) | NB(4) | NB(5), morley_step_block},
+};
+
+/* the generic kernel, reading the rule's masks at run time, see swar.h */
+long swar_rule_step_block(const struct bitgrid *src, struct bitgrid *dst,
+        int row_start, int row_end, int word_start, int word_end, int count,
+        unsigned birth, unsigned survive)
+{
+    long live = 0;
+    int rows = src->rows;
+
+    for (int i = row_start; i < row_end; i++) {
+        live += rule_step_words(bitgrid_row(src, (i + rows - 1) % rows),
+                bitgrid_row(src, i), bitgrid_row(src, (i + 1) % rows),
+                bitgrid_row(dst, i), word_start, word_end, src->words,
+                src->cols, count, birth, survive);
+    }
+    return live;
+}
+
+/* return the kernel compiled for a two-state rule, see swar.h */
+swar_kernel swar_fixed_rule_kernel(unsigned birth, unsigned survive) {
+    if (birth == NB(3) && survive == (NB(2) | NB(3))) {
+        return swar_step_block;
+    }
+    for (int r = 0; r < (int)(sizeof(rule_kernels) / sizeof(rule_kernels[0]));
+            r++) {
+        if (rule_kernels[r].birth == birth
+                && rule_kernels[r].survive == survive) {
+            return rule_kernels[r].step;
+        }
+    }
+    return NULL;
+}
+
+/* set up the kernel for a two-state rule, see swar.h */
+void swar_rule_init(struct swar_rule *kernel, unsigned birth,
+        unsigned survive)
+{
+    kernel->step = swar_fixed_rule_kernel(birth, survive);
+    kernel->birth = birth;
+    kernel->survive = survive;
+}
+
+/* compute a block of dst with a rule's kernel, see swar.h
+ * returns: the number of live cells in it, or 0 if count is 0
+ */
+long swar_rule_step(const struct swar_rule *kernel,
+        const struct bitgrid *src, struct bitgrid *dst, int row_start,
+        int row_end, int word_start, int word_end, int count)
+{
+    if (kernel->step != NULL) {
+        return kernel->step(src, dst, row_start, row_end, word_start,
+                word_end, count);
+    }
+    return swar_rule_step_block(src, dst, row_start, row_end, word_start,
+            word_end, count, kernel->birth, kernel->survive);
+}
+
+/* load LANES words of row starting at word k into c, and the same words
+ * shifted to line up their west (w) and east (e) neighbors */
+#define LOAD_SHIFTED(VEC, row, k, w, c, e) do {                             \
+        VEC lo_, hi_;                                                       \
+        memcpy(&lo_, (row) + (k) - 1, sizeof(VEC));                         \
+        memcpy(&(c), (row) + (k), sizeof(VEC));                             \
+        memcpy(&hi_, (row) + (k) + 1, sizeof(VEC));                         \
+        (w) = ((c) << 1) | (lo_ >> 63);                                     \
+        (e) = ((c) >> 1) | (hi_ << 63);                                     \
+    } while (0)
+
+/* Stamp out a vector kernel: name_step_block runs the adders on LANES words
+ * at a time of type VEC, for every word of the block that has a real word on
+ * both sides of it.
+ */
+#define VECTOR_KERNEL(name, VEC, LANES, TARGET)                             \
+__attribute__((target(TARGET)))                                             \
+long name##_step_block(const struct bitgrid *src, struct bitgrid *dst,      \
+        int row_start, int row_end, int word_start, int word_end, int count) \
+{                                                                           \
+    long live = 0;                                                          \
+    int rows = src->rows, words = src->words, cols = src->cols;             \
+    int vec_end = (word_end < words - 1) ? word_end : words - 1;            \
+                                                                            \
+    for (int i = row_start; i < row_end; i++) {                             \
+        const uint64_t *up = bitgrid_row(src, (i + rows - 1) % rows);       \
+        const uint64_t *mid = bitgrid_row(src, i);                          \
+        const uint64_t *down = bitgrid_row(src, (i + 1) % rows);            \
+        uint64_t *out = bitgrid_row(dst, i);                                \
+        VEC nw, n, ne, w, c, e, sw, s, se, next;                            \
+        int k = word_start;                                                 \
+                                                                            \
+        if (k == 0) {                                                       \
+            live += step_words(up, mid, down, out, 0, 1, words, cols,       \
+                    count);                                                 \
+            k = 1;                                                          \
+        }                                                                   \
+        for (; k + LANES <= vec_end; k += LANES) {                          \
+            LOAD_SHIFTED(VEC, up, k, nw, n, ne);                            \
+            LOAD_SHIFTED(VEC, mid, k, w, c, e);                             \
+            LOAD_SHIFTED(VEC, down, k, sw, s, se);                          \
+            LIFE_ADDERS(nw, n, ne, w, e, sw, s, se, c, next);               \
+            memcpy(out + k, &next, sizeof(VEC));                            \
+            for (int x = 0; count && x < LANES; x++) {                      \
+                live += __builtin_popcountll(next[x]);                      \
+            }                                                               \
+        }                                                                   \
+        live += step_words(up, mid, down, out, k, word_end, words, cols,    \
+                count);                                                     \
+    }                                                                       \
+    return live;                                                            \
+}
+
+typedef uint64_t vec256 __attribute__((vector_size(32)));
+typedef uint64_t vec512 __attribute__((vector_size(64)));
+
+VECTOR_KERNEL(avx2, vec256, 4, "avx2,popcnt")
+VECTOR_KERNEL(avx512, vec512, 8, "avx512f,popcnt")
+
+/* return 1 if this CPU can run the avx2 kernel, 0 if not */
+int swar_have_avx2(void) {
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+}
+
+/* return 1 if this CPU can run the avx512 kernel, 0 if not */
+int swar_have_avx512(void) {
+    return __builtin_cpu_supports("avx512f")
+        && __builtin_cpu_supports("popcnt");
+}
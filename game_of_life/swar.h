@@ -0,0 +1,127 @@
+#ifndef __SWAR_H__
+#define __SWAR_H__
+
+#include "bitgrid.h"
+
+/* Set result to the next state of 64 (or more) cells given their eight
+ * neighbor words and their current state c.  Works on uint64_t and on GCC
+ * vector types alike.  A cell is alive next round if its neighbor count is
+ * 3, or if it is 2 and the cell is alive now.  Shared by the bitgrid
+ * kernels below and the sparse engine's chunks.
+ */
+#define LIFE_ADDERS(nw, n, ne, w, e, sw, s, se, c, result) do {             \
+        /* count each row of neighbors as a 2-bit number (x1:x0) */         \
+        __typeof__(c) a0 = (nw) ^ (n) ^ (ne);                               \
+        __typeof__(c) a1 = ((nw) & (n)) | ((ne) & ((nw) ^ (n)));            \
+        __typeof__(c) b0 = (w) ^ (e);                                       \
+        __typeof__(c) b1 = (w) & (e);                                       \
+        __typeof__(c) c0 = (sw) ^ (s) ^ (se);                               \
+        __typeof__(c) c1 = ((sw) & (s)) | ((se) & ((sw) ^ (s)));            \
+        /* add up the ones place, carrying into d1 */                       \
+        __typeof__(c) d0 = a0 ^ b0 ^ c0;                                    \
+        __typeof__(c) d1 = (a0 & b0) | (c0 & (a0 ^ b0));                    \
+        /* the count is 2 or 3 when exactly one twos-place bit is set */    \
+        __typeof__(c) odd = a1 ^ b1 ^ c1 ^ d1;                              \
+        __typeof__(c) many = (a1 & b1) | (c1 & d1) | ((a1 ^ b1) & (c1 ^ d1)); \
+        (result) = odd & ~many & (d0 | (c));                                \
+    } while (0)
+
+/* Set result to the next state of 64 cells, like LIFE_ADDERS, under the
+ * two-state rule whose birth and survive masks have bit n set if a dead
+ * (live) cell with n live neighbors is alive next round (see rule.h).  The
+ * neighbors are added up into a 4-bit count (t2:t1:t0:d0) per cell, which
+ * is then compared with each count the rule names.  When the masks are
+ * constants, the compiler drops the comparisons with the counts they don't
+ * name, leaving a kernel specialized for the rule.
+ */
+#define RULE_ADDERS(nw, n, ne, w, e, sw, s, se, c, birth, survive, result) \
+    do {                                                                    \
+        __typeof__(c) a0 = (nw) ^ (n) ^ (ne);                               \
+        __typeof__(c) a1 = ((nw) & (n)) | ((ne) & ((nw) ^ (n)));            \
+        __typeof__(c) b0 = (w) ^ (e);                                       \
+        __typeof__(c) b1 = (w) & (e);                                       \
+        __typeof__(c) c0 = (sw) ^ (s) ^ (se);                               \
+        __typeof__(c) c1 = ((sw) & (s)) | ((se) & ((sw) ^ (s)));            \
+        __typeof__(c) d0 = a0 ^ b0 ^ c0;                                    \
+        __typeof__(c) d1 = (a0 & b0) | (c0 & (a0 ^ b0));                    \
+        /* add up the twos place, a1 + b1 + c1 + d1 (0 to 4) */             \
+        __typeof__(c) p = a1 ^ b1, pc = a1 & b1;                            \
+        __typeof__(c) q = c1 ^ d1, qc = c1 & d1;                            \
+        __typeof__(c) t0 = p ^ q;                                           \
+        __typeof__(c) t1 = pc ^ qc ^ (p & q);                               \
+        __typeof__(c) t2 = pc & qc;                                         \
+        (result) = 0;                                                       \
+        /* unrolled, so that constant masks fold away */                    \
+        _Pragma("GCC unroll 9")                                             \
+        for (int n_ = 0; n_ <= 8; n_++) {                                   \
+            /* the cells whose count is n_ */                               \
+            __typeof__(c) eq_ = ((n_ & 1) ? d0 : ~d0)                       \
+                & ((n_ & 2) ? t0 : ~t0) & ((n_ & 4) ? t1 : ~t1)             \
+                & ((n_ & 8) ? t2 : ~t2);                                    \
+            if (((birth) >> n_) & 1) {                                      \
+                (result) |= eq_ & ~(c);                                     \
+            }                                                               \
+            if (((survive) >> n_) & 1) {                                    \
+                (result) |= eq_ & (c);                                      \
+            }                                                               \
+        }                                                                   \
+    } while (0)
+
+/* Bit-parallel (SWAR) next-generation kernels for a bitgrid.
+ *
+ * Each kernel computes words [word_start, word_end) of rows
+ * [row_start, row_end) of the next round's board dst from the current board
+ * src, 64 cells per word operation, using full-adder logic on the shifted
+ * neighbor rows.  The board wraps around at its edges (a torus), just like
+ * count_neighbors.  Returns the number of live cells written to that block
+ * of dst if count is nonzero, or 0 without counting them if count is 0.
+ */
+typedef long (*swar_kernel)(const struct bitgrid *src, struct bitgrid *dst,
+        int row_start, int row_end, int word_start, int word_end, int count);
+
+/* portable 64-bit word kernel */
+long swar_step_block(const struct bitgrid *src, struct bitgrid *dst,
+        int row_start, int row_end, int word_start, int word_end, int count);
+
+/* the same kernel, 256 (avx2) or 512 (avx512) cells at a time */
+long avx2_step_block(const struct bitgrid *src, struct bitgrid *dst,
+        int row_start, int row_end, int word_start, int word_end, int count);
+long avx512_step_block(const struct bitgrid *src, struct bitgrid *dst,
+        int row_start, int row_end, int word_start, int word_end, int count);
+
+/* return the 64-bit word kernel compiled for the two-state rule with the
+ * given birth and survive masks (see RULE_ADDERS): swar_step_block for
+ * Life, or a kernel specialized at compile time for a few common rules
+ * (HighLife, Day & Night, Seeds, Life without Death, Replicator, Morley),
+ * or NULL for any other rule */
+swar_kernel swar_fixed_rule_kernel(unsigned birth, unsigned survive);
+
+/* the generic kernel, for any two-state rule, taking the masks with every
+ * call (so any number of rules can be played at once) */
+long swar_rule_step_block(const struct bitgrid *src, struct bitgrid *dst,
+        int row_start, int row_end, int word_start, int word_end, int count,
+        unsigned birth, unsigned survive);
+
+/* a kernel for a two-state rule: step, or the generic kernel with the
+ * rule's masks if step is NULL */
+struct swar_rule {
+    swar_kernel step;
+    unsigned birth;    // as in struct life_rule
+    unsigned survive;
+};
+
+/* set kernel to the one for the two-state rule with the given masks:
+ * swar_fixed_rule_kernel's, or else the generic one */
+void swar_rule_init(struct swar_rule *kernel, unsigned birth,
+        unsigned survive);
+
+/* compute a block of dst from src with kernel, as a swar_kernel does */
+long swar_rule_step(const struct swar_rule *kernel,
+        const struct bitgrid *src, struct bitgrid *dst, int row_start,
+        int row_end, int word_start, int word_end, int count);
+
+/* return 1 if this CPU can run the avx2 / avx512 kernels, 0 if not */
+int swar_have_avx2(void);
+int swar_have_avx512(void);
+
+#endif  /* __SWAR_H__ */
@@ -0,0 +1,146 @@
+/*
+ * Temporal blocking for the Game Of Life.
+ * See temporal.h for how the bands are cut and played.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "temporal.h"
+
+/* set up a pool for the board
+ * returns: 0 on success, 1 on error
+ */
+int temporal_init(struct temporal_pool *pool, const struct bitgrid *board,
+        int depth, int num_threads)
+{
+    size_t row_bytes = (size_t)board->words * sizeof(uint64_t);
+    long band_rows = TEMPORAL_CACHE_BYTES / (2 * row_bytes) - 2L * depth;
+    long share_rows = (board->rows + num_threads - 1) / num_threads;
+
+    //a band at least 2K rows high keeps the extra rows to half the work,
+    //even on boards too wide for the cache; no band is taller than a
+    //thread's share, so that every thread gets bands to play
+    if (band_rows < 2L * depth) {
+        band_rows = 2L * depth;
+    }
+    if (band_rows > share_rows) {
+        band_rows = share_rows;
+    }
+
+    memset(pool, 0, sizeof(*pool));
+    pool->rows = board->rows;
+    pool->depth = depth;
+    pool->band_rows = band_rows;
+    pool->num_bands = (board->rows + band_rows - 1) / band_rows;
+    pool->num_threads = num_threads;
+    pool->shares = aligned_alloc(64,
+            num_threads * sizeof(struct temporal_share));
+    if (pool->shares == NULL) {
+        return 1;
+    }
+    memset(pool->shares, 0, num_threads * sizeof(struct temporal_share));
+
+    for (int t = 0; t < num_threads; t++) {
+        struct temporal_share *share = &pool->shares[t];
+
+        share->band_start = (long)t * pool->num_bands / num_threads;
+        share->band_end = (long)(t+1) * pool->num_bands / num_threads;
+        for (int s = 0; s < 2; s++) {
+            if (bitgrid_init(&share->scratch[s], band_rows + 2 * depth,
+                        board->cols) != 0) {
+                temporal_free(pool);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* free the pool's storage */
+void temporal_free(struct temporal_pool *pool) {
+    if (pool->shares == NULL) {
+        return;
+    }
+    for (int t = 0; t < pool->num_threads; t++) {
+        bitgrid_free(&pool->shares[t].scratch[0]);
+        bitgrid_free(&pool->shares[t].scratch[1]);
+    }
+    free(pool->shares);
+    pool->shares = NULL;
+}
+
+/* set [row_start, row_end) to the rows of thread id's bands */
+void temporal_rows(const struct temporal_pool *pool, int id, int *row_start,
+        int *row_end)
+{
+    const struct temporal_share *share = &pool->shares[id];
+
+    *row_start = share->band_start * pool->band_rows;
+    *row_end = share->band_end * pool->band_rows;
+    if (*row_start > pool->rows) {
+        *row_start = pool->rows;
+    }
+    if (*row_end > pool->rows) {
+        *row_end = pool->rows;
+    }
+}
+
+/* play band b rounds rounds ahead from src into dst on share's scratch
+ * grids
+ * returns: the number of live cells in the band if count is nonzero, or 0
+ */
+static long play_band(struct temporal_pool *pool,
+        struct temporal_share *share, const struct bitgrid *src,
+        struct bitgrid *dst, int b, int rounds,
+        const struct swar_rule *kernel, int count)
+{
+    struct bitgrid *in = &share->scratch[0];
+    struct bitgrid *out = &share->scratch[1];
+    struct bitgrid *temp;
+    size_t row_bytes = (size_t)src->words * sizeof(uint64_t);
+    int first = b * pool->band_rows;
+    int last = first + pool->band_rows;
+    int height;
+    long live = 0;
+
+    if (last > pool->rows) {
+        last = pool->rows;
+    }
+    height = last - first + 2 * rounds;
+
+    //the band and rounds rows either side of it, wrapping around the board
+    //(more than once, on a board with fewer rows than that)
+    for (int i = 0; i < height; i++) {
+        int r = ((first - rounds + i) % pool->rows + pool->rows) % pool->rows;
+
+        memcpy(bitgrid_row(in, i), bitgrid_row(src, r), row_bytes);
+    }
+
+    //rows [k, height - k) are still right after round k
+    for (int k = 1; k <= rounds; k++) {
+        live = swar_rule_step(kernel, in, out, k, height - k, 0, src->words,
+                count && k == rounds);
+        temp = in;
+        in = out;
+        out = temp;
+    }
+    memcpy(bitgrid_row(dst, first), bitgrid_row(in, rounds),
+            (last - first) * row_bytes);
+    return live;
+}
+
+/* play thread id's bands rounds rounds ahead, see temporal.h
+ * returns: the number of live cells in those rows of dst if count is
+ * nonzero, or 0
+ */
+long temporal_play(struct temporal_pool *pool, int id,
+        const struct bitgrid *src, struct bitgrid *dst, int rounds,
+        const struct swar_rule *kernel, int count)
+{
+    struct temporal_share *share = &pool->shares[id];
+    long live = 0;
+
+    for (int b = share->band_start; b < share->band_end; b++) {
+        live += play_band(pool, share, src, dst, b, rounds, kernel, count);
+    }
+    return live;
+}
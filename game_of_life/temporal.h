@@ -0,0 +1,66 @@
+#ifndef __TEMPORAL_H__
+#define __TEMPORAL_H__
+
+#include "swar.h"
+
+/* Temporal blocking: playing a bitgrid several rounds per pass over memory
+ * (--temporal=K), for boards too big for the caches.
+ *
+ * The board is cut into bands of whole rows, each small enough that the
+ * band and K more rows above and below it fit twice over in
+ * TEMPORAL_CACHE_BYTES.  To play a band, those rows are copied from the
+ * board into a scratch grid, which is then played K rounds on its own,
+ * one row less at each end every round (a trapezoid): the scratch grid's
+ * edge rows go wrong after a round, since their neighbors were never
+ * copied, and the damage spreads a row a round, so after K rounds just the
+ * band's own rows are still right.  Those get copied to the next board.
+ *
+ * So the board is read and written once every K rounds rather than every
+ * round, for the cost of playing K-1 extra rows at each band edge.  The
+ * bands run the full width of the board, so the kernel wraps the columns
+ * around as it always does.  Each thread plays its own even share of the
+ * bands, in order, so it is the one to first touch its share of the next
+ * board (see boardmem.h).
+ */
+
+#define TEMPORAL_CACHE_BYTES  (512 * 1024)  // scratch space for a thread
+
+/* One thread's share of the bands: [band_start, band_end), and the two
+ * scratch grids it plays them on.  Each share gets a cache line of its own.
+ */
+struct temporal_share {
+    int band_start;            // first band of this share
+    int band_end;              // one past the last band
+    struct bitgrid scratch[2]; // a band, its extra rows and their next round
+} __attribute__((aligned(64)));
+
+struct temporal_pool {
+    int rows;          // the row dimension of the board
+    int depth;         // rounds each band is played at a time (K)
+    int band_rows;     // rows in each band (the last one may have fewer)
+    int num_bands;     // number of bands down the board
+    int num_threads;   // number of threads sharing the bands
+    struct temporal_share *shares;  // one per thread
+};
+
+/* set up a pool for playing the board depth rounds at a time
+ * returns 0 on success, 1 on error */
+int temporal_init(struct temporal_pool *pool, const struct bitgrid *board,
+        int depth, int num_threads);
+
+/* free the pool's storage */
+void temporal_free(struct temporal_pool *pool);
+
+/* set [row_start, row_end) to the rows of thread id's bands */
+void temporal_rows(const struct temporal_pool *pool, int id, int *row_start,
+        int *row_end);
+
+/* play thread id's bands rounds rounds ahead (1 .. depth) from src into dst
+ * with kernel
+ * returns the number of live cells in those rows of dst if count is
+ * nonzero, or 0 */
+long temporal_play(struct temporal_pool *pool, int id,
+        const struct bitgrid *src, struct bitgrid *dst, int rounds,
+        const struct swar_rule *kernel, int count);
+
+#endif  /* __TEMPORAL_H__ */
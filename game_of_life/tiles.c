@@ -0,0 +1,282 @@
+/*
+ * Work-stealing tile scheduler for the Game Of Life.
+ * See tiles.h for how the board is split up and when a tile is skipped.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "tiles.h"
+
+/* hand every thread an even share of the num_items tiles (or active list
+ * entries) of the next round */
+static void reset_queues(struct tile_pool *pool, int num_items) {
+    int n = pool->num_threads;
+
+    for (int t = 0; t < n; t++) {
+        atomic_store(&pool->queues[t].next, (int)((long)t * num_items / n));
+        pool->queues[t].end = (long)(t+1) * num_items / n;
+        pool->queues[t].live = 0;
+    }
+}
+
+/* return the first row, one past the last row, the first word and one past
+ * the last word of tile t */
+static void tile_bounds(const struct tile_pool *pool, int t, int *row_start,
+        int *row_end, int *word_start, int *word_end)
+{
+    *row_start = (t / pool->tile_cols) * TILE_ROWS;
+    *row_end = *row_start + TILE_ROWS;
+    *word_start = (t % pool->tile_cols) * TILE_WORDS;
+    *word_end = *word_start + TILE_WORDS;
+    if (*row_end > pool->rows) {
+        *row_end = pool->rows;
+    }
+    if (*word_end > pool->words) {
+        *word_end = pool->words;
+    }
+}
+
+/* set up a pool for the board
+ * returns: 0 on success, 1 on error
+ */
+int tiles_init(struct tile_pool *pool, const struct bitgrid *board,
+        int num_threads, int track_changes)
+{
+    int n;
+
+    memset(pool, 0, sizeof(*pool));
+    pool->rows = board->rows;
+    pool->cols = board->cols;
+    pool->words = board->words;
+    pool->tile_rows = (board->rows + TILE_ROWS - 1) / TILE_ROWS;
+    pool->tile_cols = (board->words + TILE_WORDS - 1) / TILE_WORDS;
+    pool->num_tiles = n = pool->tile_rows * pool->tile_cols;
+    pool->num_threads = num_threads;
+    pool->track_changes = track_changes;
+
+    pool->tile_live = calloc(n, sizeof(long));
+    pool->queues = aligned_alloc(64, num_threads * sizeof(struct tile_queue));
+    if (track_changes) {
+        pool->active = malloc(n * sizeof(int));
+        pool->changed_list = malloc(n * sizeof(int));
+        pool->listed = calloc(n, sizeof(int));
+    }
+    else {
+        pool->last_changed = malloc(n);
+        pool->changed = malloc(n);
+    }
+    if (pool->tile_live == NULL || pool->queues == NULL
+            || (track_changes && (pool->active == NULL
+                    || pool->changed_list == NULL || pool->listed == NULL))
+            || (!track_changes && (pool->last_changed == NULL
+                    || pool->changed == NULL))) {
+        tiles_free(pool);
+        return 1;
+    }
+
+    //Nothing is known about the first round, so every tile gets played.
+    if (track_changes) {
+        for (int t = 0; t < n; t++) {
+            pool->active[t] = t;
+        }
+        pool->num_active = n;
+        atomic_store(&pool->num_changed, 0);
+    }
+    else {
+        memset(pool->last_changed, 1, n);
+        memset(pool->changed, 1, n);
+    }
+
+    //Count each tile's cells, so that the live count can be kept up to
+    //date from just the tiles that get played.
+    for (int t = 0; t < n; t++) {
+        int row_start, row_end, word_start, word_end;
+
+        tile_bounds(pool, t, &row_start, &row_end, &word_start, &word_end);
+        for (int i = row_start; i < row_end; i++) {
+            for (int k = word_start; k < word_end; k++) {
+                pool->tile_live[t] +=
+                    __builtin_popcountll(bitgrid_row(board, i)[k]);
+            }
+        }
+        pool->total_live += pool->tile_live[t];
+    }
+
+    for (int t = 0; t < num_threads; t++) {
+        pool->queues[t].computed = 0;
+        pool->queues[t].cells = 0;
+        pool->queues[t].skipped = 0;
+        pool->queues[t].stolen = 0;
+    }
+    reset_queues(pool, track_changes ? pool->num_active : n);
+    return 0;
+}
+
+/* free the pool's storage */
+void tiles_free(struct tile_pool *pool) {
+    free(pool->tile_live);
+    free(pool->queues);
+    free(pool->last_changed);
+    free(pool->changed);
+    free(pool->active);
+    free(pool->changed_list);
+    free(pool->listed);
+    pool->tile_live = NULL;
+    pool->queues = NULL;
+    pool->last_changed = pool->changed = NULL;
+    pool->active = pool->changed_list = pool->listed = NULL;
+}
+
+/* return 1 if neither tile t nor any of its 8 neighbors (wrapping around
+ * the board) changed last round, 0 if any did */
+static int tile_quiet(const struct tile_pool *pool, int t) {
+    int tr = t / pool->tile_cols;
+    int tc = t % pool->tile_cols;
+
+    for (int l = -1; l <= 1; l++) {
+        int r = (tr + l + pool->tile_rows) % pool->tile_rows;
+        for (int k = -1; k <= 1; k++) {
+            int c = (tc + k + pool->tile_cols) % pool->tile_cols;
+            if (pool->last_changed[r * pool->tile_cols + c]) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/* play item i of this round (tile i, or the ith active tile) from src into
+ * dst, unless it is quiet, adding its live cells (or, when tracking
+ * changes, the change in them) to the queue's count */
+static void play_tile(struct tile_pool *pool, struct tile_queue *queue,
+        int i, const struct bitgrid *src, struct bitgrid *dst,
+        const struct swar_rule *kernel)
+{
+    int t = pool->track_changes ? pool->active[i] : i;
+    int row_start, row_end, word_start, word_end;
+    int changed = 0;
+    long live;
+
+    //dst still holds the tile from the round before, which is what it
+    //would be computed to again.
+    if (!pool->track_changes && tile_quiet(pool, t)) {
+        pool->changed[t] = 0;
+        queue->live += pool->tile_live[t];
+        queue->skipped++;
+        return;
+    }
+
+    tile_bounds(pool, t, &row_start, &row_end, &word_start, &word_end);
+    live = swar_rule_step(kernel, src, dst, row_start, row_end, word_start,
+            word_end, 1);
+
+    for (int r = row_start; r < row_end && !changed; r++) {
+        changed = memcmp(bitgrid_row(src, r) + word_start,
+                bitgrid_row(dst, r) + word_start,
+                (word_end - word_start) * sizeof(uint64_t)) != 0;
+    }
+
+    if (pool->track_changes) {
+        queue->live += live - pool->tile_live[t];
+        if (changed) {
+            pool->changed_list[atomic_fetch_add(&pool->num_changed, 1)] = t;
+        }
+    }
+    else {
+        queue->live += live;
+        pool->changed[t] = changed;
+    }
+    pool->tile_live[t] = live;
+    queue->computed++;
+    queue->cells += (long)(row_end - row_start)
+        * ((word_end * 64 < pool->cols ? word_end * 64 : pool->cols)
+                - word_start * 64);
+}
+
+/* play thread id's share of this round from src into dst, then steal tiles
+ * from the other threads' shares until there are none left */
+void tiles_play(struct tile_pool *pool, int id, const struct bitgrid *src,
+        struct bitgrid *dst, const struct swar_rule *kernel)
+{
+    struct tile_queue *mine = &pool->queues[id];
+    int i;
+
+    while ((i = atomic_fetch_add(&mine->next, 1)) < mine->end) {
+        play_tile(pool, mine, i, src, dst, kernel);
+    }
+
+    for (int v = 1; v < pool->num_threads; v++) {
+        struct tile_queue *victim = &pool->queues[(id + v) % pool->num_threads];
+
+        while ((i = atomic_fetch_add(&victim->next, 1)) < victim->end) {
+            play_tile(pool, mine, i, src, dst, kernel);
+            mine->stolen++;
+        }
+    }
+}
+
+/* put the tiles that changed this round, and their neighbors, on the
+ * active list for the next round, each tile at most once */
+static void list_active(struct tile_pool *pool) {
+    int num_changed = atomic_load(&pool->num_changed);
+
+    pool->num_active = 0;
+    for (int c = 0; c < num_changed; c++) {
+        int tr = pool->changed_list[c] / pool->tile_cols;
+        int tc = pool->changed_list[c] % pool->tile_cols;
+
+        for (int l = -1; l <= 1; l++) {
+            int r = (tr + l + pool->tile_rows) % pool->tile_rows;
+            for (int k = -1; k <= 1; k++) {
+                int t = r * pool->tile_cols
+                    + (tc + k + pool->tile_cols) % pool->tile_cols;
+
+                if (pool->listed[t] != pool->round) {
+                    pool->listed[t] = pool->round;
+                    pool->active[pool->num_active++] = t;
+                }
+            }
+        }
+    }
+    atomic_store(&pool->num_changed, 0);
+}
+
+/* add up this round's live cells and get the pool ready for the next round:
+ * either this round's changes become last round's, or the next round's
+ * active list gets built from them */
+void tiles_end_round(struct tile_pool *pool) {
+    long live = 0;
+
+    for (int t = 0; t < pool->num_threads; t++) {
+        live += pool->queues[t].live;
+    }
+    pool->round++;
+
+    if (pool->track_changes) {
+        //only the played tiles' changes were counted
+        pool->total_live += live;
+        pool->played += pool->num_active;
+        list_active(pool);
+        reset_queues(pool, pool->num_active);
+    }
+    else {
+        unsigned char *temp = pool->last_changed;
+
+        pool->total_live = live;
+        pool->last_changed = pool->changed;
+        pool->changed = temp;
+        reset_queues(pool, pool->num_tiles);
+    }
+}
+
+/* print each thread's tile counts to out */
+void tiles_report(const struct tile_pool *pool, FILE *out) {
+    for (int t = 0; t < pool->num_threads; t++) {
+        fprintf(out, "Thread %d: %ld tiles computed, %ld skipped, "
+                "%ld stolen\n", t, pool->queues[t].computed,
+                pool->queues[t].skipped, pool->queues[t].stolen);
+    }
+    if (pool->track_changes && pool->round > 0) {
+        fprintf(out, "Active tiles per round: %.1f of %d\n",
+                (double)pool->played / pool->round, pool->num_tiles);
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef __TILES_H__
+#define __TILES_H__
+
+#include <stdio.h>
+#include <stdatomic.h>
+#include "swar.h"
+
+/* Tile scheduler for playing a bitgrid with a pool of threads.
+ *
+ * The board is cut into tiles of TILE_ROWS rows by TILE_WORDS words.  Each
+ * round, every thread starts with its own even share of the tiles, and once
+ * that runs out it steals tiles from other threads' shares, so that threads
+ * that land on busy parts of the board get help from the rest.
+ *
+ * A tile that did not change last round, and whose neighbor tiles did not
+ * change either, can't change this round, so it doesn't need to be played:
+ * the board being written still holds the same cells for it from the round
+ * before.  The pool finds these tiles in one of two ways:
+ *   - by checking every tile's neighborhood each round (--sched=tiles), or
+ *   - by keeping a list of the tiles that changed last round, and playing
+ *     only those and their neighbors (--sched=active), so that a round on a
+ *     settled board costs time in proportion to its activity, not its area.
+ */
+
+/* size of one tile: 64 rows x 256 columns */
+#define TILE_ROWS   (64)
+#define TILE_WORDS  (4)
+
+/* One thread's share of the tiles for the current round: it has tiles
+ * [next, end) left.  The owner and thieves alike take a tile with an atomic
+ * fetch-and-add on next, so stealing needs no locks.  Each queue gets a cache
+ * line of its own.
+ */
+struct tile_queue {
+    atomic_int next;  // next tile to hand out
+    int end;          // one past the last tile of this share
+    long live;        // live cells (or the change in them) this round
+    long computed;    // tiles computed by this thread (all rounds)
+    long cells;       // cells in the tiles it computed
+    long skipped;     // inactive tiles skipped by this thread
+    long stolen;      // tiles this thread took from other threads' shares
+} __attribute__((aligned(64)));
+
+struct tile_pool {
+    int rows;            // the row dimension of the board
+    int cols;            // the column dimension of the board
+    int words;           // 64-bit words in each row of the board
+    int tile_rows;       // number of tiles down the board
+    int tile_cols;       // number of tiles across the board
+    int num_tiles;       // tile_rows * tile_cols
+    int num_threads;     // number of threads sharing the tiles
+    int track_changes;   // 1 to keep a list of active tiles, 0 to check all
+    long total_live;     // live cells on the board, as of the last round
+    long *tile_live;     // live cells in each tile, as of the last round
+    struct tile_queue *queues;    // one per thread
+
+    /* used when checking every tile (track_changes is 0) */
+    unsigned char *last_changed;  // did each tile change last round
+    unsigned char *changed;       // did each tile change this round
+
+    /* used when keeping a list of active tiles (track_changes is 1) */
+    int *active;         // the tiles to play this round
+    int num_active;      // number of tiles in active
+    int *changed_list;   // the tiles that changed this round
+    atomic_int num_changed;       // number of tiles in changed_list
+    int *listed;         // the round each tile was last put in active
+    int round;           // number of rounds played
+    long played;         // total tiles played, over all rounds
+};
+
+/* set up a pool for the board, with track_changes set as above
+ * returns 0 on success, 1 on error */
+int tiles_init(struct tile_pool *pool, const struct bitgrid *board,
+        int num_threads, int track_changes);
+
+/* free the pool's storage */
+void tiles_free(struct tile_pool *pool);
+
+/* play thread id's share of this round (and whatever it can steal) from
+ * src into dst with kernel */
+void tiles_play(struct tile_pool *pool, int id, const struct bitgrid *src,
+        struct bitgrid *dst, const struct swar_rule *kernel);
+
+/* add up this round's live cells into total_live and get the pool ready for
+ * the next round (run by one thread, once every thread is done with
+ * tiles_play) */
+void tiles_end_round(struct tile_pool *pool);
+
+/* print each thread's tile counts to out */
+void tiles_report(const struct tile_pool *pool, FILE *out);
+
+#endif  /* __TILES_H__ */